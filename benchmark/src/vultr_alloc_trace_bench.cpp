@@ -0,0 +1,520 @@
+#include <benchmark/benchmark.h>
+#include <core/memory/vultr_memory.h>
+#include <core/memory/alloc_trace.h>
+#include <deque>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef __linux__
+#include <malloc.h>
+#endif
+
+// Replays allocation traces recorded with alloc_trace_start against every allocator type.
+// Traces are picked up from the directory or file in the VULTR_ALLOC_TRACES environment variable, or benchmark/traces by default.
+// A synthetic trace is always replayed as well so that there is something to compare against without any captures.
+
+enum struct ReplayOpType : u8
+{
+    Alloc,
+    Realloc,
+    Free,
+};
+
+// Addresses in a trace are remapped to dense slots ahead of time so that replaying doesn't have to hash anything.
+struct ReplayOp
+{
+    ReplayOpType type;
+    u32 slot;
+    u32 size;
+};
+
+struct ReplayTrace
+{
+    std::string name;
+    std::vector<ReplayOp> ops;
+    u32 num_slots   = 0;
+    u64 total_bytes = 0;
+    u32 max_size    = 0;
+
+    // The most allocations of each power of 2 size class that were alive at once, which sizes the pool for this trace.
+    u32 peak_live[32] = {};
+};
+
+static u32 size_class(u32 size) { return std::bit_width(size > 16 ? size - 1 : 15u); }
+
+// Builds up a replay trace from a stream of events, keeping track of which slot every live address lives in.
+struct ReplayTraceBuilder
+{
+    ReplayTrace *trace = nullptr;
+    std::unordered_map<u64, u32> slots{};
+    std::vector<u32> free_slots{};
+    std::vector<u32> slot_sizes{};
+    u32 live[32] = {};
+
+    u32 take_slot(u64 address, u32 size)
+    {
+        u32 slot;
+        if (!free_slots.empty())
+        {
+            slot = free_slots.back();
+            free_slots.pop_back();
+            slot_sizes[slot] = size;
+        }
+        else
+        {
+            slot = trace->num_slots++;
+            slot_sizes.push_back(size);
+        }
+        slots[address] = slot;
+
+        u32 c = size_class(size);
+        live[c]++;
+        trace->peak_live[c] = std::max(trace->peak_live[c], live[c]);
+        trace->total_bytes += size;
+        trace->max_size = std::max(trace->max_size, size);
+        return slot;
+    }
+
+    void release_slot(std::unordered_map<u64, u32>::iterator it)
+    {
+        u32 slot = it->second;
+        live[size_class(slot_sizes[slot])]--;
+        free_slots.push_back(slot);
+        slots.erase(it);
+    }
+
+    void alloc(u64 address, u32 size)
+    {
+        // Failed allocations have nothing to replay.
+        if (address == 0)
+            return;
+
+        // An address that is handed out again must have been freed by something that wasn't traced.
+        auto it = slots.find(address);
+        if (it != slots.end())
+        {
+            release_slot(it);
+        }
+        trace->ops.push_back({.type = ReplayOpType::Alloc, .slot = take_slot(address, size), .size = size});
+    }
+
+    void realloc(u64 address, u64 result, u32 size)
+    {
+        auto it = slots.find(address);
+        if (it == slots.end())
+        {
+            // The original allocation happened before the trace was started.
+            alloc(result, size);
+            return;
+        }
+
+        if (result == 0)
+            return;
+
+        u32 slot = it->second;
+        live[size_class(slot_sizes[slot])]--;
+        slots.erase(it);
+        slots[result]    = slot;
+        slot_sizes[slot] = size;
+
+        u32 c = size_class(size);
+        live[c]++;
+        trace->peak_live[c] = std::max(trace->peak_live[c], live[c]);
+        trace->total_bytes += size;
+        trace->max_size = std::max(trace->max_size, size);
+        trace->ops.push_back({.type = ReplayOpType::Realloc, .slot = slot, .size = size});
+    }
+
+    void free(u64 address)
+    {
+        auto it = slots.find(address);
+        if (it == slots.end())
+            return;
+
+        trace->ops.push_back({.type = ReplayOpType::Free, .slot = it->second, .size = 0});
+        release_slot(it);
+    }
+};
+
+static bool load_trace(const std::filesystem::path &path, ReplayTrace *trace)
+{
+    FILE *f = fopen(path.string().c_str(), "rb");
+    if (f == nullptr)
+        return false;
+
+    Vultr::AllocTraceHeader header{};
+    if (fread(&header, sizeof(header), 1, f) != 1 || header.magic != ALLOC_TRACE_MAGIC || header.version != ALLOC_TRACE_VERSION)
+    {
+        fprintf(stderr, "Skipping %s, it isn't an allocation trace.\n", path.string().c_str());
+        fclose(f);
+        return false;
+    }
+
+    trace->name = path.stem().string();
+    ReplayTraceBuilder builder{.trace = trace};
+
+    Vultr::AllocTraceEvent events[4096];
+    size_t read = 0;
+    while ((read = fread(events, sizeof(Vultr::AllocTraceEvent), 4096, f)) > 0)
+    {
+        for (size_t i = 0; i < read; i++)
+        {
+            auto &event = events[i];
+            switch (event.op)
+            {
+                case Vultr::AllocTraceOp::Alloc:
+                    builder.alloc(event.address, event.size);
+                    break;
+                case Vultr::AllocTraceOp::Realloc:
+                    builder.realloc(event.address, event.result, event.size);
+                    break;
+                case Vultr::AllocTraceOp::Free:
+                    builder.free(event.address);
+                    break;
+                case Vultr::AllocTraceOp::Allocator:
+                default:
+                    break;
+            }
+        }
+    }
+    fclose(f);
+    return !trace->ops.empty();
+}
+
+// Looks like a level load: bursts of short lived scratch buffers of all sizes, mixed in with long lived assets that are mostly kept until the end.
+static void generate_synthetic_trace(ReplayTrace *trace)
+{
+    trace->name = "synthetic_level_load";
+    ReplayTraceBuilder builder{.trace = trace};
+
+    u32 seed    = 1;
+    auto random = [&seed]() {
+        seed = seed * 1664525 + 1013904223;
+        return seed >> 8;
+    };
+
+    u64 next_address = 1;
+    std::vector<u64> assets;
+    std::vector<u64> scratch;
+    for (u32 burst = 0; burst < 256; burst++)
+    {
+        for (u32 i = 0; i < 64; i++)
+        {
+            u32 size = random() % 8 == 0 ? 1 + random() % Kilobyte(64) : 16 + random() % 512;
+            builder.alloc(next_address, size);
+            if (random() % 4 == 0)
+            {
+                assets.push_back(next_address);
+            }
+            else
+            {
+                scratch.push_back(next_address);
+            }
+            next_address++;
+        }
+
+        // Some assets grow as more of them gets loaded.
+        if (!assets.empty() && random() % 2 == 0)
+        {
+            u64 &asset = assets[random() % assets.size()];
+            builder.realloc(asset, next_address, 1 + random() % Kilobyte(16));
+            asset = next_address++;
+        }
+
+        // Scratch memory is mostly freed in reverse, but not quite.
+        while (!scratch.empty())
+        {
+            u32 index = scratch.size() > 4 && random() % 8 == 0 ? scratch.size() - 1 - random() % 4 : scratch.size() - 1;
+            builder.free(scratch[index]);
+            scratch.erase(scratch.begin() + index);
+        }
+
+        // Every so often an old asset is unloaded.
+        if (assets.size() > 16 && random() % 4 == 0)
+        {
+            u32 index = random() % assets.size();
+            builder.free(assets[index]);
+            assets.erase(assets.begin() + index);
+        }
+    }
+}
+
+// What each allocator reports after a replay.
+struct ReplayResult
+{
+    u64 peak_bytes    = 0;
+    f64 fragmentation = 0;
+    u64 failed        = 0;
+};
+
+// Replays a trace with allocate, reallocate and free functions. Bytes in use are only sampled after every op when `measure` is set, since that isn't free for every allocator.
+template <typename Alloc, typename Realloc, typename Free, typename InUse>
+static void replay(const ReplayTrace &trace, void **slots, Alloc alloc, Realloc realloc, Free free, InUse in_use, ReplayResult *result)
+{
+    for (const auto &op : trace.ops)
+    {
+        switch (op.type)
+        {
+            case ReplayOpType::Alloc:
+                slots[op.slot] = alloc(op.size);
+                break;
+            case ReplayOpType::Realloc:
+                // The original allocation may have failed on this allocator even though it didn't in the trace.
+                slots[op.slot] = slots[op.slot] != nullptr ? realloc(slots[op.slot], op.size) : alloc(op.size);
+                break;
+            case ReplayOpType::Free:
+                if (slots[op.slot] != nullptr)
+                {
+                    free(slots[op.slot]);
+                }
+                slots[op.slot] = nullptr;
+                break;
+        }
+
+        if (result != nullptr)
+        {
+            if (op.type != ReplayOpType::Free && slots[op.slot] == nullptr)
+            {
+                result->failed++;
+            }
+            result->peak_bytes = std::max(result->peak_bytes, in_use());
+        }
+    }
+}
+
+static void free_remaining(const ReplayTrace &trace, void **slots, auto free)
+{
+    for (u32 i = 0; i < trace.num_slots; i++)
+    {
+        if (slots[i] != nullptr)
+        {
+            free(slots[i]);
+            slots[i] = nullptr;
+        }
+    }
+}
+
+static void report(benchmark::State &state, const ReplayTrace &trace, const ReplayResult &result, bool has_fragmentation)
+{
+    state.SetItemsProcessed(static_cast<s64>(state.iterations() * trace.ops.size()));
+    state.counters["peak_bytes"] = benchmark::Counter(static_cast<f64>(result.peak_bytes), benchmark::Counter::kDefaults, benchmark::Counter::OneK::kIs1024);
+    state.counters["failed"]     = static_cast<f64>(result.failed);
+    if (has_fragmentation)
+    {
+        state.counters["fragmentation"] = result.fragmentation;
+    }
+}
+
+static void bm_replay_system_malloc(benchmark::State &state, const ReplayTrace *trace)
+{
+    std::vector<void *> slots(trace->num_slots, nullptr);
+    auto alloc   = [](u32 size) { return ::malloc(size); };
+    auto realloc = [](void *data, u32 size) { return ::realloc(data, size); };
+    auto free    = [](void *data) { ::free(data); };
+
+    for (auto _ : state)
+    {
+        replay(*trace, slots.data(), alloc, realloc, free, []() { return u64(0); }, nullptr);
+        free_remaining(*trace, slots.data(), free);
+    }
+
+    // Peak memory is measured with the usable size of every block, which includes malloc's own rounding but not its headers.
+    ReplayResult result{};
+#ifdef __linux__
+    u64 in_use       = 0;
+    auto track_alloc = [&](u32 size) {
+        void *data = ::malloc(size);
+        in_use += data != nullptr ? malloc_usable_size(data) : 0;
+        return data;
+    };
+    auto track_realloc = [&](void *data, u32 size) {
+        in_use -= malloc_usable_size(data);
+        data = ::realloc(data, size);
+        in_use += malloc_usable_size(data);
+        return data;
+    };
+    auto track_free = [&](void *data) {
+        in_use -= malloc_usable_size(data);
+        ::free(data);
+    };
+    replay(*trace, slots.data(), track_alloc, track_realloc, track_free, [&]() { return in_use; }, &result);
+#else
+    replay(*trace, slots.data(), alloc, realloc, free, []() { return u64(0); }, &result);
+#endif
+    free_remaining(*trace, slots.data(), free);
+    report(state, *trace, result, false);
+}
+
+static void bm_replay_free_list(benchmark::State &state, const ReplayTrace *trace, Vultr::FreeListBackend backend)
+{
+    using namespace Vultr;
+    size_t size                  = MAX(static_cast<size_t>(trace->total_bytes) * 2, Megabyte(64));
+    MemoryArena *arena           = init_mem_arena(size + Megabyte(1), 16, MEM_ARENA_RESERVE_ONLY);
+    FreeListAllocator *allocator = init_free_list_allocator(arena, size, 16, backend);
+
+    std::vector<void *> slots(trace->num_slots, nullptr);
+    auto alloc   = [&](u32 size) { return free_list_alloc(allocator, size); };
+    auto realloc = [&](void *data, u32 size) { return free_list_realloc(allocator, data, size); };
+    auto free    = [&](void *data) { free_list_free(allocator, data); };
+
+    for (auto _ : state)
+    {
+        replay(*trace, slots.data(), alloc, realloc, free, []() { return u64(0); }, nullptr);
+        free_remaining(*trace, slots.data(), free);
+    }
+
+    ReplayResult result{};
+    replay(*trace, slots.data(), alloc, realloc, free, [&]() { return static_cast<u64>(allocator->used); }, &result);
+
+    // Fragmentation is taken at the end of the trace, with everything that was never freed still alive.
+    AllocatorStats stats{};
+    get_allocator_stats(allocator, &stats);
+    result.fragmentation = stats.fragmentation;
+    free_remaining(*trace, slots.data(), free);
+    report(state, *trace, result, true);
+    destroy_mem_arena(arena);
+}
+
+static void bm_replay_pool(benchmark::State &state, const ReplayTrace *trace)
+{
+    using namespace Vultr;
+
+    // One segment per power of 2 size class the trace uses, with as many blocks as were ever alive at once.
+    PoolRegion regions[MAX_POOL_SEGMENTS];
+    u32 num_regions = 0;
+    size_t size     = 0;
+    for (u32 c = 0; c < 32 && num_regions < MAX_POOL_SEGMENTS; c++)
+    {
+        if (trace->peak_live[c] == 0)
+            continue;
+
+        regions[num_regions] = {.size = 1u << c, .count = trace->peak_live[c]};
+        size += static_cast<size_t>(1u << c) * trace->peak_live[c];
+        num_regions++;
+    }
+    MemoryArena *arena       = init_mem_arena(size + Megabyte(16));
+    PoolAllocator *allocator = init_pool_allocator(arena, regions, num_regions);
+
+    std::vector<void *> slots(trace->num_slots, nullptr);
+    auto alloc   = [&](u32 size) { return pool_alloc(allocator, size); };
+    auto realloc = [&](void *data, u32 size) { return pool_realloc(allocator, data, size); };
+    auto free    = [&](void *data) { pool_free(allocator, data); };
+
+    for (auto _ : state)
+    {
+        replay(*trace, slots.data(), alloc, realloc, free, []() { return u64(0); }, nullptr);
+        free_remaining(*trace, slots.data(), free);
+    }
+
+    // Every block in a segment is the same size, so bytes in use can be tracked from the size classes alone.
+    ReplayResult result{};
+    u64 in_use       = 0;
+    auto track_alloc = [&](u32 size) {
+        void *data = pool_alloc(allocator, size);
+        in_use += data != nullptr ? pool_get_block_size(allocator, data) : 0;
+        return data;
+    };
+    auto track_realloc = [&](void *data, u32 size) {
+        u32 old_size = pool_get_block_size(allocator, data);
+        void *moved  = pool_realloc(allocator, data, size);
+        if (moved != nullptr)
+        {
+            in_use += pool_get_block_size(allocator, moved) - old_size;
+        }
+        return moved;
+    };
+    auto track_free = [&](void *data) {
+        in_use -= pool_get_block_size(allocator, data);
+        pool_free(allocator, data);
+    };
+    replay(*trace, slots.data(), track_alloc, track_realloc, track_free, [&]() { return in_use; }, &result);
+
+    AllocatorStats stats{};
+    get_allocator_stats(allocator, &stats);
+    result.fragmentation = stats.fragmentation;
+    free_remaining(*trace, slots.data(), free);
+    report(state, *trace, result, true);
+    destroy_mem_arena(arena);
+}
+
+// A linear allocator never frees, so it is the baseline of how fast handing out memory can get and its peak is every byte the trace ever asked for.
+static void bm_replay_linear(benchmark::State &state, const ReplayTrace *trace)
+{
+    using namespace Vultr;
+    size_t size                = static_cast<size_t>(trace->total_bytes) + trace->ops.size() * 16 + Megabyte(1);
+    MemoryArena *arena         = init_mem_arena(size + Megabyte(1), 16, MEM_ARENA_RESERVE_ONLY);
+    LinearAllocator *allocator = init_linear_allocator(arena, size);
+
+    std::vector<void *> slots(trace->num_slots, nullptr);
+    auto alloc   = [&](u32 size) { return linear_alloc(allocator, size); };
+    auto realloc = [&](void *, u32 size) { return linear_alloc(allocator, size); };
+    auto free    = [](void *) {};
+
+    for (auto _ : state)
+    {
+        replay(*trace, slots.data(), alloc, realloc, free, []() { return u64(0); }, nullptr);
+        linear_free(allocator);
+    }
+
+    ReplayResult result{};
+    replay(*trace, slots.data(), alloc, realloc, free, [&]() { return static_cast<u64>(allocator->used); }, &result);
+    linear_free(allocator);
+    report(state, *trace, result, false);
+    destroy_mem_arena(arena);
+}
+
+static bool register_replay_benchmarks()
+{
+    // Deque so that the benchmarks can hold on to pointers while more traces are loaded.
+    static std::deque<ReplayTrace> traces;
+
+    generate_synthetic_trace(&traces.emplace_back());
+
+    const char *env = getenv("VULTR_ALLOC_TRACES");
+#ifdef VULTR_ALLOC_TRACE_DIR
+    std::filesystem::path root = env != nullptr ? env : VULTR_ALLOC_TRACE_DIR;
+#else
+    std::filesystem::path root = env != nullptr ? env : "traces";
+#endif
+
+    std::error_code error;
+    std::vector<std::filesystem::path> paths;
+    if (std::filesystem::is_directory(root, error))
+    {
+        for (const auto &entry : std::filesystem::directory_iterator(root, error))
+        {
+            if (entry.is_regular_file() && entry.path().extension() == ".vtrace")
+            {
+                paths.push_back(entry.path());
+            }
+        }
+    }
+    else if (std::filesystem::is_regular_file(root, error))
+    {
+        paths.push_back(root);
+    }
+
+    for (const auto &path : paths)
+    {
+        auto &trace = traces.emplace_back();
+        if (!load_trace(path, &trace))
+        {
+            traces.pop_back();
+        }
+    }
+
+    for (const auto &trace : traces)
+    {
+        std::string prefix = "bm_alloc_trace_replay/" + trace.name + "/";
+        benchmark::RegisterBenchmark((prefix + "system_malloc").c_str(), bm_replay_system_malloc, &trace);
+        benchmark::RegisterBenchmark((prefix + "free_list_red_black_tree").c_str(), bm_replay_free_list, &trace, Vultr::FreeListBackend::RedBlackTree);
+        benchmark::RegisterBenchmark((prefix + "free_list_two_level_segregated_fit").c_str(), bm_replay_free_list, &trace, Vultr::FreeListBackend::TwoLevelSegregatedFit);
+        benchmark::RegisterBenchmark((prefix + "pool").c_str(), bm_replay_pool, &trace);
+        benchmark::RegisterBenchmark((prefix + "linear").c_str(), bm_replay_linear, &trace);
+    }
+    return true;
+}
+static bool g_replay_benchmarks_registered = register_replay_benchmarks();
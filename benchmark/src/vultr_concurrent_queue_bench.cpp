@@ -0,0 +1,138 @@
+#include <benchmark/benchmark.h>
+#include <core/memory/vultr_memory.h>
+#include <types/queue.h>
+#include <types/spsc_ring.h>
+#include <types/mpmc_queue.h>
+#include <thread>
+
+// Compares vtl::SpscRing and vtl::MpmcQueue against the mutex and condition variable of a threaded vtl::Queue.
+// Throughput runs half of the benchmark threads as producers and half as consumers, each pushing or popping one element per iteration.
+// The mutex queue is unbounded, so its producers never wait for room the way the others' do, and it needs plenty of memory to run ahead into.
+// Latency bounces one element back and forth between two threads, so every iteration is a round trip through two queues and two wake ups.
+
+#define CONCURRENT_QUEUE_BENCH_CAPACITY 1024
+
+typedef vtl::Queue<u64, CONCURRENT_QUEUE_BENCH_CAPACITY, true> BenchMutexQueue;
+typedef vtl::SpscRing<u64, true> BenchSpscRing;
+typedef vtl::MpmcQueue<u64, true> BenchMpmcQueue;
+
+static void bench_push(BenchMutexQueue *queue, u64 item) { queue->push(item); }
+static u64 bench_pop(BenchMutexQueue *queue) { return queue->pop_wait(); }
+
+template <typename Q>
+static void bench_push(Q *queue, u64 item)
+{
+    while (!queue->try_push(item))
+    {
+        std::this_thread::yield();
+    }
+}
+
+template <typename Q>
+static u64 bench_pop(Q *queue)
+{
+    u64 item = 0;
+    queue->pop_wait(&item);
+    return item;
+}
+
+struct ConcurrentQueueBenchMemory
+{
+    ConcurrentQueueBenchMemory()
+    {
+        using namespace Vultr;
+        arena     = init_mem_arena(Gigabyte(4), 16, MEM_ARENA_RESERVE_ONLY);
+        allocator = init_free_list_allocator(arena, Gigabyte(2), 16);
+    }
+
+    ~ConcurrentQueueBenchMemory() { Vultr::destroy_mem_arena(arena); }
+
+    Vultr::MemoryArena *arena           = nullptr;
+    Vultr::FreeListAllocator *allocator = nullptr;
+};
+
+template <typename Q>
+static Q *new_bench_queue(Vultr::Allocator *allocator)
+{
+    if constexpr (std::is_same_v<Q, BenchMutexQueue>)
+    {
+        return new Q(allocator);
+    }
+    else
+    {
+        return new Q(allocator, CONCURRENT_QUEUE_BENCH_CAPACITY);
+    }
+}
+
+template <typename Q>
+static void bm_concurrent_queue_throughput(benchmark::State &state)
+{
+    static ConcurrentQueueBenchMemory *memory = nullptr;
+    static Q *queue                           = nullptr;
+    if (state.thread_index() == 0)
+    {
+        memory = new ConcurrentQueueBenchMemory();
+        queue  = new_bench_queue<Q>(memory->allocator);
+    }
+
+    bool producer = state.thread_index() % 2 == 0;
+    u64 i         = 0;
+    for (auto _ : state)
+    {
+        if (producer)
+        {
+            bench_push(queue, i++);
+        }
+        else
+        {
+            benchmark::DoNotOptimize(bench_pop(queue));
+        }
+    }
+
+    if (state.thread_index() == 0)
+    {
+        delete queue;
+        delete memory;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(bm_concurrent_queue_throughput, BenchMutexQueue)->Threads(2)->Threads(4)->UseRealTime();
+BENCHMARK_TEMPLATE(bm_concurrent_queue_throughput, BenchSpscRing)->Threads(2)->UseRealTime();
+BENCHMARK_TEMPLATE(bm_concurrent_queue_throughput, BenchMpmcQueue)->Threads(2)->Threads(4)->UseRealTime();
+
+template <typename Q>
+static void bm_concurrent_queue_latency(benchmark::State &state)
+{
+    static ConcurrentQueueBenchMemory *memory = nullptr;
+    static Q *ping                            = nullptr;
+    static Q *pong                            = nullptr;
+    if (state.thread_index() == 0)
+    {
+        memory = new ConcurrentQueueBenchMemory();
+        ping   = new_bench_queue<Q>(memory->allocator);
+        pong   = new_bench_queue<Q>(memory->allocator);
+    }
+
+    for (auto _ : state)
+    {
+        if (state.thread_index() == 0)
+        {
+            bench_push(ping, 1);
+            benchmark::DoNotOptimize(bench_pop(pong));
+        }
+        else
+        {
+            bench_push(pong, bench_pop(ping));
+        }
+    }
+
+    if (state.thread_index() == 0)
+    {
+        delete ping;
+        delete pong;
+        delete memory;
+    }
+}
+BENCHMARK_TEMPLATE(bm_concurrent_queue_latency, BenchMutexQueue)->Threads(2)->UseRealTime();
+BENCHMARK_TEMPLATE(bm_concurrent_queue_latency, BenchSpscRing)->Threads(2)->UseRealTime();
+BENCHMARK_TEMPLATE(bm_concurrent_queue_latency, BenchMpmcQueue)->Threads(2)->UseRealTime();
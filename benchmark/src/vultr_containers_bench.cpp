@@ -0,0 +1,311 @@
+#include <benchmark/benchmark.h>
+#include <core/memory/vultr_memory.h>
+#include <core/memory/memory_resource.h>
+#include <types/dynamic_array.h>
+#include <types/handle_pool.h>
+#include <vector>
+
+// Compares containers that allocate through the runtime polymorphic allocator policy against ones that call their allocator directly.
+// Every iteration grows an array one element at a time and then erases it from the back, so it reallocates on both the way up and the way down.
+
+#define CONTAINER_BENCH_ELEMENTS 512
+
+template <typename Policy>
+static void push_back_erase(Policy policy)
+{
+    vtl::DynamicArray<u64, 4, 3, 2, 30, Policy> array(policy);
+    for (u64 i = 0; i < CONTAINER_BENCH_ELEMENTS; i++)
+    {
+        array.push_back(i);
+    }
+    while (!array.empty())
+    {
+        array.remove_last();
+    }
+    benchmark::DoNotOptimize(array.len);
+}
+
+static Vultr::PoolAllocator *init_bench_pool(Vultr::MemoryArena *arena)
+{
+    using namespace Vultr;
+    PoolRegion regions[] = {{.size = 64, .count = 64}, {.size = 512, .count = 64}, {.size = Kilobyte(8), .count = 64}};
+    return init_pool_allocator(arena, regions, 3);
+}
+
+static void bm_dynamic_array_pool(benchmark::State &state, bool direct)
+{
+    using namespace Vultr;
+    MemoryArena *arena       = init_mem_arena(Megabyte(16));
+    PoolAllocator *allocator = init_bench_pool(arena);
+
+    for (auto _ : state)
+    {
+        if (direct)
+        {
+            push_back_erase<PoolPolicy>(allocator);
+        }
+        else
+        {
+            push_back_erase<DynamicAllocatorPolicy>(allocator);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * CONTAINER_BENCH_ELEMENTS * 2);
+    destroy_mem_arena(arena);
+}
+BENCHMARK_CAPTURE(bm_dynamic_array_pool, dynamic_dispatch, false);
+BENCHMARK_CAPTURE(bm_dynamic_array_pool, static_dispatch, true);
+
+static void bm_dynamic_array_free_list(benchmark::State &state, bool direct)
+{
+    using namespace Vultr;
+    MemoryArena *arena           = init_mem_arena(Megabyte(16));
+    FreeListAllocator *allocator = init_free_list_allocator(arena, Megabyte(8), 16);
+
+    for (auto _ : state)
+    {
+        if (direct)
+        {
+            push_back_erase<FreeListPolicy>(allocator);
+        }
+        else
+        {
+            push_back_erase<DynamicAllocatorPolicy>(allocator);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * CONTAINER_BENCH_ELEMENTS * 2);
+    destroy_mem_arena(arena);
+}
+BENCHMARK_CAPTURE(bm_dynamic_array_free_list, dynamic_dispatch, false);
+BENCHMARK_CAPTURE(bm_dynamic_array_free_list, static_dispatch, true);
+
+// Many short lived small arrays, where the cost of every call into the allocator is a much bigger part of the total.
+static void bm_dynamic_array_small(benchmark::State &state, bool direct)
+{
+    using namespace Vultr;
+    MemoryArena *arena       = init_mem_arena(Megabyte(16));
+    PoolAllocator *allocator = init_bench_pool(arena);
+
+    for (auto _ : state)
+    {
+        for (u32 i = 0; i < 64; i++)
+        {
+            if (direct)
+            {
+                vtl::DynamicArray<u64, 4, 3, 2, 30, PoolPolicy> array(allocator);
+                array.push_back(i);
+                benchmark::DoNotOptimize(array[0]);
+            }
+            else
+            {
+                vtl::DynamicArray<u64, 4, 3, 2, 30> array(allocator);
+                array.push_back(i);
+                benchmark::DoNotOptimize(array[0]);
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * 64);
+    destroy_mem_arena(arena);
+}
+BENCHMARK_CAPTURE(bm_dynamic_array_small, dynamic_dispatch, false);
+BENCHMARK_CAPTURE(bm_dynamic_array_small, static_dispatch, true);
+
+#define HANDLE_POOL_BENCH_OBJECTS 65536
+
+struct BenchParticle
+{
+    f32 position[3];
+    f32 velocity[3];
+};
+
+// The objects live in pool blocks linked through a pointer, which is what systems holding raw pointers into pools end up iterating.
+struct BenchParticleNode
+{
+    BenchParticle particle;
+    BenchParticleNode *next = nullptr;
+};
+
+// Creates every object, removes a random half and creates them again, so that neither the pool nor the list is in allocation order anymore.
+template <typename Create, typename Destroy>
+static void churn_objects(Create create, Destroy destroy)
+{
+    std::vector<u32> order(HANDLE_POOL_BENCH_OBJECTS);
+    for (u32 i = 0; i < HANDLE_POOL_BENCH_OBJECTS; i++)
+    {
+        create(i);
+        order[i] = i;
+    }
+    u32 seed = 1;
+    for (u32 i = HANDLE_POOL_BENCH_OBJECTS - 1; i > 0; i--)
+    {
+        seed = seed * 1664525 + 1013904223;
+        std::swap(order[i], order[(seed >> 8) % (i + 1)]);
+    }
+    for (u32 i = 0; i < HANDLE_POOL_BENCH_OBJECTS / 2; i++)
+    {
+        destroy(order[i]);
+    }
+    for (u32 i = 0; i < HANDLE_POOL_BENCH_OBJECTS / 2; i++)
+    {
+        create(order[i]);
+    }
+}
+
+static void bm_iterate_pool_pointers(benchmark::State &state)
+{
+    using namespace Vultr;
+    MemoryArena *arena       = init_mem_arena(Megabyte(64));
+    PoolAllocator *allocator = init_pool_allocator(arena, sizeof(BenchParticleNode), HANDLE_POOL_BENCH_OBJECTS);
+
+    std::vector<BenchParticleNode *> nodes(HANDLE_POOL_BENCH_OBJECTS);
+    churn_objects([&](u32 i) { nodes[i] = new (pool_alloc(allocator, sizeof(BenchParticleNode))) BenchParticleNode{.particle = {.position = {}, .velocity = {1, 2, 3}}}; },
+                  [&](u32 i) { pool_free(allocator, nodes[i]); });
+
+    // The list is linked in creation order, which is scattered all over the pool after the churn.
+    BenchParticleNode *head = nullptr;
+    for (auto *node : nodes)
+    {
+        node->next = head;
+        head       = node;
+    }
+
+    for (auto _ : state)
+    {
+        for (auto *node = head; node != nullptr; node = node->next)
+        {
+            for (u32 i = 0; i < 3; i++)
+            {
+                node->particle.position[i] += node->particle.velocity[i];
+            }
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * HANDLE_POOL_BENCH_OBJECTS);
+    destroy_mem_arena(arena);
+}
+BENCHMARK(bm_iterate_pool_pointers);
+
+static void bm_iterate_handle_pool(benchmark::State &state, bool bitmap)
+{
+    using namespace Vultr;
+    MemoryArena *arena       = init_mem_arena(Megabyte(64));
+    PoolRegion regions[]     = {{.size = Kilobyte(1), .count = 16}, {.size = Megabyte(2), .count = 16}};
+    PoolAllocator *allocator = init_pool_allocator(arena, regions, 2);
+
+    {
+        vtl::HandlePool<BenchParticle> particles(allocator);
+        std::vector<vtl::Handle<BenchParticle>> handles(HANDLE_POOL_BENCH_OBJECTS);
+        churn_objects([&](u32 i) { handles[i] = particles.insert(BenchParticle{.position = {}, .velocity = {1, 2, 3}}); }, [&](u32 i) { particles.remove(handles[i]); });
+
+        for (auto _ : state)
+        {
+            if (bitmap)
+            {
+                particles.for_each([](vtl::Handle<BenchParticle>, BenchParticle &particle) {
+                    for (u32 i = 0; i < 3; i++)
+                    {
+                        particle.position[i] += particle.velocity[i];
+                    }
+                });
+            }
+            else
+            {
+                for (auto &particle : particles)
+                {
+                    for (u32 i = 0; i < 3; i++)
+                    {
+                        particle.position[i] += particle.velocity[i];
+                    }
+                }
+            }
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations() * HANDLE_POOL_BENCH_OBJECTS);
+    }
+    destroy_mem_arena(arena);
+}
+BENCHMARK_CAPTURE(bm_iterate_handle_pool, dense, false);
+BENCHMARK_CAPTURE(bm_iterate_handle_pool, occupancy_bitmap, true);
+
+// Resolving handles in a random order, the cost of going through the slot table on top of the object itself.
+static void bm_resolve_handles(benchmark::State &state)
+{
+    using namespace Vultr;
+    MemoryArena *arena       = init_mem_arena(Megabyte(64));
+    PoolRegion regions[]     = {{.size = Kilobyte(1), .count = 16}, {.size = Megabyte(2), .count = 16}};
+    PoolAllocator *allocator = init_pool_allocator(arena, regions, 2);
+
+    {
+        vtl::HandlePool<BenchParticle> particles(allocator);
+        std::vector<vtl::Handle<BenchParticle>> handles(HANDLE_POOL_BENCH_OBJECTS);
+        churn_objects([&](u32 i) { handles[i] = particles.insert(BenchParticle{.position = {}, .velocity = {1, 2, 3}}); }, [&](u32 i) { particles.remove(handles[i]); });
+
+        for (auto _ : state)
+        {
+            for (auto handle : handles)
+            {
+                auto *particle = particles.get(handle);
+                particle->position[0] += particle->velocity[0];
+            }
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations() * HANDLE_POOL_BENCH_OBJECTS);
+    }
+    destroy_mem_arena(arena);
+}
+BENCHMARK(bm_resolve_handles);
+
+enum struct PmrResource
+{
+    Default,
+    Linear,
+    Pool,
+    FreeList,
+    Frame,
+};
+
+// Fills a std::pmr::vector one element at a time through each memory resource, against the default resource which is the system heap.
+static void bm_pmr_vector(benchmark::State &state, PmrResource type)
+{
+    using namespace Vultr;
+    MemoryArena *arena           = init_mem_arena(Megabyte(64));
+    LinearAllocator *linear      = init_linear_allocator(arena, Megabyte(1));
+    PoolAllocator *pool          = init_bench_pool(arena);
+    FreeListAllocator *free_list = init_free_list_allocator(arena, Megabyte(8), 16);
+    FrameAllocator *frame        = init_frame_allocator(arena, Megabyte(1), 2);
+
+    LinearResource linear_resource(linear);
+    PoolResource pool_resource(pool);
+    FreeListResource free_list_resource(free_list);
+    FrameResource frame_resource(frame);
+    std::pmr::memory_resource *resources[] = {std::pmr::get_default_resource(), &linear_resource, &pool_resource, &free_list_resource, &frame_resource};
+    auto *resource                         = resources[u32(type)];
+
+    for (auto _ : state)
+    {
+        {
+            std::pmr::vector<u64> values(resource);
+            for (u64 i = 0; i < CONTAINER_BENCH_ELEMENTS; i++)
+            {
+                values.push_back(i);
+            }
+            benchmark::DoNotOptimize(values.data());
+        }
+
+        // The allocators that can't free are reset every iteration instead.
+        if (type == PmrResource::Linear)
+        {
+            linear_free(linear);
+        }
+        else if (type == PmrResource::Frame)
+        {
+            frame_allocator_rotate(frame);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * CONTAINER_BENCH_ELEMENTS);
+    destroy_mem_arena(arena);
+}
+BENCHMARK_CAPTURE(bm_pmr_vector, default_resource, PmrResource::Default);
+BENCHMARK_CAPTURE(bm_pmr_vector, linear, PmrResource::Linear);
+BENCHMARK_CAPTURE(bm_pmr_vector, pool, PmrResource::Pool);
+BENCHMARK_CAPTURE(bm_pmr_vector, free_list, PmrResource::FreeList);
+BENCHMARK_CAPTURE(bm_pmr_vector, frame, PmrResource::Frame);
@@ -0,0 +1,169 @@
+#include <benchmark/benchmark.h>
+#include <core/memory/vultr_memory.h>
+#include <types/dynamic_array.h>
+#include <string>
+#include <vector>
+
+// Compares vtl::DynamicArray against std::vector, for u64 elements that are shifted with memmove and std::string elements that have to be moved one by one.
+// DynamicArray allocates from a free list allocator, std::vector from the system heap.
+
+template <typename T>
+static T get_dynamic_array_bench_element(u64 i)
+{
+    if constexpr (std::is_same_v<T, std::string>)
+    {
+        return "a long enough string to be on the heap " + std::to_string(i);
+    }
+    else
+    {
+        return i;
+    }
+}
+
+struct DynamicArrayBenchMemory
+{
+    DynamicArrayBenchMemory()
+    {
+        using namespace Vultr;
+        arena     = init_mem_arena(Gigabyte(1), 16, MEM_ARENA_RESERVE_ONLY);
+        allocator = init_free_list_allocator(arena, Megabyte(512), 16);
+    }
+
+    ~DynamicArrayBenchMemory() { Vultr::destroy_mem_arena(arena); }
+
+    Vultr::MemoryArena *arena           = nullptr;
+    Vultr::FreeListAllocator *allocator = nullptr;
+};
+
+template <typename T>
+using BenchDynamicArray = vtl::DynamicArray<T, 10, 3, 2, 30, Vultr::FreeListPolicy>;
+
+template <typename T>
+static void bm_dynamic_array_push(benchmark::State &state)
+{
+    T element = get_dynamic_array_bench_element<T>(0);
+    DynamicArrayBenchMemory memory;
+    for (auto _ : state)
+    {
+        BenchDynamicArray<T> array(memory.allocator);
+        for (s64 i = 0; i < state.range(0); i++)
+        {
+            array.push_back(element);
+        }
+        benchmark::DoNotOptimize(array.len);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(bm_dynamic_array_push, u64)->RangeMultiplier(10)->Range(100, 1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(bm_dynamic_array_push, std::string)->RangeMultiplier(10)->Range(100, 1000000)->Unit(benchmark::kMicrosecond);
+
+template <typename T>
+static void bm_vector_push(benchmark::State &state)
+{
+    T element = get_dynamic_array_bench_element<T>(0);
+    for (auto _ : state)
+    {
+        std::vector<T> vector;
+        for (s64 i = 0; i < state.range(0); i++)
+        {
+            vector.push_back(element);
+        }
+        benchmark::DoNotOptimize(vector.size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(bm_vector_push, u64)->RangeMultiplier(10)->Range(100, 1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(bm_vector_push, std::string)->RangeMultiplier(10)->Range(100, 1000000)->Unit(benchmark::kMicrosecond);
+
+// Inserting at the front shifts every element, which is where the containers differ the most.
+template <typename T>
+static void bm_dynamic_array_insert_front(benchmark::State &state)
+{
+    T element = get_dynamic_array_bench_element<T>(0);
+    DynamicArrayBenchMemory memory;
+    for (auto _ : state)
+    {
+        BenchDynamicArray<T> array(memory.allocator);
+        for (s64 i = 0; i < state.range(0); i++)
+        {
+            array.insert(0, element);
+        }
+        benchmark::DoNotOptimize(array.len);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(bm_dynamic_array_insert_front, u64)->RangeMultiplier(10)->Range(100, 10000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(bm_dynamic_array_insert_front, std::string)->RangeMultiplier(10)->Range(100, 10000)->Unit(benchmark::kMicrosecond);
+
+template <typename T>
+static void bm_vector_insert_front(benchmark::State &state)
+{
+    T element = get_dynamic_array_bench_element<T>(0);
+    for (auto _ : state)
+    {
+        std::vector<T> vector;
+        for (s64 i = 0; i < state.range(0); i++)
+        {
+            vector.insert(vector.begin(), element);
+        }
+        benchmark::DoNotOptimize(vector.size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(bm_vector_insert_front, u64)->RangeMultiplier(10)->Range(100, 10000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(bm_vector_insert_front, std::string)->RangeMultiplier(10)->Range(100, 10000)->Unit(benchmark::kMicrosecond);
+
+// Erasing every element from the front. Filling the container again isn't timed.
+template <typename T>
+static void bm_dynamic_array_erase(benchmark::State &state)
+{
+    std::vector<T> elements;
+    for (s64 i = 0; i < state.range(0); i++)
+    {
+        elements.push_back(get_dynamic_array_bench_element<T>(i));
+    }
+
+    DynamicArrayBenchMemory memory;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        BenchDynamicArray<T> array(memory.allocator);
+        array.push_back_n(elements.data(), elements.size());
+        state.ResumeTiming();
+
+        while (!array.empty())
+        {
+            array.remove(0);
+        }
+        benchmark::DoNotOptimize(array.len);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(bm_dynamic_array_erase, u64)->RangeMultiplier(10)->Range(100, 10000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(bm_dynamic_array_erase, std::string)->RangeMultiplier(10)->Range(100, 10000)->Unit(benchmark::kMicrosecond);
+
+template <typename T>
+static void bm_vector_erase(benchmark::State &state)
+{
+    std::vector<T> elements;
+    for (s64 i = 0; i < state.range(0); i++)
+    {
+        elements.push_back(get_dynamic_array_bench_element<T>(i));
+    }
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        std::vector<T> vector(elements);
+        state.ResumeTiming();
+
+        while (!vector.empty())
+        {
+            vector.erase(vector.begin());
+        }
+        benchmark::DoNotOptimize(vector.size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(bm_vector_erase, u64)->RangeMultiplier(10)->Range(100, 10000)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(bm_vector_erase, std::string)->RangeMultiplier(10)->Range(100, 10000)->Unit(benchmark::kMicrosecond);
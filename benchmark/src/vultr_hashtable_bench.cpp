@@ -0,0 +1,216 @@
+#include <benchmark/benchmark.h>
+#include <core/memory/vultr_memory.h>
+#include <types/hashtable.h>
+#include <unordered_map>
+#include <vector>
+
+// Compares vtl::HashTable against std::unordered_map from a thousand up to ten million u64 keys.
+// Keys are scrambled so that neither container gets to benefit from them arriving in order.
+
+static std::vector<u64> get_hashtable_bench_keys(u64 count)
+{
+    std::vector<u64> keys(count);
+    u64 seed = 1;
+    for (u64 i = 0; i < count; i++)
+    {
+        seed    = seed * 6364136223846793005ull + 1442695040888963407ull;
+        keys[i] = seed ^ (seed >> 29);
+    }
+    return keys;
+}
+
+// The same keys in a different order.
+static std::vector<u64> shuffle_hashtable_bench_keys(std::vector<u64> keys)
+{
+    u64 seed = 7;
+    for (u64 i = keys.size() - 1; i > 0; i--)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        std::swap(keys[i], keys[(seed >> 33) % (i + 1)]);
+    }
+    return keys;
+}
+
+struct HashTableBenchMemory
+{
+    HashTableBenchMemory()
+    {
+        using namespace Vultr;
+        arena     = init_mem_arena(Gigabyte(2), 16, MEM_ARENA_RESERVE_ONLY);
+        allocator = init_free_list_allocator(arena, Gigabyte(1), 16);
+    }
+
+    ~HashTableBenchMemory() { Vultr::destroy_mem_arena(arena); }
+
+    Vultr::MemoryArena *arena           = nullptr;
+    Vultr::FreeListAllocator *allocator = nullptr;
+};
+
+typedef vtl::HashTable<u64, u64, vtl::Hash<u64>, vtl::Equal<u64>, Vultr::FreeListPolicy> BenchHashTable;
+
+static void bm_hashtable_lookup(benchmark::State &state)
+{
+    auto keys = get_hashtable_bench_keys(state.range(0));
+    HashTableBenchMemory memory;
+    {
+        BenchHashTable table(memory.allocator);
+        for (u64 key : keys)
+        {
+            table.insert(key, key);
+        }
+
+        u64 i = 0;
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(table.find(keys[i]));
+            i = i + 1 == keys.size() ? 0 : i + 1;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bm_hashtable_lookup)->RangeMultiplier(10)->Range(1000, 10000000);
+
+static void bm_unordered_map_lookup(benchmark::State &state)
+{
+    auto keys = get_hashtable_bench_keys(state.range(0));
+    std::unordered_map<u64, u64> map;
+    for (u64 key : keys)
+    {
+        map[key] = key;
+    }
+
+    u64 i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(map.find(keys[i]));
+        i = i + 1 == keys.size() ? 0 : i + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bm_unordered_map_lookup)->RangeMultiplier(10)->Range(1000, 10000000);
+
+// Lookups of keys that aren't in the table, which have to probe until they can prove it.
+static void bm_hashtable_lookup_miss(benchmark::State &state)
+{
+    auto keys = get_hashtable_bench_keys(state.range(0) * 2);
+    HashTableBenchMemory memory;
+    {
+        BenchHashTable table(memory.allocator);
+        for (u64 i = 0; i < keys.size() / 2; i++)
+        {
+            table.insert(keys[i], keys[i]);
+        }
+
+        u64 i = keys.size() / 2;
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(table.find(keys[i]));
+            i = i + 1 == keys.size() ? keys.size() / 2 : i + 1;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bm_hashtable_lookup_miss)->RangeMultiplier(10)->Range(1000, 10000000);
+
+static void bm_unordered_map_lookup_miss(benchmark::State &state)
+{
+    auto keys = get_hashtable_bench_keys(state.range(0) * 2);
+    std::unordered_map<u64, u64> map;
+    for (u64 i = 0; i < keys.size() / 2; i++)
+    {
+        map[keys[i]] = keys[i];
+    }
+
+    u64 i = keys.size() / 2;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(map.find(keys[i]));
+        i = i + 1 == keys.size() ? keys.size() / 2 : i + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(bm_unordered_map_lookup_miss)->RangeMultiplier(10)->Range(1000, 10000000);
+
+static void bm_hashtable_insert(benchmark::State &state)
+{
+    auto keys = get_hashtable_bench_keys(state.range(0));
+    HashTableBenchMemory memory;
+    for (auto _ : state)
+    {
+        BenchHashTable table(memory.allocator);
+        for (u64 key : keys)
+        {
+            table.insert(key, key);
+        }
+        benchmark::DoNotOptimize(table.len);
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(bm_hashtable_insert)->RangeMultiplier(10)->Range(1000, 10000000)->Unit(benchmark::kMicrosecond);
+
+static void bm_unordered_map_insert(benchmark::State &state)
+{
+    auto keys = get_hashtable_bench_keys(state.range(0));
+    for (auto _ : state)
+    {
+        std::unordered_map<u64, u64> map;
+        for (u64 key : keys)
+        {
+            map[key] = key;
+        }
+        benchmark::DoNotOptimize(map.size());
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(bm_unordered_map_insert)->RangeMultiplier(10)->Range(1000, 10000000)->Unit(benchmark::kMicrosecond);
+
+// Erasing every key in a different order than they were inserted in. Filling the table again isn't timed.
+static void bm_hashtable_erase(benchmark::State &state)
+{
+    auto keys  = get_hashtable_bench_keys(state.range(0));
+    auto order = shuffle_hashtable_bench_keys(keys);
+    HashTableBenchMemory memory;
+    {
+        BenchHashTable table(memory.allocator, keys.size());
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            for (u64 key : keys)
+            {
+                table.insert(key, key);
+            }
+            state.ResumeTiming();
+
+            for (u64 i = 0; i < keys.size(); i++)
+            {
+                benchmark::DoNotOptimize(table.remove(order[i]));
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(bm_hashtable_erase)->RangeMultiplier(10)->Range(1000, 10000000)->Unit(benchmark::kMicrosecond);
+
+static void bm_unordered_map_erase(benchmark::State &state)
+{
+    auto keys  = get_hashtable_bench_keys(state.range(0));
+    auto order = shuffle_hashtable_bench_keys(keys);
+    std::unordered_map<u64, u64> map;
+    map.reserve(keys.size());
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        for (u64 key : keys)
+        {
+            map[key] = key;
+        }
+        state.ResumeTiming();
+
+        for (u64 i = 0; i < keys.size(); i++)
+        {
+            benchmark::DoNotOptimize(map.erase(order[i]));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(bm_unordered_map_erase)->RangeMultiplier(10)->Range(1000, 10000000)->Unit(benchmark::kMicrosecond);
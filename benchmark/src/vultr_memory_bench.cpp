@@ -2,6 +2,9 @@
 #include <core/memory/vultr_memory.h>
 #include <core/memory/pool.h>
 #include <core/memory/free_list.h>
+#include <core/memory/linear.h>
+#include <platform/platform.h>
+#include <mutex>
 
 static void bm_malloc(benchmark::State &state)
 {
@@ -51,6 +54,145 @@ static void bm_free_list_alloc(benchmark::State &state)
 }
 BENCHMARK(bm_free_list_alloc)->Iterations(900);
 
+#define FREE_LIST_TRACE_SLOTS 1024
+#define FREE_LIST_TRACE_LENGTH 65536
+
+// The same trace of sizes is replayed against every backend so that they are compared on identical work.
+// Each step frees whatever lives in a slot and allocates a new block of a random size into it.
+struct FreeListTraceStep
+{
+    u32 slot;
+    u32 size;
+};
+
+static FreeListTraceStep *get_free_list_trace()
+{
+    static FreeListTraceStep trace[FREE_LIST_TRACE_LENGTH];
+    static std::once_flag once;
+    std::call_once(once, []() {
+        u32 seed = 1;
+        for (auto &step : trace)
+        {
+            seed      = seed * 1664525 + 1013904223;
+            step.slot = (seed >> 8) % FREE_LIST_TRACE_SLOTS;
+            seed      = seed * 1664525 + 1013904223;
+            // Mostly small allocations with the occasional large one.
+            step.size = (seed >> 8) % 16 == 0 ? 1 + (seed >> 12) % Kilobyte(64) : 1 + (seed >> 12) % Kilobyte(1);
+        }
+    });
+    return trace;
+}
+
+static void bm_free_list_trace(benchmark::State &state, Vultr::FreeListBackend backend)
+{
+    using namespace Vultr;
+    auto *trace                  = get_free_list_trace();
+    MemoryArena *arena           = init_mem_arena(Megabyte(128));
+    FreeListAllocator *allocator = init_free_list_allocator(arena, Megabyte(96), 16, backend);
+
+    void *allocated[FREE_LIST_TRACE_SLOTS] = {};
+    u32 counter                            = 0;
+    for (auto _ : state)
+    {
+        auto &step = trace[counter % FREE_LIST_TRACE_LENGTH];
+        if (allocated[step.slot] != nullptr)
+        {
+            free_list_free(allocator, allocated[step.slot]);
+        }
+        allocated[step.slot] = free_list_alloc(allocator, step.size);
+        counter++;
+    }
+    destroy_mem_arena(arena);
+}
+BENCHMARK_CAPTURE(bm_free_list_trace, red_black_tree, Vultr::FreeListBackend::RedBlackTree);
+BENCHMARK_CAPTURE(bm_free_list_trace, two_level_segregated_fit, Vultr::FreeListBackend::TwoLevelSegregatedFit);
+
+enum struct ReallocStrategy
+{
+    AllocCopyFree,
+    ForwardOnly,
+    ForwardAndBackward,
+};
+
+// Grows a buffer by 1.5x up to 4MB the way a dynamic array does, while small allocations that come and go keep landing around it.
+static void bm_free_list_realloc_grow(benchmark::State &state, ReallocStrategy strategy)
+{
+    using namespace Vultr;
+    MemoryArena *arena                 = init_mem_arena(Megabyte(64));
+    FreeListAllocator *allocator       = init_free_list_allocator(arena, Megabyte(32), 16, FreeListBackend::TwoLevelSegregatedFit);
+    allocator->realloc_expand_backward = strategy == ReallocStrategy::ForwardAndBackward;
+
+    void *small[64] = {};
+    u32 counter     = 0;
+    for (auto _ : state)
+    {
+        size_t size = 64;
+        void *data  = free_list_alloc(allocator, size);
+        while (size < Megabyte(4))
+        {
+            size_t new_size = size + size / 2;
+            if (strategy == ReallocStrategy::AllocCopyFree)
+            {
+                void *new_data = free_list_alloc(allocator, new_size);
+                memcpy(new_data, data, size);
+                free_list_free(allocator, data);
+                data = new_data;
+            }
+            else
+            {
+                data = free_list_realloc(allocator, data, new_size);
+            }
+            size = new_size;
+
+            u32 index = counter % 64;
+            if (small[index] != nullptr)
+            {
+                free_list_free(allocator, small[index]);
+            }
+            small[index] = free_list_alloc(allocator, 16 + (counter * 97) % 256);
+            counter++;
+        }
+        free_list_free(allocator, data);
+    }
+    destroy_mem_arena(arena);
+}
+BENCHMARK_CAPTURE(bm_free_list_realloc_grow, alloc_copy_free, ReallocStrategy::AllocCopyFree);
+BENCHMARK_CAPTURE(bm_free_list_realloc_grow, forward_only, ReallocStrategy::ForwardOnly);
+BENCHMARK_CAPTURE(bm_free_list_realloc_grow, forward_and_backward, ReallocStrategy::ForwardAndBackward);
+
+#define RANDOM_ACCESS_BLOCKS 32768
+#define RANDOM_ACCESS_BLOCK_SIZE Kilobyte(4)
+
+// Touches random bytes of 128MB worth of free list allocations, which is far more than the TLB can cover with regular pages.
+static void bm_free_list_random_access(benchmark::State &state, u16 arena_flags)
+{
+    using namespace Vultr;
+    MemoryArena *arena           = init_mem_arena(Megabyte(256), 16, arena_flags);
+    FreeListAllocator *allocator = init_free_list_allocator(arena, Megabyte(192), 16, FreeListBackend::TwoLevelSegregatedFit);
+
+    static u8 *blocks[RANDOM_ACCESS_BLOCKS];
+    for (auto &block : blocks)
+    {
+        block = static_cast<u8 *>(free_list_alloc(allocator, RANDOM_ACCESS_BLOCK_SIZE));
+        memset(block, 1, RANDOM_ACCESS_BLOCK_SIZE);
+    }
+
+    u32 seed = 1;
+    u64 sum  = 0;
+    for (auto _ : state)
+    {
+        seed      = seed * 1664525 + 1013904223;
+        u8 *block = blocks[(seed >> 8) % RANDOM_ACCESS_BLOCKS];
+        seed      = seed * 1664525 + 1013904223;
+        sum += block[(seed >> 8) % RANDOM_ACCESS_BLOCK_SIZE]++;
+    }
+    benchmark::DoNotOptimize(sum);
+    destroy_mem_arena(arena);
+}
+BENCHMARK_CAPTURE(bm_free_list_random_access, regular_pages, Vultr::MEM_ARENA_DEFAULT);
+BENCHMARK_CAPTURE(bm_free_list_random_access, huge_pages, Vultr::MEM_ARENA_HUGE_PAGES);
+BENCHMARK_CAPTURE(bm_free_list_random_access, huge_pages_prefault, Vultr::MEM_ARENA_HUGE_PAGES | Vultr::MEM_ARENA_PREFAULT);
+
 static void bm_pool_alloc_single(benchmark::State &state)
 {
     using namespace Vultr;
@@ -72,7 +214,7 @@ static void bm_pool_alloc_multi(benchmark::State &state)
     srand(1);
     MemoryArena *arena       = init_mem_arena(Gigabyte(4));
     PoolRegion regions[]     = {{.size = 128, .count = 40000}, {.size = 256, .count = 30000}, {.size = 512, .count = 10000}, {.size = Kilobyte(1), .count = 10000}};
-    PoolAllocator *allocator = init_pool_allocator(arena, Kilobyte(1), 9000);
+    PoolAllocator *allocator = init_pool_allocator(arena, regions, 4);
 
     for (auto _ : state)
     {
@@ -82,4 +224,298 @@ static void bm_pool_alloc_multi(benchmark::State &state)
 }
 BENCHMARK(bm_pool_alloc_multi)->Iterations(90000);
 
+static void bm_pool_alloc_free_many_regions(benchmark::State &state)
+{
+    using namespace Vultr;
+    MemoryArena *arena   = init_mem_arena(Megabyte(64));
+    PoolRegion regions[] = {
+        {.size = Kilobyte(4), .count = 1000}, {.size = 24, .count = 10000},  {.size = 2048, .count = 2000}, {.size = 48, .count = 10000},   {.size = 96, .count = 10000},  {.size = 1024, .count = 4000},
+        {.size = 16, .count = 10000},         {.size = 192, .count = 10000}, {.size = 512, .count = 4000},  {.size = 32, .count = 10000}, {.size = 384, .count = 4000}, {.size = 64, .count = 10000},
+    };
+    PoolAllocator *allocator = init_pool_allocator(arena, regions, 12);
+
+    void *allocated[256]     = {};
+    u32 counter              = 0;
+    for (auto _ : state)
+    {
+        u32 index = counter % 256;
+        if (allocated[index] != nullptr)
+        {
+            pool_free(allocator, allocated[index]);
+        }
+        allocated[index] = pool_alloc(allocator, (counter * 97) % Kilobyte(4));
+        counter++;
+    }
+    destroy_mem_arena(arena);
+}
+BENCHMARK(bm_pool_alloc_free_many_regions);
+
+// Pool shared by all of the threaded pool benchmarks. It is never destroyed so that threads of one run can't race the teardown of another.
+static Vultr::PoolAllocator *get_threaded_pool()
+{
+    using namespace Vultr;
+    static PoolAllocator *allocator = nullptr;
+    static std::once_flag once;
+    std::call_once(once, []() {
+        MemoryArena *arena   = init_mem_arena(Megabyte(64));
+        PoolRegion regions[] = {{.size = 128, .count = 40000}, {.size = 256, .count = 30000}, {.size = 512, .count = 10000}, {.size = Kilobyte(1), .count = 10000}};
+        allocator            = init_pool_allocator(arena, regions, 4);
+    });
+    return allocator;
+}
+
+#define THREADED_POOL_LIVE_BLOCKS 64
+
+static void bm_pool_alloc_threaded_locked(benchmark::State &state)
+{
+    using namespace Vultr;
+    static std::mutex mutex;
+    auto *allocator = get_threaded_pool();
+
+    void *allocated[THREADED_POOL_LIVE_BLOCKS] = {};
+    u32 counter                                = state.thread_index();
+
+    for (auto _ : state)
+    {
+        u32 index = counter % THREADED_POOL_LIVE_BLOCKS;
+
+        mutex.lock();
+        if (allocated[index] != nullptr)
+        {
+            pool_free(allocator, allocated[index]);
+        }
+        allocated[index] = pool_alloc(allocator, (counter * 97) % Kilobyte(1));
+        mutex.unlock();
+
+        counter++;
+    }
+
+    mutex.lock();
+    for (auto *data : allocated)
+    {
+        if (data != nullptr)
+        {
+            pool_free(allocator, data);
+        }
+    }
+    mutex.unlock();
+}
+BENCHMARK(bm_pool_alloc_threaded_locked)->ThreadRange(1, 8)->UseRealTime();
+
+static void bm_pool_alloc_threaded_cached(benchmark::State &state)
+{
+    using namespace Vultr;
+    auto *allocator = get_threaded_pool();
+
+    void *allocated[THREADED_POOL_LIVE_BLOCKS] = {};
+    u32 counter                                = state.thread_index();
+
+    for (auto _ : state)
+    {
+        u32 index = counter % THREADED_POOL_LIVE_BLOCKS;
+
+        if (allocated[index] != nullptr)
+        {
+            pool_cached_free(allocator, allocated[index]);
+        }
+        allocated[index] = pool_cached_alloc(allocator, (counter * 97) % Kilobyte(1));
+
+        counter++;
+    }
+
+    for (auto *data : allocated)
+    {
+        if (data != nullptr)
+        {
+            pool_cached_free(allocator, data);
+        }
+    }
+    pool_cached_flush(allocator);
+}
+BENCHMARK(bm_pool_alloc_threaded_cached)->ThreadRange(1, 8)->UseRealTime();
+
+// Linear allocators shared by the threaded linear benchmarks. Nothing is ever written to the allocations, so the reserved memory stays untouched no matter how much is handed out.
+static Vultr::LinearAllocator *get_threaded_linear(bool concurrent)
+{
+    using namespace Vultr;
+    static LinearAllocator *allocators[2] = {};
+    static std::once_flag once;
+    std::call_once(once, []() {
+        MemoryArena *arena = init_mem_arena(Gigabyte(64), 16, MEM_ARENA_RESERVE_ONLY);
+        allocators[0]      = init_linear_allocator(arena, Gigabyte(16));
+        allocators[1]      = init_linear_allocator(arena, Gigabyte(16), true);
+    });
+    return allocators[concurrent];
+}
+
+static void bm_linear_alloc_threaded(benchmark::State &state, bool concurrent)
+{
+    using namespace Vultr;
+    static std::mutex mutex;
+    auto *allocator = get_threaded_linear(concurrent);
+
+    // Threads only start allocating once all of them got here, so the first one can reset the allocator for this run.
+    if (state.thread_index() == 0)
+    {
+        linear_free(allocator);
+    }
+
+    u32 counter = state.thread_index();
+    for (auto _ : state)
+    {
+        size_t size = 16 + (counter * 8) % 48;
+        void *data  = nullptr;
+        if (concurrent)
+        {
+            data = linear_alloc(allocator, size, 16);
+        }
+        else
+        {
+            mutex.lock();
+            data = linear_alloc(allocator, size, 16);
+            mutex.unlock();
+        }
+        benchmark::DoNotOptimize(data);
+        counter++;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(bm_linear_alloc_threaded, mutex, false)->Threads(8)->Threads(16)->UseRealTime();
+BENCHMARK_CAPTURE(bm_linear_alloc_threaded, atomic, true)->Threads(8)->Threads(16)->UseRealTime();
+
+// Freeing through the allocator the memory came from against looking the allocator up from the address.
+static void bm_pool_free_lookup(benchmark::State &state, bool lookup)
+{
+    using namespace Vultr;
+    MemoryArena *arena = init_mem_arena(Megabyte(64));
+
+    // A few arenas and allocators around so that the lookups have something to search through.
+    MemoryArena *others[4];
+    for (auto &other : others)
+    {
+        other = init_mem_arena(Megabyte(1));
+    }
+    PoolAllocator *allocator = nullptr;
+    for (u32 i = 0; i < 32; i++)
+    {
+        allocator = init_pool_allocator(arena, 64, 1024);
+    }
+
+    void *allocated[256];
+    for (auto _ : state)
+    {
+        for (auto &data : allocated)
+        {
+            data = pool_alloc(allocator, 64);
+        }
+        for (auto *data : allocated)
+        {
+            if (lookup)
+            {
+                Vultr::free(data);
+            }
+            else
+            {
+                mfree(allocator, data);
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * 256);
+
+    for (auto *other : others)
+    {
+        destroy_mem_arena(other);
+    }
+    destroy_mem_arena(arena);
+}
+BENCHMARK_CAPTURE(bm_pool_free_lookup, known_allocator, false);
+BENCHMARK_CAPTURE(bm_pool_free_lookup, address_lookup, true);
+
+// Generic malloc/mfree against a pool with the heap profiler stopped or sampling. Without VULTR_HEAP_PROFILER both measure the same thing.
+static void bm_heap_profiler_overhead(benchmark::State &state, u32 sample_rate)
+{
+    using namespace Vultr;
+    MemoryArena *arena       = init_mem_arena(Megabyte(64));
+    PoolRegion regions[]     = {{.size = 128, .count = 40000}, {.size = 256, .count = 30000}, {.size = 512, .count = 10000}, {.size = Kilobyte(1), .count = 10000}};
+    PoolAllocator *allocator = init_pool_allocator(arena, regions, 4);
+    if (sample_rate != 0)
+    {
+        heap_profiler_init(sample_rate);
+    }
+
+    void *allocated[256] = {};
+    u32 counter          = 0;
+    for (auto _ : state)
+    {
+        u32 index = counter % 256;
+        if (allocated[index] != nullptr)
+        {
+            mfree(allocator, allocated[index]);
+        }
+        allocated[index] = malloc(allocator, (counter * 97) % Kilobyte(1));
+        counter++;
+    }
+
+    heap_profiler_destroy();
+    destroy_mem_arena(arena);
+}
+BENCHMARK_CAPTURE(bm_heap_profiler_overhead, stopped, 0);
+BENCHMARK_CAPTURE(bm_heap_profiler_overhead, sample_1_in_512, 512);
+BENCHMARK_CAPTURE(bm_heap_profiler_overhead, sample_1_in_64, 64);
+
+#define SNAPSHOT_ARENA_SIZE Megabyte(256)
+
+enum struct SnapshotStrategy
+{
+    CopyEverything,
+    Snapshot,
+    Restore,
+};
+
+// Checkpointing a mostly untouched 256MB arena after writing to a given number of its pages, against copying all of it.
+static void bm_arena_snapshot(benchmark::State &state, SnapshotStrategy strategy)
+{
+    using namespace Vultr;
+    MemoryArena *arena = init_mem_arena(SNAPSHOT_ARENA_SIZE, 16, MEM_ARENA_SNAPSHOTS);
+    auto *linear       = init_linear_allocator(arena, SNAPSHOT_ARENA_SIZE - Megabyte(1));
+    auto *memory       = static_cast<byte *>(linear_alloc(linear, SNAPSHOT_ARENA_SIZE - Megabyte(2)));
+    memset(memory, 1, SNAPSHOT_ARENA_SIZE - Megabyte(2));
+    mem_arena_snapshot(arena);
+
+    byte *copy = nullptr;
+    if (strategy == SnapshotStrategy::CopyEverything)
+    {
+        copy = static_cast<byte *>(::malloc(SNAPSHOT_ARENA_SIZE - Megabyte(2)));
+    }
+
+    auto dirty_pages = static_cast<size_t>(state.range(0));
+    size_t page_size = Platform::get_page_size();
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < dirty_pages; i++)
+        {
+            memory[(i * 7919 % (SNAPSHOT_ARENA_SIZE / page_size - 512)) * page_size]++;
+        }
+
+        switch (strategy)
+        {
+            case SnapshotStrategy::CopyEverything:
+                memcpy(copy, memory, SNAPSHOT_ARENA_SIZE - Megabyte(2));
+                break;
+            case SnapshotStrategy::Snapshot:
+                mem_arena_snapshot(arena);
+                break;
+            case SnapshotStrategy::Restore:
+                mem_arena_restore(arena);
+                break;
+        }
+    }
+
+    ::free(copy);
+    destroy_mem_arena(arena);
+}
+BENCHMARK_CAPTURE(bm_arena_snapshot, copy_everything, SnapshotStrategy::CopyEverything)->Arg(1)->Arg(64)->Arg(4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(bm_arena_snapshot, snapshot, SnapshotStrategy::Snapshot)->Arg(1)->Arg(64)->Arg(4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(bm_arena_snapshot, restore, SnapshotStrategy::Restore)->Arg(1)->Arg(64)->Arg(4096)->Unit(benchmark::kMicrosecond);
+
 BENCHMARK_MAIN();
@@ -0,0 +1,133 @@
+#include <benchmark/benchmark.h>
+#include <core/memory/vultr_memory.h>
+#include <types/queue.h>
+#include <deque>
+#include <queue>
+
+// Pushes a million elements through vtl::Queue and std::queue, either all of them and then popping all of them, or interleaved so the ring buffer keeps wrapping around.
+
+#define QUEUE_BENCH_ELEMENTS 1000000
+
+struct QueueBenchMemory
+{
+    QueueBenchMemory()
+    {
+        using namespace Vultr;
+        arena     = init_mem_arena(Megabyte(256), 16, MEM_ARENA_RESERVE_ONLY);
+        allocator = init_free_list_allocator(arena, Megabyte(128), 16);
+    }
+
+    ~QueueBenchMemory() { Vultr::destroy_mem_arena(arena); }
+
+    Vultr::MemoryArena *arena           = nullptr;
+    Vultr::FreeListAllocator *allocator = nullptr;
+};
+
+typedef vtl::Queue<u64, 16, false, Vultr::FreeListPolicy> BenchQueue;
+
+static void bm_queue_push_pop(benchmark::State &state)
+{
+    QueueBenchMemory memory;
+    for (auto _ : state)
+    {
+        BenchQueue queue(memory.allocator);
+        for (u64 i = 0; i < QUEUE_BENCH_ELEMENTS; i++)
+        {
+            queue.push(i);
+        }
+        while (!queue.empty())
+        {
+            benchmark::DoNotOptimize(*queue.front());
+            queue.pop();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * QUEUE_BENCH_ELEMENTS);
+}
+BENCHMARK(bm_queue_push_pop)->Unit(benchmark::kMillisecond);
+
+static void bm_std_queue_push_pop(benchmark::State &state)
+{
+    for (auto _ : state)
+    {
+        std::queue<u64> queue;
+        for (u64 i = 0; i < QUEUE_BENCH_ELEMENTS; i++)
+        {
+            queue.push(i);
+        }
+        while (!queue.empty())
+        {
+            benchmark::DoNotOptimize(queue.front());
+            queue.pop();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * QUEUE_BENCH_ELEMENTS);
+}
+BENCHMARK(bm_std_queue_push_pop)->Unit(benchmark::kMillisecond);
+
+// Two pushes for every pop, so the queue grows while its front keeps moving.
+static void bm_queue_interleaved(benchmark::State &state)
+{
+    QueueBenchMemory memory;
+    for (auto _ : state)
+    {
+        BenchQueue queue(memory.allocator);
+        for (u64 i = 0; i < QUEUE_BENCH_ELEMENTS; i++)
+        {
+            queue.push(i);
+            if (i % 2 == 0)
+            {
+                benchmark::DoNotOptimize(*queue.front());
+                queue.pop();
+            }
+        }
+        benchmark::DoNotOptimize(queue.len);
+    }
+    state.SetItemsProcessed(state.iterations() * QUEUE_BENCH_ELEMENTS);
+}
+BENCHMARK(bm_queue_interleaved)->Unit(benchmark::kMillisecond);
+
+static void bm_std_queue_interleaved(benchmark::State &state)
+{
+    for (auto _ : state)
+    {
+        std::queue<u64> queue;
+        for (u64 i = 0; i < QUEUE_BENCH_ELEMENTS; i++)
+        {
+            queue.push(i);
+            if (i % 2 == 0)
+            {
+                benchmark::DoNotOptimize(queue.front());
+                queue.pop();
+            }
+        }
+        benchmark::DoNotOptimize(queue.size());
+    }
+    state.SetItemsProcessed(state.iterations() * QUEUE_BENCH_ELEMENTS);
+}
+BENCHMARK(bm_std_queue_interleaved)->Unit(benchmark::kMillisecond);
+
+// The same million elements pushed and popped 256 at a time.
+static void bm_queue_push_n_pop_n(benchmark::State &state)
+{
+    u64 batch[256];
+    for (u64 i = 0; i < 256; i++)
+    {
+        batch[i] = i;
+    }
+
+    QueueBenchMemory memory;
+    for (auto _ : state)
+    {
+        BenchQueue queue(memory.allocator);
+        for (u64 i = 0; i < QUEUE_BENCH_ELEMENTS; i += 256)
+        {
+            queue.push_n(batch, 256);
+        }
+        while (!queue.empty())
+        {
+            benchmark::DoNotOptimize(queue.pop_n(batch, 256));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * QUEUE_BENCH_ELEMENTS);
+}
+BENCHMARK(bm_queue_push_n_pop_n)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,128 @@
+#include "alloc_trace.h"
+#include "vultr_memory_internal.h"
+#include <platform/platform.h>
+#include <stdio.h>
+#include <chrono>
+
+namespace Vultr
+{
+#ifdef VULTR_ALLOC_TRACE
+	/**
+	 * State of the trace recorder, which lives in its own block of memory from the OS so that recording doesn't change the arenas being traced.
+	 */
+	struct AllocTraceRecorder
+	{
+		Platform::PlatformMemoryBlock *memory = nullptr;
+		FILE *file                            = nullptr;
+		SpinLock lock;
+		std::chrono::steady_clock::time_point start;
+		Allocator *allocators[ALLOC_TRACE_MAX_ALLOCATORS];
+		u32 num_allocators = 0;
+		u32 num_buffered   = 0;
+		AllocTraceEvent buffer[ALLOC_TRACE_BUFFER_EVENTS];
+	};
+
+	static std::atomic<AllocTraceRecorder *> g_alloc_trace_recorder{nullptr};
+
+	static void flush_events(AllocTraceRecorder *recorder)
+	{
+		fwrite(recorder->buffer, sizeof(AllocTraceEvent), recorder->num_buffered, recorder->file);
+		recorder->num_buffered = 0;
+	}
+
+	static void push_event(AllocTraceRecorder *recorder, const AllocTraceEvent &event)
+	{
+		if (recorder->num_buffered == ALLOC_TRACE_BUFFER_EVENTS)
+		{
+			flush_events(recorder);
+		}
+		recorder->buffer[recorder->num_buffered] = event;
+		recorder->num_buffered++;
+	}
+
+	static u8 get_allocator_index(AllocTraceRecorder *recorder, Allocator *allocator, u64 timestamp)
+	{
+		// There are only ever a handful of allocators, so a linear search is the fastest way to find them.
+		for (u32 i = 0; i < recorder->num_allocators; i++)
+		{
+			if (recorder->allocators[i] == allocator)
+				return static_cast<u8>(i);
+		}
+
+		// Allocators past the limit are lumped in with the last one.
+		if (recorder->num_allocators == ALLOC_TRACE_MAX_ALLOCATORS)
+			return ALLOC_TRACE_MAX_ALLOCATORS - 1;
+
+		u8 index                    = static_cast<u8>(recorder->num_allocators);
+		recorder->allocators[index] = allocator;
+		recorder->num_allocators++;
+		push_event(recorder, {.timestamp = timestamp, .address = reinterpret_cast<uintptr_t>(allocator), .size = static_cast<u32>(allocator->type), .op = AllocTraceOp::Allocator, .allocator = index});
+		return index;
+	}
+
+	void alloc_trace_write(AllocTraceOp op, Allocator *allocator, void *address, void *result, size_t size)
+	{
+		auto *recorder = g_alloc_trace_recorder.load(std::memory_order_acquire);
+		if (recorder == nullptr)
+			return;
+
+		spin_lock(&recorder->lock);
+		auto timestamp = static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - recorder->start).count());
+		u8 index       = get_allocator_index(recorder, allocator, timestamp);
+		push_event(recorder, {.timestamp = timestamp,
+		                      .address   = reinterpret_cast<uintptr_t>(address),
+		                      .result    = reinterpret_cast<uintptr_t>(result),
+		                      .size      = static_cast<u32>(MIN(size, static_cast<size_t>(UINT32_MAX))),
+		                      .op        = op,
+		                      .allocator = index});
+		spin_unlock(&recorder->lock);
+	}
+
+	bool alloc_trace_start(const char *path)
+	{
+		if (g_alloc_trace_recorder.load(std::memory_order_acquire) != nullptr)
+			return false;
+
+		FILE *file = fopen(path, "wb");
+		if (file == nullptr)
+			return false;
+
+		auto *memory = Platform::virtual_alloc(nullptr, sizeof(AllocTraceRecorder));
+		if (memory == nullptr)
+		{
+			fclose(file);
+			return false;
+		}
+
+		AllocTraceHeader header{};
+		fwrite(&header, sizeof(header), 1, file);
+
+		auto *recorder   = new (Platform::get_memory(memory)) AllocTraceRecorder();
+		recorder->memory = memory;
+		recorder->file   = file;
+		recorder->start  = std::chrono::steady_clock::now();
+		spin_lock_init(&recorder->lock);
+
+		g_alloc_trace_recorder.store(recorder, std::memory_order_release);
+		g_alloc_trace_recording.store(true, std::memory_order_release);
+		return true;
+	}
+
+	void alloc_trace_stop()
+	{
+		auto *recorder = g_alloc_trace_recorder.load(std::memory_order_acquire);
+		if (recorder == nullptr)
+			return;
+
+		g_alloc_trace_recording.store(false, std::memory_order_release);
+		g_alloc_trace_recorder.store(nullptr, std::memory_order_release);
+
+		flush_events(recorder);
+		fclose(recorder->file);
+		Platform::virtual_free(recorder->memory);
+	}
+#else
+	bool alloc_trace_start(const char *) { return false; }
+	void alloc_trace_stop() {}
+#endif
+} // namespace Vultr
@@ -0,0 +1,110 @@
+#pragma once
+#include <types/types.h>
+
+namespace Vultr
+{
+	struct Allocator;
+
+	/**
+	 * "VATR" in little endian, the first 4 bytes of every allocation trace file.
+	 */
+#define ALLOC_TRACE_MAGIC 0x52544156
+#define ALLOC_TRACE_VERSION 1
+
+#ifndef ALLOC_TRACE_BUFFER_EVENTS
+	/**
+	 * The number of events the trace recorder buffers in memory before writing them out.
+	 */
+#define ALLOC_TRACE_BUFFER_EVENTS 16384
+#endif
+
+#ifndef ALLOC_TRACE_MAX_ALLOCATORS
+	/**
+	 * The maximum number of different allocators a single trace can tell apart.
+	 */
+#define ALLOC_TRACE_MAX_ALLOCATORS 255
+#endif
+
+	enum struct AllocTraceOp : u8
+	{
+		// Written the first time an allocator shows up in a trace. `size` holds its `AllocatorType` and `address` the allocator itself.
+		Allocator = 0x1,
+		Alloc     = 0x2,
+		Realloc   = 0x3,
+		Free      = 0x4,
+	};
+
+	/**
+	 * Start of every allocation trace file, followed by a tightly packed array of `AllocTraceEvent` up to the end of the file.
+	 */
+	struct AllocTraceHeader
+	{
+		u32 magic   = ALLOC_TRACE_MAGIC;
+		u32 version = ALLOC_TRACE_VERSION;
+	};
+
+	/**
+	 * A single call to `malloc`, `mrealloc` or `mfree`.
+	 * Addresses are only recorded so that a replay can tell which allocation a later realloc or free refers to, they don't mean anything outside of the traced process.
+	 */
+	struct AllocTraceEvent
+	{
+		// Nanoseconds since the trace was started.
+		u64 timestamp = 0;
+
+		// The address returned by an alloc, or the address passed to a realloc or free.
+		u64 address = 0;
+
+		// The address returned by a realloc.
+		u64 result = 0;
+
+		// The size requested by an alloc or realloc.
+		u32 size        = 0;
+		AllocTraceOp op = AllocTraceOp::Alloc;
+
+		// The index of the allocator, in the order in which they first showed up in the trace.
+		u8 allocator = 0;
+		u16 reserved = 0;
+	};
+	static_assert(sizeof(AllocTraceEvent) == 32, "Allocation trace events are written to disk and must stay the same size!");
+
+	/**
+	 * Start recording every call to `malloc`, `mrealloc` and `mfree` of any allocator to a trace file, which can be replayed by the allocator benchmarks.
+	 * The recorder is only compiled in when the engine is built with `VULTR_ALLOC_TRACE`.
+	 *
+	 * @param const char *path: The file to write the trace to, which is overwritten.
+	 *
+	 * @return bool: Whether recording was started.
+	 *
+	 * @error The method will return false if the recorder isn't compiled in, is already recording, or the file couldn't be opened.
+	 *
+	 * @no_thread_safety
+	 */
+	bool alloc_trace_start(const char *path);
+
+	/**
+	 * Stop recording and write out whatever is still buffered.
+	 *
+	 * @no_thread_safety This must not be called while other threads are allocating.
+	 */
+	void alloc_trace_stop();
+
+#ifdef VULTR_ALLOC_TRACE
+	inline atomic_bool g_alloc_trace_recording{false};
+
+	void alloc_trace_write(AllocTraceOp op, Allocator *allocator, void *address, void *result, size_t size);
+#endif
+
+	/**
+	 * Called by the generic allocation functions, compiles to nothing unless `VULTR_ALLOC_TRACE` is defined.
+	 */
+	inline void alloc_trace_record([[maybe_unused]] AllocTraceOp op, [[maybe_unused]] Allocator *allocator, [[maybe_unused]] void *address, [[maybe_unused]] void *result, [[maybe_unused]] size_t size)
+	{
+#ifdef VULTR_ALLOC_TRACE
+		if (g_alloc_trace_recording.load(std::memory_order_relaxed))
+		{
+			alloc_trace_write(op, allocator, address, result, size);
+		}
+#endif
+	}
+} // namespace Vultr
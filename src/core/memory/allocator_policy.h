@@ -0,0 +1,152 @@
+#pragma once
+#include "vultr_memory.h"
+#include <string.h>
+
+namespace Vultr
+{
+	/**
+	 * Allocator policies are what containers allocate through. A container that is handed a concrete policy calls its allocator directly,
+	 * so its hot paths compile down to a `pool_alloc` or `free_list_alloc` that can be inlined instead of a switch on the allocator type.
+	 *
+	 * Every policy has the same interface:
+	 *     void *alloc(size_t size);
+	 *     void *realloc(void *data, size_t old_size, size_t size);
+	 *     void free(void *data);
+	 *
+	 * `old_size` is only used by allocators that can't reallocate on their own, which copy into a new block instead.
+	 * The concrete policies still report to the heap profiler and the allocation trace, so they show up exactly like `malloc`, `mrealloc` and `mfree`.
+	 */
+
+	/**
+	 * Runtime polymorphic policy that goes through @ref malloc, @ref mrealloc and @ref mfree, and works with any allocator that supports what the container does.
+	 */
+	struct DynamicAllocatorPolicy
+	{
+		DynamicAllocatorPolicy(Allocator *allocator) : allocator(allocator) { ASSERT(allocator != nullptr, "Allocator policy must be initialized with a valid memory allocator!"); }
+		Allocator *allocator = nullptr;
+
+		void *alloc(size_t size) { return Vultr::malloc(allocator, size); }
+		void *realloc(void *data, size_t, size_t size) { return mrealloc(allocator, data, size); }
+		void free(void *data) { mfree(allocator, data); }
+	};
+
+	struct PoolPolicy
+	{
+		PoolPolicy(PoolAllocator *allocator) : allocator(allocator) { ASSERT(allocator != nullptr, "Allocator policy must be initialized with a valid memory allocator!"); }
+		PoolAllocator *allocator = nullptr;
+
+		void *alloc(size_t size)
+		{
+			void *data = pool_alloc(allocator, size);
+			heap_profiler_record_alloc(data, size);
+			alloc_trace_record(AllocTraceOp::Alloc, allocator, data, data, size);
+			return data;
+		}
+
+		void *realloc(void *data, size_t, size_t size)
+		{
+			HeapProfilerReallocState profiler_state;
+			heap_profiler_record_realloc_begin(data, &profiler_state);
+			void *new_data = pool_realloc(allocator, data, size);
+			heap_profiler_record_realloc_end(data, new_data, size, profiler_state);
+			alloc_trace_record(AllocTraceOp::Realloc, allocator, data, new_data, size);
+			return new_data;
+		}
+
+		void free(void *data)
+		{
+			heap_profiler_record_free(data);
+			alloc_trace_record(AllocTraceOp::Free, allocator, data, nullptr, 0);
+			pool_free(allocator, data);
+		}
+	};
+
+	struct FreeListPolicy
+	{
+		FreeListPolicy(FreeListAllocator *allocator) : allocator(allocator) { ASSERT(allocator != nullptr, "Allocator policy must be initialized with a valid memory allocator!"); }
+		FreeListAllocator *allocator = nullptr;
+
+		void *alloc(size_t size)
+		{
+			void *data = free_list_alloc(allocator, size);
+			heap_profiler_record_alloc(data, size);
+			alloc_trace_record(AllocTraceOp::Alloc, allocator, data, data, size);
+			return data;
+		}
+
+		void *realloc(void *data, size_t, size_t size)
+		{
+			HeapProfilerReallocState profiler_state;
+			heap_profiler_record_realloc_begin(data, &profiler_state);
+			void *new_data = free_list_realloc(allocator, data, size);
+			heap_profiler_record_realloc_end(data, new_data, size, profiler_state);
+			alloc_trace_record(AllocTraceOp::Realloc, allocator, data, new_data, size);
+			return new_data;
+		}
+
+		void free(void *data)
+		{
+			heap_profiler_record_free(data);
+			alloc_trace_record(AllocTraceOp::Free, allocator, data, nullptr, 0);
+			free_list_free(allocator, data);
+		}
+	};
+
+	/**
+	 * Linear allocators can't free or reallocate, so growing copies into a new block and the old one is only given back by @ref linear_free.
+	 */
+	struct LinearPolicy
+	{
+		LinearPolicy(LinearAllocator *allocator) : allocator(allocator) { ASSERT(allocator != nullptr, "Allocator policy must be initialized with a valid memory allocator!"); }
+		LinearAllocator *allocator = nullptr;
+
+		void *alloc(size_t size)
+		{
+			void *data = linear_alloc(allocator, size);
+			heap_profiler_record_alloc(data, size);
+			alloc_trace_record(AllocTraceOp::Alloc, allocator, data, data, size);
+			return data;
+		}
+
+		void *realloc(void *data, size_t old_size, size_t size)
+		{
+			void *new_data = alloc(size);
+			if (new_data != nullptr && data != nullptr)
+			{
+				memcpy(new_data, data, MIN(old_size, size));
+			}
+			return new_data;
+		}
+
+		void free(void *) {}
+	};
+
+	/**
+	 * Frame allocations are given back when their frame comes around again, so like @ref LinearPolicy growing copies into a new block and freeing does nothing.
+	 */
+	struct FramePolicy
+	{
+		FramePolicy(FrameAllocator *allocator) : allocator(allocator) { ASSERT(allocator != nullptr, "Allocator policy must be initialized with a valid memory allocator!"); }
+		FrameAllocator *allocator = nullptr;
+
+		void *alloc(size_t size)
+		{
+			void *data = frame_allocator_alloc(allocator, size);
+			heap_profiler_record_alloc(data, size);
+			alloc_trace_record(AllocTraceOp::Alloc, allocator, data, data, size);
+			return data;
+		}
+
+		void *realloc(void *data, size_t old_size, size_t size)
+		{
+			void *new_data = alloc(size);
+			if (new_data != nullptr && data != nullptr)
+			{
+				memcpy(new_data, data, MIN(old_size, size));
+			}
+			return new_data;
+		}
+
+		void free(void *) {}
+	};
+} // namespace Vultr
@@ -0,0 +1,76 @@
+#pragma once
+#include <types/types.h>
+#include "vultr_memory_internal.h"
+#include "pool.h"
+
+namespace Vultr
+{
+	/**
+	 * Occupancy of a single segment of a `PoolAllocator`.
+	 */
+	struct PoolSegmentStats
+	{
+		u32 block_size  = 0;
+		u32 block_count = 0;
+
+		// Blocks that are not on the shared free list. Blocks cached by a thread with `pool_cached_free` count as used.
+		u32 used_blocks = 0;
+	};
+
+	/**
+	 * Snapshot of the state of an allocator, see `get_allocator_stats`.
+	 * Fields under "Counters" are only filled in when allocator statistics are compiled in with `VULTR_ALLOCATOR_STATS` and are 0 otherwise.
+	 */
+	struct AllocatorStats
+	{
+		AllocatorType type        = AllocatorType::None;
+
+		// The total number of bytes the allocator can hand out.
+		size_t capacity           = 0;
+		size_t bytes_in_use       = 0;
+
+		// Free memory, which the largest single allocation that could currently succeed is bounded by.
+		size_t free_bytes         = 0;
+		u64 free_block_count      = 0;
+		size_t largest_free_block = 0;
+
+		// How much of the free memory can't be used for an allocation the size of all of it: 1 - largest_free_block / free_bytes.
+		// 0 means that all free memory is in one place, close to 1 means it is scattered in many small pieces.
+		f64 fragmentation         = 0;
+
+		// Only filled in for pool allocators.
+		u32 num_segments          = 0;
+		PoolSegmentStats segments[MAX_POOL_SEGMENTS];
+
+		// Counters.
+		size_t peak_bytes_in_use  = 0;
+		u64 allocation_count      = 0;
+		u64 live_allocations      = 0;
+		u64 failed_allocations    = 0;
+
+		// Bucket i counts the allocations that were requested with at most 2^i bytes and more than 2^(i - 1) bytes. The last bucket also counts every larger allocation.
+		u64 size_histogram[ALLOCATOR_STATS_HISTOGRAM_BUCKETS] = {};
+	};
+
+	/**
+	 * Copy the counters that are kept when `VULTR_ALLOCATOR_STATS` is defined into a stats snapshot, and work out the fragmentation from the free memory fields.
+	 * Used by the allocator specific stats functions after they've filled in the rest.
+	 */
+	inline void fill_allocator_stats(Allocator *allocator, AllocatorStats *stats)
+	{
+		stats->type          = allocator->type;
+		stats->fragmentation = stats->free_bytes > 0 ? 1.0 - static_cast<f64>(stats->largest_free_block) / static_cast<f64>(stats->free_bytes) : 0;
+
+#ifdef VULTR_ALLOCATOR_STATS
+		auto *counters            = &allocator->counters;
+		stats->peak_bytes_in_use  = counters->peak_bytes_in_use.load(std::memory_order_relaxed);
+		stats->allocation_count   = counters->allocation_count.load(std::memory_order_relaxed);
+		stats->live_allocations   = counters->live_allocations.load(std::memory_order_relaxed);
+		stats->failed_allocations = counters->failed_allocations.load(std::memory_order_relaxed);
+		for (u32 i = 0; i < ALLOCATOR_STATS_HISTOGRAM_BUCKETS; i++)
+		{
+			stats->size_histogram[i] = counters->size_histogram[i].load(std::memory_order_relaxed);
+		}
+#endif
+	}
+} // namespace Vultr
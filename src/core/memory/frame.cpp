@@ -0,0 +1,96 @@
+#include "frame.h"
+#include "allocator_stats.h"
+
+namespace Vultr
+{
+	FrameAllocator *init_frame_allocator(MemoryArena *arena, size_t frame_size, u32 frame_count)
+	{
+		ASSERT(frame_count > 0 && frame_count <= MAX_FRAME_ALLOCATOR_FRAMES, "Frame allocator must have between 1 and MAX_FRAME_ALLOCATOR_FRAMES frames!");
+
+		// Every frame buffer starts aligned so that aligned allocations don't waste more space in some frames than others.
+		frame_size = (frame_size + 15) & ~(size_t)15;
+
+		// Designate a region within the memory arena for our allocator.
+		// Only the header is committed right away, the frame buffers are committed as they are used.
+		size_t header_size = sizeof(FrameAllocator) + 16;
+		auto *allocator    = static_cast<FrameAllocator *>(mem_arena_designate(arena, AllocatorType::Frame, header_size + frame_size * frame_count, header_size));
+
+		// If we were unable to allocate the required size, then there is nothing to do.
+		if (allocator == nullptr)
+			return nullptr;
+
+		new (allocator) FrameAllocator();
+		allocator->frame_count = frame_count;
+		allocator->frame_size  = frame_size;
+		allocator->arena       = arena;
+
+		// The frame buffers will come one after another after the allocator.
+		auto *start = static_cast<byte *>(align_forward(allocator + 1, 16));
+		for (u32 i = 0; i < frame_count; i++)
+		{
+			allocator->frames[i].start     = start + i * frame_size;
+			allocator->frames[i].committed = arena->flags & MEM_ARENA_RESERVE_ONLY ? 0 : frame_size;
+		}
+
+		return allocator;
+	}
+
+	void *frame_allocator_alloc(FrameAllocator *allocator, size_t size, size_t alignment)
+	{
+		ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0, "Frame allocation alignment must be a power of 2!");
+
+		auto *frame = &allocator->frames[allocator->current];
+		auto *data  = static_cast<byte *>(align_forward(frame->start + frame->used, alignment));
+		size_t used = (data - frame->start) + size;
+
+		// If there isn't enough space then there is nothing to do.
+		if (used > allocator->frame_size || !mem_arena_commit_to(allocator->arena, frame->start, &frame->committed, used, allocator->frame_size))
+		{
+			allocator->stats.failed_allocations++;
+			allocator_stats_failure(allocator);
+			return nullptr;
+		}
+
+		allocator_stats_alloc(allocator, size, used - frame->used);
+#ifdef VULTR_ALLOCATOR_STATS
+		frame->allocation_count++;
+#endif
+
+		frame->used = used;
+		return data;
+	}
+
+	void frame_allocator_rotate(FrameAllocator *allocator)
+	{
+		auto *stats            = &allocator->stats;
+		size_t used            = allocator->frames[allocator->current].used;
+		stats->last_frame_used = used;
+		stats->high_water      = MAX(stats->high_water, used);
+		stats->frame_count++;
+
+		// The next buffer in the ring was last written `frame_count` frames ago, so nobody can be using it anymore.
+		allocator->current = (allocator->current + 1) % allocator->frame_count;
+		auto *frame        = &allocator->frames[allocator->current];
+
+#ifdef VULTR_ALLOCATOR_STATS
+		allocator_stats_free(allocator, frame->used, frame->allocation_count);
+		frame->allocation_count = 0;
+#endif
+
+		frame->used = 0;
+	}
+
+	void frame_allocator_get_stats(FrameAllocator *allocator, AllocatorStats *stats)
+	{
+		*stats          = {};
+		stats->capacity = allocator->frame_size * allocator->frame_count;
+		for (u32 i = 0; i < allocator->frame_count; i++)
+		{
+			stats->bytes_in_use += allocator->frames[i].used;
+		}
+		stats->free_bytes         = allocator->frame_size - allocator->frames[allocator->current].used;
+		stats->free_block_count   = stats->free_bytes > 0 ? 1 : 0;
+		stats->largest_free_block = stats->free_bytes;
+		fill_allocator_stats(allocator, stats);
+	}
+} // namespace Vultr
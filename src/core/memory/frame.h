@@ -0,0 +1,115 @@
+#pragma once
+#include <types/types.h>
+#include "vultr_memory_internal.h"
+
+namespace Vultr
+{
+#ifndef MAX_FRAME_ALLOCATOR_FRAMES
+	/**
+	 * The maximum number of frames a frame allocator can keep memory alive for.
+	 */
+#define MAX_FRAME_ALLOCATOR_FRAMES 4
+#endif
+
+	/**
+	 * The linear buffer belonging to a single frame in flight.
+	 */
+	struct FrameBuffer
+	{
+		byte *start = nullptr;
+		size_t used = 0;
+
+		// How many bytes of the buffer are backed by physical memory, which only grows past the frame size up front if the arena is `MEM_ARENA_RESERVE_ONLY`.
+		size_t committed = 0;
+
+#ifdef VULTR_ALLOCATOR_STATS
+		u64 allocation_count = 0;
+#endif
+	};
+
+	/**
+	 * Statistics collected by a frame allocator that can be used to figure out how big its frames need to be.
+	 */
+	struct FrameAllocatorStats
+	{
+		// The number of bytes allocated in the last completed frame.
+		size_t last_frame_used = 0;
+
+		// The most bytes allocated in any single frame since the allocator was initialized.
+		size_t high_water = 0;
+
+		// The number of allocations that failed because a frame ran out of space.
+		u64 failed_allocations = 0;
+
+		// The number of frames completed.
+		u64 frame_count = 0;
+	};
+
+	/**
+	 * Allocator which hands out memory that lives for a fixed number of frames. It is a ring of linear allocators, one per frame in flight.
+	 * When the ring is rotated at a frame boundary, the buffer that was written `frame_count` frames ago is freed all at once in O(1) and reused.
+	 */
+	struct FrameAllocator : public Allocator
+	{
+		FrameBuffer frames[MAX_FRAME_ALLOCATOR_FRAMES];
+		u32 frame_count           = 0;
+		u32 current               = 0;
+		size_t frame_size         = 0;
+		FrameAllocatorStats stats = {};
+		MemoryArena *arena        = nullptr;
+
+		FrameAllocator() : Allocator(AllocatorType::Frame) {}
+	};
+
+	/**
+	 * Initialize a new frame allocator. This allocator is best used for temporary data that is produced in one frame and consumed in the next, for example by the render thread.
+	 * This allocator has no memory fragmentation and is very fast but all memory allocated during a frame is freed at once `frame_count` frames later.
+	 * In an arena that is `MEM_ARENA_RESERVE_ONLY`, each frame buffer is committed as it is used so a generous frame size costs nothing until it is needed.
+	 *
+	 * @param MemoryArena *arena: The memory arena to create the allocator from.
+	 * @param size_t frame_size: The number of bytes that can be allocated during a single frame.
+	 * @param u32 frame_count: The number of frames memory stays valid for, typically 2 or 3. This can be at most `MAX_FRAME_ALLOCATOR_FRAMES`.
+	 *
+	 * @return FrameAllocator *: The allocator which can be now be used.
+	 *
+	 * @error The method will return nullptr if the memory arena has run out of memory and cannot allocate.
+	 *
+	 * @no_thread_safety
+	 */
+	FrameAllocator *init_frame_allocator(MemoryArena *arena, size_t frame_size, u32 frame_count);
+
+	/**
+	 * Allocate a chunk of memory for the current frame using a frame allocator.
+	 *
+	 * @param FrameAllocator *allocator: The allocator to use.
+	 * @param size_t size: The size of memory to allocate.
+	 * @param size_t alignment: The alignment of the returned memory, must be a power of 2.
+	 *
+	 * @return void *: The memory that can now be used until the allocator has been rotated `frame_count` times.
+	 *
+	 * @error The method will return nullptr if the current frame doesn't have enough space to allocate or the memory could not be committed.
+	 *
+	 * @no_thread_safety
+	 */
+	void *frame_allocator_alloc(FrameAllocator *allocator, size_t size, size_t alignment = 16);
+
+	/**
+	 * Finish the current frame and move on to the next buffer in the ring, freeing everything that was allocated in it `frame_count` frames ago.
+	 * This should be called once at every frame boundary.
+	 *
+	 * @param FrameAllocator *allocator: The allocator to rotate.
+	 *
+	 * @no_thread_safety
+	 */
+	void frame_allocator_rotate(FrameAllocator *allocator);
+
+	/**
+	 * Get statistics about the memory usage of a frame allocator. Only the current frame has free memory, the bytes in use are summed over all frames in flight.
+	 *
+	 * @param FrameAllocator *allocator: The allocator to inspect.
+	 * @param AllocatorStats *stats: The stats to fill in.
+	 *
+	 * @no_thread_safety
+	 */
+	void frame_allocator_get_stats(FrameAllocator *allocator, AllocatorStats *stats);
+} // namespace Vultr
@@ -1,5 +1,7 @@
 #include "free_list.h"
+#include "allocator_stats.h"
 #include <types/types.h>
+#include <bit>
 
 namespace Vultr
 {
@@ -16,6 +18,13 @@ namespace Vultr
 		FreeListMemoryBlock *center = nullptr;
 	};
 
+	// Free memory blocks tracked by the two level segregated fit backend are in a doubly linked list with the other blocks of their size class.
+	struct SegregatedFreeMemory
+	{
+		FreeListMemoryBlock *prev_free = nullptr;
+		FreeListMemoryBlock *next_free = nullptr;
+	};
+
 	/*
 	 * Present at the beginning of every block of memory
 	 * Size: (64-bit) Allocated: 24 bytes, Free: 48 bytes.
@@ -35,6 +44,7 @@ namespace Vultr
 		union {
 			AllocatedMemory allocated;
 			FreeMemory free;
+			SegregatedFreeMemory segregated;
 		};
 	};
 
@@ -266,11 +276,135 @@ namespace Vultr
 		}
 	}
 
+	// Two level segregated fit:
+	// Free blocks are put into lists by size class. The first level splits sizes by powers of 2 and the second level splits every power of 2 into `TLSF_SECOND_LEVEL_COUNT` linear steps.
+	// A bitmap of which lists are non-empty lets us find the smallest non-empty class that fits a request with a couple of bit scans instead of a search.
+	//
+	// fl = first level
+	// sl = second level
+	static void tlsf_mapping(size_t size, u32 *fl, u32 *sl)
+	{
+		if (size < (1ULL << TLSF_FIRST_LEVEL_SHIFT))
+		{
+			*fl = 0;
+			*sl = size / ((1ULL << TLSF_FIRST_LEVEL_SHIFT) / TLSF_SECOND_LEVEL_COUNT);
+		}
+		else
+		{
+			u32 log2 = std::bit_width(size) - 1;
+			*sl      = (size >> (log2 - TLSF_SECOND_LEVEL_LOG2)) ^ (1 << TLSF_SECOND_LEVEL_LOG2);
+			*fl      = log2 - TLSF_FIRST_LEVEL_SHIFT + 1;
+		}
+	}
+
+	// Round a requested size up to the next size class, so that any block in the class it maps to is large enough.
+	static size_t tlsf_round_up(size_t size)
+	{
+		if (size < (1ULL << TLSF_FIRST_LEVEL_SHIFT))
+			return size;
+
+		return size + (1ULL << (std::bit_width(size) - 1 - TLSF_SECOND_LEVEL_LOG2)) - 1;
+	}
+
+	static void tlsf_insert(FreeListAllocator *allocator, FreeListMemoryBlock *block)
+	{
+		u32 fl, sl;
+		tlsf_mapping(get_mb_size(block), &fl, &sl);
+
+		auto *head                  = allocator->tlsf_free_lists[fl][sl];
+		block->segregated.prev_free = nullptr;
+		block->segregated.next_free = head;
+		if (head != nullptr)
+		{
+			head->segregated.prev_free = block;
+		}
+
+		allocator->tlsf_free_lists[fl][sl] = block;
+		allocator->tlsf_first_level_bitmap |= 1ULL << fl;
+		allocator->tlsf_second_level_bitmaps[fl] |= 1U << sl;
+	}
+
+	static void tlsf_remove(FreeListAllocator *allocator, FreeListMemoryBlock *block)
+	{
+		u32 fl, sl;
+		tlsf_mapping(get_mb_size(block), &fl, &sl);
+
+		auto *prev = block->segregated.prev_free;
+		auto *next = block->segregated.next_free;
+		if (next != nullptr)
+		{
+			next->segregated.prev_free = prev;
+		}
+
+		if (prev != nullptr)
+		{
+			prev->segregated.next_free = next;
+		}
+		else
+		{
+			allocator->tlsf_free_lists[fl][sl] = next;
+
+			// If the list is now empty, then the bitmaps need to reflect that.
+			if (next == nullptr)
+			{
+				allocator->tlsf_second_level_bitmaps[fl] &= ~(1U << sl);
+				if (allocator->tlsf_second_level_bitmaps[fl] == 0)
+				{
+					allocator->tlsf_first_level_bitmap &= ~(1ULL << fl);
+				}
+			}
+		}
+	}
+
+	static FreeListMemoryBlock *tlsf_best_match(FreeListAllocator *allocator, size_t size)
+	{
+		u32 fl, sl;
+		tlsf_mapping(tlsf_round_up(size), &fl, &sl);
+
+		if (fl < TLSF_FIRST_LEVEL_COUNT)
+		{
+			// Look for a non-empty list in the same power of 2 first, and if there is none take the smallest non-empty list of a larger power of 2.
+			u32 sl_map = allocator->tlsf_second_level_bitmaps[fl] & (~0U << sl);
+			if (sl_map == 0)
+			{
+				u64 fl_map = allocator->tlsf_first_level_bitmap & (~0ULL << (fl + 1));
+				if (fl_map != 0)
+				{
+					fl     = std::countr_zero(fl_map);
+					sl_map = allocator->tlsf_second_level_bitmaps[fl];
+				}
+			}
+
+			if (sl_map != 0)
+			{
+				return allocator->tlsf_free_lists[fl][std::countr_zero(sl_map)];
+			}
+		}
+
+		// Rounding up skips over the class the requested size itself falls into, which might hold the only blocks that are large enough.
+		tlsf_mapping(size, &fl, &sl);
+		for (auto *block = allocator->tlsf_free_lists[fl][sl]; block != nullptr; block = block->segregated.next_free)
+		{
+			if (get_mb_size(block) >= size)
+			{
+				return block;
+			}
+		}
+
+		return nullptr;
+	}
+
 	static void rbt_insert(FreeListAllocator *allocator, FreeListMemoryBlock *n);
 	static void insert_free_mb(FreeListAllocator *allocator, FreeListMemoryBlock *block)
 	{
 		ASSERT_MB_INITIALIZED(block);
 		ASSERT_MB_FREE(block);
+		if (allocator->backend == FreeListBackend::TwoLevelSegregatedFit)
+		{
+			tlsf_insert(allocator, block);
+			return;
+		}
+
 		rbt_insert(allocator, block);
 		ASSERT(allocator->free_root != nullptr, "Something went wrong inserting memory block!");
 		set_mb_black(allocator->free_root);
@@ -281,6 +415,54 @@ namespace Vultr
 	{
 		ASSERT_MB_INITIALIZED(block);
 		ASSERT_MB_FREE(block);
+		if (allocator->backend == FreeListBackend::TwoLevelSegregatedFit)
+		{
+			tlsf_remove(allocator, block);
+			return;
+		}
+
+		// Blocks of the same size hang off of a single tree node in its center list, so find the node that holds this size first.
+		auto *h     = allocator->free_root;
+		size_t size = get_mb_size(block);
+		while (h != nullptr && get_mb_size(h) != size)
+		{
+			h = size < get_mb_size(h) ? get_left(h) : get_right(h);
+		}
+		ASSERT(h != nullptr, "Memory block is not in the free tree!");
+
+		if (h != block)
+		{
+			// The block is somewhere in the center list, so just unlink it without touching the tree.
+			find_remove_center(h, block);
+			return;
+		}
+
+		if (get_center(block) != nullptr)
+		{
+			// Promote the first block of the center list into this node's spot in the tree, so the tree shape and colors don't change.
+			auto *c      = remove_center(block);
+			auto *parent = get_parent(block);
+			if (parent == nullptr)
+			{
+				allocator->free_root = c;
+			}
+			else if (is_left_child(block))
+			{
+				assign_left(parent, c);
+			}
+			else
+			{
+				assign_right(parent, c);
+			}
+			assign_parent(c, parent);
+			assign_left(c, get_left(block));
+			assign_right(c, get_right(block));
+			set_mb_color(c, is_red(block));
+			assign_center(c, get_center(block));
+			assign_center(block, nullptr);
+			return;
+		}
+
 		rbt_delete(allocator, block);
 		if (allocator->free_root != nullptr)
 		{
@@ -288,31 +470,21 @@ namespace Vultr
 		}
 	}
 
-	static FreeListMemoryBlock *mb_best_match(FreeListMemoryBlock *h, size_t size)
+	static FreeListMemoryBlock *rbt_best_match(FreeListMemoryBlock *h, size_t size, FreeListMemoryBlock *best = nullptr)
 	{
-		// If h is a leaf, then we can assume it is the closest block to the size we need so we can just split it
-
+		// Once we fall off the tree, the smallest block we passed that was still large enough is the best match. If there was none, then the requested allocation size is impossible.
 		if (h == nullptr)
-			return nullptr;
+			return best;
 
 		if (size < get_mb_size(h))
 		{
-			auto *l = get_left(h);
-			// If there is no block that exists of a smaller size, then we should just return the current node, `h` and we will split that later.
-			if (l == nullptr)
-				return h;
-
-			return mb_best_match(l, size);
+			// This block fits, but there might still be a smaller one that fits to the left.
+			return rbt_best_match(get_left(h), size, h);
 		}
 		else if (size > get_mb_size(h))
 		{
-			auto *r = get_right(h);
-
-			// If there is no block that exists of a larger size, then the requested allocation size is impossible. Thus we must return nullptr.
-			if (r == nullptr)
-				return nullptr;
-
-			return mb_best_match(r, size);
+			// This block is too small, so only the larger blocks to the right can fit.
+			return rbt_best_match(get_right(h), size, best);
 		}
 		else // if(size == get_mb_size(h))
 		{
@@ -320,6 +492,18 @@ namespace Vultr
 		}
 	}
 
+	static FreeListMemoryBlock *mb_best_match(FreeListAllocator *allocator, size_t size)
+	{
+		if (allocator->backend == FreeListBackend::TwoLevelSegregatedFit)
+		{
+			return tlsf_best_match(allocator, size);
+		}
+		else
+		{
+			return rbt_best_match(allocator->free_root, size);
+		}
+	}
+
 	static u32 get_height(FreeListMemoryBlock *h)
 	{
 		if (h == nullptr)
@@ -357,18 +541,24 @@ namespace Vultr
 		block->free.right  = nullptr;
 	}
 
-	FreeListAllocator *init_free_list_allocator(MemoryArena *arena, size_t size, u8 alignment)
+	FreeListAllocator *init_free_list_allocator(MemoryArena *arena, size_t size, u8 alignment, FreeListBackend backend)
 	{
 		// Designate a region within the memory arena for our allocator.
-		auto *allocator = static_cast<FreeListAllocator *>(mem_arena_designate(arena, AllocatorType::FreeList, size + sizeof(FreeListAllocator)));
-		allocator->type = AllocatorType::FreeList;
+		// Only the header and the first block header are committed right away, the rest is committed as blocks are handed out.
+		auto *allocator = static_cast<FreeListAllocator *>(mem_arena_designate(arena, AllocatorType::FreeList, size + sizeof(FreeListAllocator), sizeof(FreeListAllocator) + sizeof(FreeListMemoryBlock)));
 
 		// If we were unable to allocate the required size, then there is nothing to do.
 		if (allocator == nullptr)
 			return nullptr;
 
-		// Set up the alignment.
+		new (allocator) FreeListAllocator();
+
+		// Set up the alignment and the way free blocks are tracked.
 		allocator->alignment = alignment;
+		allocator->backend   = backend;
+		allocator->arena     = arena;
+		allocator->size      = size;
+		allocator->committed = arena->flags & MEM_ARENA_RESERVE_ONLY ? sizeof(FreeListMemoryBlock) : size;
 
 		// The head block will come after the memory allocator.
 		allocator->block_head = reinterpret_cast<FreeListMemoryBlock *>(reinterpret_cast<byte *>(allocator) + sizeof(FreeListAllocator));
@@ -390,8 +580,8 @@ namespace Vultr
 		{
 			return nullptr;
 		}
-		u32 lowest_bits = b->size & LOWEST_3_BITS;
-		u32 old_size    = get_mb_size(b);
+		size_t lowest_bits = b->size & LOWEST_3_BITS;
+		size_t old_size    = get_mb_size(b);
 
 		// If this block is not big enough to be split into another smaller memory block, don't bother...
 		// TODO(Brandon): Add test case for this.
@@ -405,11 +595,16 @@ namespace Vultr
 		FreeListMemoryBlock *new_block = reinterpret_cast<FreeListMemoryBlock *>(reinterpret_cast<byte *>(b) + new_size + HEADER_SIZE);
 		init_free_mb(new_block, old_size - new_size - HEADER_SIZE, b, b->next);
 
+		if (b->next != nullptr)
+		{
+			b->next->prev = new_block;
+		}
 		b->next = new_block;
 		return new_block;
 	}
 
-	static void coalesce_mbs(FreeListAllocator *allocator, FreeListMemoryBlock *b)
+	// Returns the free block that `b` ended up being merged into.
+	static FreeListMemoryBlock *coalesce_mbs(FreeListAllocator *allocator, FreeListMemoryBlock *b)
 	{
 		auto *prev     = b->prev;
 		auto prev_size = b->prev ? get_mb_size(prev) : 0;
@@ -430,6 +625,7 @@ namespace Vultr
 			{
 				next->next->prev = prev;
 			}
+			return prev;
 		}
 		else if (mb_is_free(prev))
 		{
@@ -443,6 +639,7 @@ namespace Vultr
 			{
 				next->prev = prev;
 			}
+			return prev;
 		}
 		else if (mb_is_free(next))
 		{
@@ -452,24 +649,39 @@ namespace Vultr
 			init_free_mb(b, new_size, prev, next->next);
 			insert_free_mb(allocator, b);
 
-			if (prev != nullptr)
+			if (next->next != nullptr)
 			{
-				prev->next = b;
+				next->next->prev = b;
 			}
+			return b;
 		}
 		else
 		{
 			insert_free_mb(allocator, b);
+			return b;
 		}
 	}
 
+	// Make sure a block is committed up to `size` bytes of data, along with the header of the free block that could be split off after it.
+	static bool commit_mb(FreeListAllocator *allocator, FreeListMemoryBlock *block, size_t size)
+	{
+		auto *start = reinterpret_cast<byte *>(allocator + 1);
+		size_t used = reinterpret_cast<byte *>(block) + HEADER_SIZE + size + sizeof(FreeListMemoryBlock) - start;
+		return mem_arena_commit_to(allocator->arena, start, &allocator->committed, MIN(used, allocator->size), allocator->size);
+	}
+
 	// TODO(Brandon): Add lots of error messages to make sure this isn't misused.
 	void *free_list_alloc(FreeListAllocator *allocator, size_t size)
 	{
-		size = align(size, allocator->alignment);
+		size_t requested_size = size;
+		size                  = align(size, allocator->alignment);
 		// Find a memory block of suitable size.
-		auto *best_match = mb_best_match(allocator->free_root, size);
-		PRODUCTION_ASSERT(best_match != nullptr, "Not enough memory to allocate!");
+		auto *best_match      = mb_best_match(allocator, size);
+		if (best_match == nullptr || !commit_mb(allocator, best_match, size))
+		{
+			allocator_stats_failure(allocator);
+			return nullptr;
+		}
 		ASSERT(get_mb_size(best_match) >= size, "");
 
 		// Delete this memory block from the red black tree.
@@ -484,33 +696,128 @@ namespace Vultr
 		}
 
 		// Set our memory block to allocated.
+		// The block can be slightly bigger than requested if the leftover was too small to split off.
 		set_mb_allocated(best_match);
-		allocator->used += size;
+		allocator->used += get_mb_size(best_match);
+		allocator_stats_alloc(allocator, requested_size, get_mb_size(best_match));
 		return reinterpret_cast<byte *>(best_match) + HEADER_SIZE;
 	}
 
+	// Give the pages in the middle of a free block back to the OS. Everything up to the end of the free block links is kept, and only whole pages are discarded so the header of the next block is safe too.
+	static size_t trim_mb(FreeListAllocator *allocator, FreeListMemoryBlock *block)
+	{
+		auto *start = reinterpret_cast<byte *>(block + 1);
+		auto *end   = reinterpret_cast<byte *>(block) + HEADER_SIZE + get_mb_size(block);
+		if (end <= start)
+			return 0;
+
+		return mem_arena_discard(allocator->arena, start, end - start);
+	}
+
+	// Trim a block that was just freed if it is at least as big as the trim threshold of the allocator.
+	static void trim_large_mb(FreeListAllocator *allocator, FreeListMemoryBlock *block)
+	{
+		if (allocator->trim_threshold != 0 && get_mb_size(block) >= allocator->trim_threshold)
+		{
+			trim_mb(allocator, block);
+		}
+	}
+
 	static FreeListMemoryBlock *get_block_from_allocated_data(void *data) { return reinterpret_cast<FreeListMemoryBlock *>(reinterpret_cast<byte *>(data) - HEADER_SIZE); }
 
-	void *free_list_realloc(FreeListAllocator *arena, void *data, size_t size)
+	// Cut a block down to `new_size` and give the tail back, merging it into the block after it if that is free.
+	static void shrink_mb(FreeListAllocator *allocator, FreeListMemoryBlock *block, size_t new_size)
+	{
+		auto *remainder = split_mb(block, new_size);
+		if (remainder == nullptr)
+			return;
+
+		trim_large_mb(allocator, coalesce_mbs(allocator, remainder));
+	}
+
+	// Merge the free block after `block` into it. The caller has to make sure it is free.
+	static void absorb_next_mb(FreeListAllocator *allocator, FreeListMemoryBlock *block)
+	{
+		auto *next = block->next;
+		remove_free_mb(allocator, next);
+		block->size = (get_mb_size(block) + HEADER_SIZE + get_mb_size(next)) | (block->size & LOWEST_3_BITS);
+		block->next = next->next;
+		if (block->next != nullptr)
+		{
+			block->next->prev = block;
+		}
+	}
+
+	void *free_list_realloc(FreeListAllocator *allocator, void *data, size_t size)
 	{
 		auto *block         = get_block_from_allocated_data(data);
 		size_t current_size = get_mb_size(block);
+		size_t new_size     = align(size, allocator->alignment);
 
+		auto *prev          = block->prev;
 		auto *next          = block->next;
-		auto next_is_free   = next ? mb_is_free(next) : false;
-		auto next_size      = next ? get_mb_size(next) : 0;
+		size_t prev_size    = mb_is_free(prev) ? get_mb_size(prev) + HEADER_SIZE : 0;
+		size_t next_size    = mb_is_free(next) ? get_mb_size(next) + HEADER_SIZE : 0;
 
-		if (next_is_free && next_size + current_size + HEADER_SIZE >= size)
+		void *new_data      = data;
+		if (new_size <= current_size)
 		{
-			return data;
+			// Shrink in place. If the tail is too small to be a block of its own, it just stays part of this one.
+			shrink_mb(allocator, block, new_size);
+		}
+		else if (current_size + next_size >= new_size)
+		{
+			// Grow into the next block without moving anything.
+			if (!commit_mb(allocator, block, new_size))
+			{
+				allocator_stats_failure(allocator);
+				return nullptr;
+			}
+			absorb_next_mb(allocator, block);
+			shrink_mb(allocator, block, new_size);
+		}
+		else if (allocator->realloc_expand_backward && prev_size + current_size + next_size >= new_size)
+		{
+			// Grow into the previous block, and the next one too if that's still not enough, then slide the data down to the start.
+			if (!commit_mb(allocator, prev, new_size))
+			{
+				allocator_stats_failure(allocator);
+				return nullptr;
+			}
+			if (current_size + prev_size < new_size)
+			{
+				absorb_next_mb(allocator, block);
+			}
+			remove_free_mb(allocator, prev);
+			prev->size = (get_mb_size(prev) + HEADER_SIZE + get_mb_size(block)) | (block->size & LOWEST_3_BITS);
+			prev->next = block->next;
+			if (prev->next != nullptr)
+			{
+				prev->next->prev = prev;
+			}
+
+			new_data = reinterpret_cast<byte *>(prev) + HEADER_SIZE;
+			memmove(new_data, data, current_size);
+			block = prev;
+			shrink_mb(allocator, block, new_size);
 		}
 		else
 		{
-			void *new_data = free_list_alloc(arena, size);
+			// There is no room around this block, so move it somewhere else.
+			new_data = free_list_alloc(allocator, size);
+			if (new_data == nullptr)
+				return nullptr;
+
 			memcpy(new_data, data, current_size);
-			free_list_free(arena, data);
+			free_list_free(allocator, data);
 			return new_data;
 		}
+
+		allocator->used += get_mb_size(block);
+		allocator->used -= current_size;
+		allocator_stats_free(allocator, current_size);
+		allocator_stats_alloc(allocator, size, get_mb_size(block));
+		return new_data;
 	}
 
 	void free_list_free(FreeListAllocator *allocator, void *data)
@@ -519,8 +826,49 @@ namespace Vultr
 		size_t size         = get_mb_size(block_to_free);
 		auto *prev          = block_to_free->prev;
 		auto *next          = block_to_free->next;
+
+		allocator->used -= size;
+		allocator_stats_free(allocator, size);
+
 		init_free_mb(block_to_free, size, prev, next);
-		coalesce_mbs(allocator, block_to_free);
+		trim_large_mb(allocator, coalesce_mbs(allocator, block_to_free));
+	}
+
+	size_t free_list_get_block_size([[maybe_unused]] FreeListAllocator *allocator, void *data)
+	{
+		ASSERT(mem_arena_get_allocator(allocator->arena, data) == allocator, "Data was not allocated from this free list allocator!");
+		return get_mb_size(get_block_from_allocated_data(data));
+	}
+
+	void free_list_get_stats(FreeListAllocator *allocator, AllocatorStats *stats)
+	{
+		*stats = {};
+		for (auto *block = allocator->block_head; block != nullptr; block = block->next)
+		{
+			size_t size = get_mb_size(block);
+			stats->capacity += size;
+			if (mb_is_free(block))
+			{
+				stats->free_bytes += size;
+				stats->free_block_count++;
+				stats->largest_free_block = MAX(stats->largest_free_block, size);
+			}
+		}
+		stats->bytes_in_use = allocator->used;
+		fill_allocator_stats(allocator, stats);
+	}
+
+	size_t free_list_trim(FreeListAllocator *allocator)
+	{
+		size_t trimmed = 0;
+		for (auto *block = allocator->block_head; block != nullptr; block = block->next)
+		{
+			if (mb_is_free(block))
+			{
+				trimmed += trim_mb(allocator, block);
+			}
+		}
+		return trimmed;
 	}
 
 	// Red-black tree rules:
@@ -857,6 +1205,7 @@ namespace Vultr
 							}
 						}
 						set_mb_black(parent);
+						return;
 					}
 					// If there are two black children...
 					else
@@ -870,6 +1219,7 @@ namespace Vultr
 						else
 						{
 							set_mb_black(parent);
+							return;
 						}
 					}
 				}
@@ -6,6 +6,24 @@ namespace Vultr
 {
 	struct FreeListMemoryBlock;
 
+	/**
+	 * The data structures a free list allocator can use to keep track of its free memory blocks.
+	 */
+	enum struct FreeListBackend : u8
+	{
+		// Best fit through a red-black tree of free blocks sorted by size. Least fragmentation but O(log n) and pointer heavy.
+		RedBlackTree          = 0x0,
+		// Good fit through two levels of segregated free lists with bitmaps (TLSF). O(1) allocations and frees with bounded fragmentation.
+		TwoLevelSegregatedFit = 0x1,
+	};
+
+	// Number of subdivisions of every power of 2 in the segregated fit backend, as a log2.
+#define TLSF_SECOND_LEVEL_LOG2 4
+#define TLSF_SECOND_LEVEL_COUNT (1 << TLSF_SECOND_LEVEL_LOG2)
+	// Blocks smaller than 2^TLSF_FIRST_LEVEL_SHIFT bytes are all kept in the first first-level list, split linearly in 8 byte steps.
+#define TLSF_FIRST_LEVEL_SHIFT (TLSF_SECOND_LEVEL_LOG2 + 3)
+#define TLSF_FIRST_LEVEL_COUNT (64 - TLSF_FIRST_LEVEL_SHIFT + 1)
+
 	/**
 	 * Memory allocator that can allocate any size with the least fragmentation possible.
 	 */
@@ -13,9 +31,29 @@ namespace Vultr
 	{
 		// TODO(Brandon): Add support for 32 bit alignment (8 bytes)
 		u8 alignment                    = 16;
+		FreeListBackend backend         = FreeListBackend::RedBlackTree;
 		FreeListMemoryBlock *free_root  = nullptr;
 		FreeListMemoryBlock *block_head = nullptr;
 		size_t used                     = 0;
+		MemoryArena *arena              = nullptr;
+
+		// The number of bytes after the allocator, and how many of them are backed by physical memory.
+		// Only the first block header is committed up front if the arena is `MEM_ARENA_RESERVE_ONLY`, the rest is committed as blocks are handed out.
+		size_t size                     = 0;
+		size_t committed                = 0;
+
+		// Free blocks at least this big after coalescing, including the tails that `free_list_realloc` cuts off, have their pages given back to the OS right away, see `free_list_trim`. 0 disables this.
+		size_t trim_threshold           = 0;
+
+		// Whether `free_list_realloc` can grow a block into the free block before it, which means moving the data down with a memmove.
+		// That is still cheaper than allocating somewhere else, and leaves less free memory scattered around.
+		bool realloc_expand_backward    = true;
+
+		// Only used by the two level segregated fit backend.
+		// A bit is set in the first level bitmap when any of the lists for that power of 2 are non-empty, and in a second level bitmap when that specific list is non-empty.
+		u64 tlsf_first_level_bitmap                                                           = 0;
+		u32 tlsf_second_level_bitmaps[TLSF_FIRST_LEVEL_COUNT]                                 = {};
+		FreeListMemoryBlock *tlsf_free_lists[TLSF_FIRST_LEVEL_COUNT][TLSF_SECOND_LEVEL_COUNT] = {};
 
 		FreeListAllocator() : Allocator(AllocatorType::FreeList) {}
 	};
@@ -23,10 +61,12 @@ namespace Vultr
 	/**
 	 * Initialize a new free list allocator. This allocator is best used for infrequent but large allocations.
 	 * This allocator reduces memory fragmentation but is very slow.
+	 * In an arena that is `MEM_ARENA_RESERVE_ONLY`, memory is committed as the allocator hands out blocks further into it so a generous size costs nothing until it is used.
 	 *
 	 * @param MemoryArena *arena: The memory arena to create the allocator from.
 	 * @param size_t size: The total size that this allocator will be able to allocate in bytes.
 	 * @param u8 alignment: The alignment of the allocator in bytes.
+	 * @param FreeListBackend backend: How free memory blocks are tracked. The segregated fit backend is much faster, the red-black tree wastes slightly less memory.
 	 *
 	 * @return FreeListAllocator *: The allocator which can be now be used.
 	 *
@@ -34,7 +74,7 @@ namespace Vultr
 	 *
 	 * @no_thread_safety
 	 */
-	FreeListAllocator *init_free_list_allocator(MemoryArena *arena, size_t size, u8 alignment);
+	FreeListAllocator *init_free_list_allocator(MemoryArena *arena, size_t size, u8 alignment, FreeListBackend backend = FreeListBackend::RedBlackTree);
 
 	/**
 	 * Allocate a chunk of memory using a free list allocator.
@@ -44,7 +84,7 @@ namespace Vultr
 	 *
 	 * @return void *: The memory that can now be used.
 	 *
-	 * @error The method will return nullptr if there is no memory chunk available to allocate.
+	 * @error The method will return nullptr if there is no memory chunk available to allocate or the memory could not be committed.
 	 *
 	 * @no_thread_safety
 	 */
@@ -52,6 +92,8 @@ namespace Vultr
 
 	/**
 	 * Resize a chunk of memory from a `FreeListAllocator`.
+	 * Shrinking and growing into a free block right after the memory never move it. Growing into a free block right before it moves it down in place if `realloc_expand_backward` is set.
+	 * Only when there isn't enough free memory around the block is it moved somewhere else.
 	 *
 	 * @param FreeListAllocator *allocator: The allocator to use.
 	 * @param void *: The old allocated block of memory.
@@ -59,7 +101,7 @@ namespace Vultr
 	 *
 	 * @return void *: The memory that can now be used.
 	 *
-	 * @error The method will return nullptr if there is no memory chunk available to allocate.
+	 * @error The method will return nullptr if there is no memory chunk available to allocate or the memory could not be committed, in which case the old memory is left untouched.
 	 *
 	 * @no_thread_safety
 	 */
@@ -74,4 +116,42 @@ namespace Vultr
 	 */
 	void free_list_free(FreeListAllocator *allocator, void *data);
 
+	/**
+	 * Get the size of the block that holds an allocation, which can be more than was asked for.
+	 *
+	 * @param FreeListAllocator *allocator: The allocator the data was allocated from.
+	 * @param void *data: The allocated data.
+	 *
+	 * @return size_t: The number of bytes that can be used at `data`.
+	 *
+	 * @error The method will assert if the data wasn't allocated from this free list.
+	 *
+	 * @no_thread_safety
+	 */
+	size_t free_list_get_block_size(FreeListAllocator *allocator, void *data);
+
+	/**
+	 * Get statistics about the memory usage and fragmentation of a free list allocator. This walks every memory block so it is O(n).
+	 * The capacity doesn't include the headers of the memory blocks, which grow with the number of blocks.
+	 *
+	 * @param FreeListAllocator *allocator: The allocator to inspect.
+	 * @param AllocatorStats *stats: The stats to fill in.
+	 *
+	 * @no_thread_safety
+	 */
+	void free_list_get_stats(FreeListAllocator *allocator, AllocatorStats *stats);
+
+	/**
+	 * Give the physical memory in the middle of every free block of a `FreeListAllocator` back to the OS, which lowers the resident memory of the program after large frees.
+	 * The headers of the blocks are kept intact and the memory is faulted back in whenever it is allocated again.
+	 * To do this automatically for every large free, set `trim_threshold` on the allocator.
+	 *
+	 * @param FreeListAllocator *allocator: The allocator to trim.
+	 *
+	 * @return size_t: The number of bytes given back to the OS.
+	 *
+	 * @no_thread_safety
+	 */
+	size_t free_list_trim(FreeListAllocator *allocator);
+
 } // namespace Vultr
@@ -0,0 +1,454 @@
+#include "heap_profiler.h"
+#include "vultr_memory_internal.h"
+#include <platform/platform.h>
+#include <stdio.h>
+
+namespace Vultr
+{
+#ifdef VULTR_HEAP_PROFILER
+	struct HeapProfilerSite
+	{
+		u64 hash  = 0;
+		u32 depth = 0;
+		void *frames[HEAP_PROFILER_MAX_FRAMES];
+
+		// Already scaled by the sample rate of each sample.
+		u64 live_count  = 0;
+		u64 live_bytes  = 0;
+		u64 total_count = 0;
+		u64 total_bytes = 0;
+	};
+
+	struct HeapProfilerSample
+	{
+		void *data  = nullptr;
+		u32 site    = 0;
+		u32 weight  = 0;
+		size_t size = 0;
+	};
+
+	/**
+	 * All of the state of the heap profiler, which lives in its own block of memory from the OS.
+	 * Both tables use open addressing with linear probing. Sites are never removed, samples are removed with backward shift deletion so that no tombstones build up.
+	 */
+	struct HeapProfiler
+	{
+		Platform::PlatformMemoryBlock *memory = nullptr;
+		SpinLock lock;
+		atomic_u32 sample_rate{HEAP_PROFILER_DEFAULT_SAMPLE_RATE};
+		u32 num_sites     = 0;
+		u32 num_samples   = 0;
+		u64 dropped_count = 0;
+		HeapProfilerSite sites[HEAP_PROFILER_MAX_SITES];
+		HeapProfilerSample samples[HEAP_PROFILER_MAX_LIVE_SAMPLES];
+		atomic_u16 filter[HEAP_PROFILER_FILTER_SIZE];
+	};
+
+	static std::atomic<HeapProfiler *> g_heap_profiler{nullptr};
+
+	// Per thread xorshift state for picking sample intervals, seeded from the address of the state itself so that threads don't sample in lockstep.
+	static thread_local u64 tl_heap_profiler_random = 0;
+
+	static u32 next_sample_interval(u32 sample_rate)
+	{
+		if (sample_rate <= 1)
+			return 1;
+
+		u64 x = tl_heap_profiler_random;
+		if (x == 0)
+		{
+			x = reinterpret_cast<uintptr_t>(&tl_heap_profiler_random) | 1;
+		}
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		tl_heap_profiler_random = x;
+
+		// Uniform over [1, 2 * sample_rate - 1] so that the mean is the sample rate without sampling every n-th allocation exactly.
+		return 1 + static_cast<u32>(x % (2 * static_cast<u64>(sample_rate) - 1));
+	}
+
+	bool heap_profiler_next_sample()
+	{
+		auto *profiler = g_heap_profiler.load(std::memory_order_acquire);
+		if (profiler == nullptr)
+		{
+			// Check back every so often in case the profiler gets started.
+			g_heap_profiler_countdown = HEAP_PROFILER_DEFAULT_SAMPLE_RATE;
+			return false;
+		}
+
+		g_heap_profiler_countdown = next_sample_interval(profiler->sample_rate.load(std::memory_order_relaxed));
+		return true;
+	}
+
+	static u64 hash_frames(void **frames, u32 depth)
+	{
+		u64 hash = 0xCBF29CE484222325ull;
+		for (u32 i = 0; i < depth; i++)
+		{
+			hash = (hash ^ reinterpret_cast<uintptr_t>(frames[i])) * 0x100000001B3ull;
+		}
+		return hash;
+	}
+
+	static u32 sample_slot(void *data) { return heap_profiler_hash(data) & (HEAP_PROFILER_MAX_LIVE_SAMPLES - 1); }
+
+	static atomic_u16 *filter_counter(HeapProfiler *profiler, void *data) { return &profiler->filter[heap_profiler_hash(data) & (HEAP_PROFILER_FILTER_SIZE - 1)]; }
+
+	static s32 find_or_insert_site(HeapProfiler *profiler, void **frames, u32 depth)
+	{
+		u64 hash = hash_frames(frames, depth);
+		for (u32 i = static_cast<u32>(hash) & (HEAP_PROFILER_MAX_SITES - 1);; i = (i + 1) & (HEAP_PROFILER_MAX_SITES - 1))
+		{
+			auto *site = &profiler->sites[i];
+			if (site->depth == 0)
+			{
+				// Keep the table at most 3/4 full so that probes stay short.
+				if (profiler->num_sites >= HEAP_PROFILER_MAX_SITES / 4 * 3)
+					return -1;
+
+				site->hash  = hash;
+				site->depth = depth;
+				memcpy(site->frames, frames, depth * sizeof(void *));
+				profiler->num_sites++;
+				return static_cast<s32>(i);
+			}
+
+			if (site->hash == hash && site->depth == depth && memcmp(site->frames, frames, depth * sizeof(void *)) == 0)
+			{
+				return static_cast<s32>(i);
+			}
+		}
+	}
+
+	void heap_profiler_sample_alloc(void *data, size_t size)
+	{
+		auto *profiler = g_heap_profiler.load(std::memory_order_acquire);
+		if (profiler == nullptr)
+			return;
+
+		// Unwinding is by far the slowest part, so do it before taking the lock.
+		void *frames[HEAP_PROFILER_MAX_FRAMES];
+		u32 depth = Platform::capture_stack_trace(frames, HEAP_PROFILER_MAX_FRAMES, 1);
+		if (depth == 0)
+			return;
+
+		u32 weight = profiler->sample_rate.load(std::memory_order_relaxed);
+
+		spin_lock(&profiler->lock);
+		s32 site_index = find_or_insert_site(profiler, frames, depth);
+		if (site_index < 0 || profiler->num_samples >= HEAP_PROFILER_MAX_LIVE_SAMPLES / 4 * 3)
+		{
+			profiler->dropped_count++;
+			spin_unlock(&profiler->lock);
+			return;
+		}
+
+		auto *site = &profiler->sites[site_index];
+		site->live_count += weight;
+		site->live_bytes += static_cast<u64>(size) * weight;
+		site->total_count += weight;
+		site->total_bytes += static_cast<u64>(size) * weight;
+
+		u32 slot = sample_slot(data);
+		while (profiler->samples[slot].data != nullptr)
+		{
+			slot = (slot + 1) & (HEAP_PROFILER_MAX_LIVE_SAMPLES - 1);
+		}
+		profiler->samples[slot] = {.data = data, .site = static_cast<u32>(site_index), .weight = weight, .size = size};
+		profiler->num_samples++;
+		filter_counter(profiler, data)->fetch_add(1, std::memory_order_relaxed);
+		spin_unlock(&profiler->lock);
+	}
+
+	static void remove_sample(HeapProfiler *profiler, u32 slot)
+	{
+		constexpr u32 mask = HEAP_PROFILER_MAX_LIVE_SAMPLES - 1;
+
+		// Shift back every sample after the hole that would no longer be found by probing from its home slot.
+		u32 hole = slot;
+		for (u32 next = (slot + 1) & mask; profiler->samples[next].data != nullptr; next = (next + 1) & mask)
+		{
+			u32 home = sample_slot(profiler->samples[next].data);
+			if (((next - home) & mask) >= ((next - hole) & mask))
+			{
+				profiler->samples[hole] = profiler->samples[next];
+				hole                    = next;
+			}
+		}
+		profiler->samples[hole] = {};
+		profiler->num_samples--;
+	}
+
+	void heap_profiler_sample_free(void *data, HeapProfilerReallocState *state)
+	{
+		auto *profiler = g_heap_profiler.load(std::memory_order_acquire);
+		if (profiler == nullptr)
+			return;
+
+		spin_lock(&profiler->lock);
+		for (u32 slot = sample_slot(data); profiler->samples[slot].data != nullptr; slot = (slot + 1) & (HEAP_PROFILER_MAX_LIVE_SAMPLES - 1))
+		{
+			auto *sample = &profiler->samples[slot];
+			if (sample->data != data)
+				continue;
+
+			auto *site = &profiler->sites[sample->site];
+			site->live_count -= sample->weight;
+			site->live_bytes -= static_cast<u64>(sample->size) * sample->weight;
+			filter_counter(profiler, data)->fetch_sub(1, std::memory_order_relaxed);
+			if (state != nullptr)
+			{
+				*state = {.site = sample->site, .weight = sample->weight, .size = sample->size};
+			}
+			remove_sample(profiler, slot);
+			break;
+		}
+		spin_unlock(&profiler->lock);
+	}
+
+	void heap_profiler_sample_restore(void *data, const HeapProfilerReallocState &state)
+	{
+		auto *profiler = g_heap_profiler.load(std::memory_order_acquire);
+		if (profiler == nullptr)
+			return;
+
+		spin_lock(&profiler->lock);
+		if (profiler->num_samples >= HEAP_PROFILER_MAX_LIVE_SAMPLES / 4 * 3)
+		{
+			profiler->dropped_count++;
+			spin_unlock(&profiler->lock);
+			return;
+		}
+
+		// Only the live counts are given back, the totals never stopped counting this sample.
+		auto *site = &profiler->sites[state.site];
+		site->live_count += state.weight;
+		site->live_bytes += static_cast<u64>(state.size) * state.weight;
+
+		u32 slot = sample_slot(data);
+		while (profiler->samples[slot].data != nullptr)
+		{
+			slot = (slot + 1) & (HEAP_PROFILER_MAX_LIVE_SAMPLES - 1);
+		}
+		profiler->samples[slot] = {.data = data, .site = state.site, .weight = state.weight, .size = state.size};
+		profiler->num_samples++;
+		filter_counter(profiler, data)->fetch_add(1, std::memory_order_relaxed);
+		spin_unlock(&profiler->lock);
+	}
+
+	bool heap_profiler_init(u32 sample_rate)
+	{
+		if (g_heap_profiler.load(std::memory_order_acquire) != nullptr)
+			return false;
+
+		auto *memory = Platform::virtual_alloc(nullptr, sizeof(HeapProfiler));
+		if (memory == nullptr)
+			return false;
+
+		auto *profiler   = new (Platform::get_memory(memory)) HeapProfiler();
+		profiler->memory = memory;
+		profiler->sample_rate.store(MAX(sample_rate, 1u), std::memory_order_relaxed);
+		spin_lock_init(&profiler->lock);
+
+		// Warm up the unwinder, which can allocate the first time it is used.
+		void *frames[HEAP_PROFILER_MAX_FRAMES];
+		Platform::capture_stack_trace(frames, HEAP_PROFILER_MAX_FRAMES);
+
+		g_heap_profiler.store(profiler, std::memory_order_release);
+		g_heap_profiler_filter.store(profiler->filter, std::memory_order_release);
+
+		// Start sampling on this thread right away instead of after the countdown from before the profiler was running.
+		g_heap_profiler_countdown = next_sample_interval(sample_rate);
+		return true;
+	}
+
+	void heap_profiler_destroy()
+	{
+		auto *profiler = g_heap_profiler.load(std::memory_order_acquire);
+		if (profiler == nullptr)
+			return;
+
+		g_heap_profiler_filter.store(nullptr, std::memory_order_release);
+		g_heap_profiler.store(nullptr, std::memory_order_release);
+		Platform::virtual_free(profiler->memory);
+	}
+
+	void heap_profiler_set_sample_rate(u32 sample_rate)
+	{
+		auto *profiler = g_heap_profiler.load(std::memory_order_acquire);
+		if (profiler != nullptr)
+		{
+			profiler->sample_rate.store(MAX(sample_rate, 1u), std::memory_order_relaxed);
+		}
+	}
+
+	void heap_profiler_get_totals(HeapProfilerTotals *totals)
+	{
+		*totals        = {};
+		auto *profiler = g_heap_profiler.load(std::memory_order_acquire);
+		if (profiler == nullptr)
+			return;
+
+		spin_lock(&profiler->lock);
+		for (auto &site : profiler->sites)
+		{
+			totals->live_count += site.live_count;
+			totals->live_bytes += site.live_bytes;
+			totals->total_count += site.total_count;
+			totals->total_bytes += site.total_bytes;
+		}
+		totals->dropped_count = profiler->dropped_count;
+		spin_unlock(&profiler->lock);
+	}
+
+	/**
+	 * Copy out every recorded site so that files can be written and symbols looked up without holding the lock, which would stall sampled allocations on other threads.
+	 * The copy is allocated from the OS just like the profiler itself and must be freed with `Platform::virtual_free`.
+	 */
+	static Platform::PlatformMemoryBlock *copy_sites(HeapProfiler *profiler, HeapProfilerSite **sites, u32 *count)
+	{
+		auto *memory = Platform::virtual_alloc(nullptr, sizeof(HeapProfilerSite) * HEAP_PROFILER_MAX_SITES);
+		if (memory == nullptr)
+			return nullptr;
+
+		*sites = static_cast<HeapProfilerSite *>(Platform::get_memory(memory));
+		*count = 0;
+
+		spin_lock(&profiler->lock);
+		for (auto &site : profiler->sites)
+		{
+			if (site.depth != 0)
+			{
+				(*sites)[*count] = site;
+				(*count)++;
+			}
+		}
+		spin_unlock(&profiler->lock);
+		return memory;
+	}
+
+	bool heap_profiler_dump_pprof(const char *path)
+	{
+		auto *profiler = g_heap_profiler.load(std::memory_order_acquire);
+		if (profiler == nullptr)
+			return false;
+
+		HeapProfilerSite *sites = nullptr;
+		u32 count               = 0;
+		auto *memory            = copy_sites(profiler, &sites, &count);
+		if (memory == nullptr)
+			return false;
+
+		FILE *f = fopen(path, "w");
+		if (f == nullptr)
+		{
+			Platform::virtual_free(memory);
+			return false;
+		}
+
+		HeapProfilerTotals totals{};
+		for (u32 i = 0; i < count; i++)
+		{
+			totals.live_count += sites[i].live_count;
+			totals.live_bytes += sites[i].live_bytes;
+			totals.total_count += sites[i].total_count;
+			totals.total_bytes += sites[i].total_bytes;
+		}
+
+		// The counts are already scaled by the sample rate, so this is written as an unsampled profile.
+		fprintf(f, "heap profile: %llu: %llu [%llu: %llu] @ heapprofile\n", (unsigned long long)totals.live_count, (unsigned long long)totals.live_bytes, (unsigned long long)totals.total_count,
+		        (unsigned long long)totals.total_bytes);
+		for (u32 i = 0; i < count; i++)
+		{
+			auto *site = &sites[i];
+			fprintf(f, "%llu: %llu [%llu: %llu] @", (unsigned long long)site->live_count, (unsigned long long)site->live_bytes, (unsigned long long)site->total_count,
+			        (unsigned long long)site->total_bytes);
+			for (u32 j = 0; j < site->depth; j++)
+			{
+				fprintf(f, " %p", site->frames[j]);
+			}
+			fprintf(f, "\n");
+		}
+
+		// pprof needs to know where every module was loaded to map the addresses back to symbols.
+#ifdef __linux__
+		fprintf(f, "\nMAPPED_LIBRARIES:\n");
+		FILE *maps = fopen("/proc/self/maps", "r");
+		if (maps != nullptr)
+		{
+			char buffer[4096];
+			size_t read = 0;
+			while ((read = fread(buffer, 1, sizeof(buffer), maps)) > 0)
+			{
+				fwrite(buffer, 1, read, f);
+			}
+			fclose(maps);
+		}
+#endif
+
+		bool success = ferror(f) == 0;
+		fclose(f);
+		Platform::virtual_free(memory);
+		return success;
+	}
+
+	bool heap_profiler_dump_collapsed(const char *path)
+	{
+		auto *profiler = g_heap_profiler.load(std::memory_order_acquire);
+		if (profiler == nullptr)
+			return false;
+
+		HeapProfilerSite *sites = nullptr;
+		u32 count               = 0;
+		auto *memory            = copy_sites(profiler, &sites, &count);
+		if (memory == nullptr)
+			return false;
+
+		FILE *f = fopen(path, "w");
+		if (f == nullptr)
+		{
+			Platform::virtual_free(memory);
+			return false;
+		}
+
+		char symbol[512];
+		for (u32 i = 0; i < count; i++)
+		{
+			auto *site = &sites[i];
+			if (site->live_bytes == 0)
+				continue;
+
+			// Frames are captured innermost first, collapsed stacks are written outermost first.
+			for (s32 j = static_cast<s32>(site->depth) - 1; j >= 0; j--)
+			{
+				Platform::get_symbol_name(site->frames[j], symbol, sizeof(symbol));
+
+				// Semicolons separate frames, so they can't show up in a frame name.
+				for (char *c = symbol; *c != '\0'; c++)
+				{
+					if (*c == ';')
+					{
+						*c = '_';
+					}
+				}
+				fprintf(f, j == 0 ? "%s" : "%s;", symbol);
+			}
+			fprintf(f, " %llu\n", (unsigned long long)site->live_bytes);
+		}
+
+		bool success = ferror(f) == 0;
+		fclose(f);
+		Platform::virtual_free(memory);
+		return success;
+	}
+#else
+	bool heap_profiler_init(u32) { return false; }
+	void heap_profiler_destroy() {}
+	void heap_profiler_set_sample_rate(u32) {}
+	void heap_profiler_get_totals(HeapProfilerTotals *totals) { *totals = {}; }
+	bool heap_profiler_dump_pprof(const char *) { return false; }
+	bool heap_profiler_dump_collapsed(const char *) { return false; }
+#endif
+} // namespace Vultr
@@ -0,0 +1,189 @@
+#pragma once
+#include <types/types.h>
+
+namespace Vultr
+{
+#ifndef HEAP_PROFILER_MAX_FRAMES
+	/**
+	 * The number of return addresses captured for every sampled allocation.
+	 */
+#define HEAP_PROFILER_MAX_FRAMES 24
+#endif
+
+#ifndef HEAP_PROFILER_MAX_SITES
+	/**
+	 * The maximum number of distinct call sites the heap profiler can keep track of, must be a power of 2.
+	 */
+#define HEAP_PROFILER_MAX_SITES 8192
+#endif
+
+#ifndef HEAP_PROFILER_MAX_LIVE_SAMPLES
+	/**
+	 * The maximum number of sampled allocations that can be alive at once, must be a power of 2.
+	 */
+#define HEAP_PROFILER_MAX_LIVE_SAMPLES 65536
+#endif
+
+#ifndef HEAP_PROFILER_DEFAULT_SAMPLE_RATE
+	/**
+	 * On average one in this many allocations is sampled by default.
+	 */
+#define HEAP_PROFILER_DEFAULT_SAMPLE_RATE 512
+#endif
+
+	/**
+	 * Estimated totals over every call site. Every sample stands in for `sample_rate` allocations, so these are estimates unless the sample rate is 1.
+	 */
+	struct HeapProfilerTotals
+	{
+		u64 live_count    = 0;
+		u64 live_bytes    = 0;
+		u64 total_count   = 0;
+		u64 total_bytes   = 0;
+
+		// Samples that were thrown away because the call site or live sample tables were full.
+		u64 dropped_count = 0;
+	};
+
+	/**
+	 * Start the sampling heap profiler, which records allocations made through `malloc`, `mrealloc`, `mfree` and `alloc<T>` of any allocator.
+	 * For one in roughly `sample_rate` allocations a backtrace is captured, and the live and total bytes of its call site are updated.
+	 * Its tables are allocated directly from the OS so that they never show up in or take space from the arenas being profiled.
+	 *
+	 * The profiler is only compiled in when the engine is built with `VULTR_HEAP_PROFILER`.
+	 *
+	 * @param u32 sample_rate: On average one in this many allocations is sampled. 1 samples every allocation.
+	 *
+	 * @return bool: Whether the profiler was started.
+	 *
+	 * @error The method will return false if the profiler isn't compiled in, is already running, or its tables couldn't be allocated.
+	 *
+	 * @no_thread_safety
+	 */
+	bool heap_profiler_init(u32 sample_rate = HEAP_PROFILER_DEFAULT_SAMPLE_RATE);
+
+	/**
+	 * Stop the heap profiler and free its tables. Everything recorded so far is lost.
+	 *
+	 * @no_thread_safety This must not be called while other threads are allocating.
+	 */
+	void heap_profiler_destroy();
+
+	/**
+	 * Change how often allocations are sampled. Samples already taken keep the rate they were taken at.
+	 *
+	 * @param u32 sample_rate: On average one in this many allocations is sampled.
+	 *
+	 * @thread_safe
+	 */
+	void heap_profiler_set_sample_rate(u32 sample_rate);
+
+	/**
+	 * Get the estimated totals over every call site.
+	 *
+	 * @param HeapProfilerTotals *totals: The totals to fill in.
+	 *
+	 * @thread_safe
+	 */
+	void heap_profiler_get_totals(HeapProfilerTotals *totals);
+
+	/**
+	 * Write the recorded call sites in the legacy heap profile format that pprof understands, for example with `pprof --http=: <executable> <path>`.
+	 * Both the live and the total allocations of every site are written.
+	 * The list of loaded modules that pprof needs to symbolize the addresses is only written on Linux. Profiles written on Windows only have raw addresses.
+	 *
+	 * @param const char *path: The file to write to.
+	 *
+	 * @return bool: Whether the profile was written.
+	 *
+	 * @thread_safe
+	 */
+	bool heap_profiler_dump_pprof(const char *path);
+
+	/**
+	 * Write the live bytes of the recorded call sites as collapsed stacks, one `outermost;...;innermost bytes` line per site.
+	 * This is the input format of flamegraph.pl and speedscope.
+	 *
+	 * @param const char *path: The file to write to.
+	 *
+	 * @return bool: Whether the profile was written.
+	 *
+	 * @thread_safe
+	 */
+	bool heap_profiler_dump_collapsed(const char *path);
+
+#ifndef HEAP_PROFILER_FILTER_SIZE
+	/**
+	 * The number of counters used to quickly rule out frees of memory that wasn't sampled, must be a power of 2.
+	 */
+#define HEAP_PROFILER_FILTER_SIZE 65536
+#endif
+
+	/**
+	 * The sample of a block that is being reallocated, which is put back as it was if reallocating fails. A weight of 0 means the block wasn't sampled.
+	 */
+	struct HeapProfilerReallocState
+	{
+		u32 site    = 0;
+		u32 weight  = 0;
+		size_t size = 0;
+	};
+
+#ifdef VULTR_HEAP_PROFILER
+	// Number of allocations this thread can make before the next one is sampled.
+	inline thread_local s64 g_heap_profiler_countdown = 0;
+
+	// Number of live samples per hash of their address, which is nullptr while the profiler isn't running.
+	inline std::atomic<atomic_u16 *> g_heap_profiler_filter{nullptr};
+
+	inline u32 heap_profiler_hash(void *data) { return static_cast<u32>(((reinterpret_cast<uintptr_t>(data) >> 4) * 0x9E3779B97F4A7C15ull) >> 32); }
+
+	bool heap_profiler_next_sample();
+	void heap_profiler_sample_alloc(void *data, size_t size);
+	void heap_profiler_sample_free(void *data, HeapProfilerReallocState *state = nullptr);
+	void heap_profiler_sample_restore(void *data, const HeapProfilerReallocState &state);
+#endif
+
+	// These are called by the generic allocation functions, and compile to nothing unless `VULTR_HEAP_PROFILER` is defined.
+	// An allocation that isn't sampled only costs a thread local countdown, and a free of memory that wasn't sampled only costs a relaxed load.
+
+	inline void heap_profiler_record_alloc([[maybe_unused]] void *data, [[maybe_unused]] size_t size)
+	{
+#ifdef VULTR_HEAP_PROFILER
+		if (data != nullptr && --g_heap_profiler_countdown <= 0 && heap_profiler_next_sample())
+		{
+			heap_profiler_sample_alloc(data, size);
+		}
+#endif
+	}
+
+	inline void heap_profiler_record_free([[maybe_unused]] void *data, [[maybe_unused]] HeapProfilerReallocState *state = nullptr)
+	{
+#ifdef VULTR_HEAP_PROFILER
+		auto *filter = g_heap_profiler_filter.load(std::memory_order_relaxed);
+		if (data != nullptr && filter != nullptr && filter[heap_profiler_hash(data) & (HEAP_PROFILER_FILTER_SIZE - 1)].load(std::memory_order_relaxed) != 0)
+		{
+			heap_profiler_sample_free(data, state);
+		}
+#endif
+	}
+
+	// The old block is forgotten before it is reallocated, since another thread could be handed the same address as soon as it is freed.
+	// Its sample is kept in `state` so that a failed realloc, which leaves the old block alive, puts it back instead of sampling it again.
+
+	inline void heap_profiler_record_realloc_begin(void *data, HeapProfilerReallocState *state) { heap_profiler_record_free(data, state); }
+
+	inline void heap_profiler_record_realloc_end([[maybe_unused]] void *data, void *new_data, size_t size, [[maybe_unused]] const HeapProfilerReallocState &state)
+	{
+		if (new_data != nullptr)
+		{
+			heap_profiler_record_alloc(new_data, size);
+		}
+#ifdef VULTR_HEAP_PROFILER
+		else if (state.weight != 0)
+		{
+			heap_profiler_sample_restore(data, state);
+		}
+#endif
+	}
+} // namespace Vultr
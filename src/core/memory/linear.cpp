@@ -1,42 +1,130 @@
 #include "linear.h"
+#include "allocator_stats.h"
 
 namespace Vultr
 {
-	static void *next_start(LinearAllocator *allocator) { return allocator + 1; }
+	static byte *next_start(LinearAllocator *allocator) { return reinterpret_cast<byte *>(allocator + 1); }
 
-	LinearAllocator *init_linear_allocator(MemoryArena *arena, size_t size)
+	LinearAllocator *init_linear_allocator(MemoryArena *arena, size_t size, bool concurrent)
 	{
 		// Designate a region within the memory arena for our allocator.
-		auto *allocator = static_cast<LinearAllocator *>(mem_arena_designate(arena, AllocatorType::Linear, size + sizeof(LinearAllocator)));
+		// Only the header is committed right away, the rest is committed as it is used.
+		auto *allocator = static_cast<LinearAllocator *>(mem_arena_designate(arena, AllocatorType::Linear, size + sizeof(LinearAllocator), sizeof(LinearAllocator)));
 
 		// If we were unable to allocate the required size, then there is nothing to do.
 		if (allocator == nullptr)
 			return nullptr;
 
-		// The head block will come after the memory allocator.
-		allocator->next = next_start(allocator);
-		allocator->size = size;
-		allocator->used = 0;
-		allocator->type = AllocatorType::Linear;
+		new (allocator) LinearAllocator();
+
+		// The allocations will come after the memory allocator.
+		allocator->size       = size;
+		allocator->used       = 0;
+		allocator->type       = AllocatorType::Linear;
+		allocator->arena      = arena;
+		allocator->concurrent = concurrent;
+		allocator->committed  = arena->flags & MEM_ARENA_RESERVE_ONLY ? 0 : size;
+		spin_lock_init(&allocator->commit_lock);
 
 		return allocator;
 	}
 
-	void *linear_alloc(LinearAllocator *allocator, size_t size)
+	// Make sure that the first `used` bytes after the header are committed. Concurrent allocators must hold the commit lock.
+	static bool linear_commit(LinearAllocator *allocator, size_t used)
+	{
+		size_t committed = allocator->committed.load(std::memory_order_acquire);
+		if (used <= committed)
+			return true;
+
+		// Commit in large steps so that growing doesn't need a system call every time.
+		size_t new_committed = MIN(MAX(used, committed + LINEAR_ALLOCATOR_COMMIT_SIZE), allocator->size);
+		if (!mem_arena_commit(allocator->arena, next_start(allocator) + committed, new_committed - committed))
+			return false;
+
+		allocator->committed.store(new_committed, std::memory_order_release);
+		return true;
+	}
+
+	static void *linear_alloc_concurrent(LinearAllocator *allocator, size_t size, size_t alignment)
+	{
+		// Every allocation is a multiple of the granularity, so the offset is always aligned to it and bigger alignments only need to be padded for.
+		size_t padded = (size + LINEAR_ALLOCATOR_CONCURRENT_GRANULARITY - 1) & ~size_t(LINEAR_ALLOCATOR_CONCURRENT_GRANULARITY - 1);
+		if (alignment > LINEAR_ALLOCATOR_CONCURRENT_GRANULARITY)
+		{
+			padded += alignment - LINEAR_ALLOCATOR_CONCURRENT_GRANULARITY;
+		}
+
+		// Checking up front keeps huge sizes from wrapping the offset around.
+		if (padded < size || padded > allocator->size)
+		{
+			allocator_stats_failure(allocator);
+			return nullptr;
+		}
+
+		size_t offset = allocator->used.fetch_add(padded, std::memory_order_relaxed);
+		size_t used   = offset + padded;
+		if (used > allocator->size)
+		{
+			allocator_stats_failure(allocator);
+			return nullptr;
+		}
+
+		if (used > allocator->committed.load(std::memory_order_acquire))
+		{
+			spin_lock(&allocator->commit_lock);
+			bool committed = linear_commit(allocator, used);
+			spin_unlock(&allocator->commit_lock);
+
+			if (!committed)
+			{
+				allocator_stats_failure(allocator);
+				return nullptr;
+			}
+		}
+
+		allocator_stats_alloc(allocator, size, padded);
+		return align_forward(next_start(allocator) + offset, alignment);
+	}
+
+	void *linear_alloc(LinearAllocator *allocator, size_t size, size_t alignment)
 	{
+		ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0, "Linear allocation alignment must be a power of 2!");
+
+		if (allocator->concurrent)
+			return linear_alloc_concurrent(allocator, size, alignment);
+
+		auto *start   = next_start(allocator);
+		size_t used   = allocator->used.load(std::memory_order_relaxed);
+		size_t offset = static_cast<byte *>(align_forward(start + used, alignment)) - start;
+
 		// If there isn't enough space then there is nothing to do.
-		if (size > allocator->size - allocator->used)
+		if (offset > allocator->size || size > allocator->size - offset || !linear_commit(allocator, offset + size))
 		{
+			allocator_stats_failure(allocator);
 			return nullptr;
 		}
 
-		void *data      = allocator->next;
-		allocator->next = reinterpret_cast<byte *>(allocator->next) + size;
-		allocator->used += size;
+		allocator->used.store(offset + size, std::memory_order_relaxed);
+
+		allocator_stats_alloc(allocator, size, offset + size - used);
+		return start + offset;
+	}
 
-		return data;
+	void linear_free(LinearAllocator *allocator)
+	{
+		allocator->used.store(0, std::memory_order_relaxed);
+		allocator_stats_free_all(allocator);
 	}
 
-	void linear_free(LinearAllocator *allocator) { allocator->next = next_start(allocator); }
+	void linear_get_stats(LinearAllocator *allocator, AllocatorStats *stats)
+	{
+		*stats                    = {};
+		stats->capacity           = allocator->size;
+		stats->bytes_in_use       = MIN(allocator->used.load(std::memory_order_relaxed), allocator->size);
+		stats->free_bytes         = allocator->size - stats->bytes_in_use;
+		stats->free_block_count   = stats->free_bytes > 0 ? 1 : 0;
+		stats->largest_free_block = stats->free_bytes;
+		fill_allocator_stats(allocator, stats);
+	}
 
 } // namespace Vultr
@@ -6,24 +6,56 @@ namespace Vultr
 {
 	/**
 	 * Allocator which allocates all memory blocks in O(1) time however memory can only be freed by freeing all allocated memory.
+	 * The header is 16 byte aligned so that the memory handed out right after it is as well.
 	 */
-	struct LinearAllocator : public Allocator
+	struct alignas(16) LinearAllocator : public Allocator
 	{
 		size_t size = 0;
-		size_t used = 0;
-		bool locked = false;
-		void *next  = nullptr;
+
+		// Offset of the next allocation from the end of the header. Allocations on a concurrent allocator bump this with a single `fetch_add`,
+		// so it can go past `size` when allocations fail.
+		std::atomic<size_t> used = 0;
+
+		// Whether `linear_alloc` can be called from multiple threads at the same time, see `init_linear_allocator`.
+		bool concurrent = false;
+
+		// How many bytes after the header are backed by physical memory, which only grows past the size of the allocator up front if the arena is `MEM_ARENA_RESERVE_ONLY`.
+		std::atomic<size_t> committed = 0;
+
+		// Held by concurrent allocators while committing more memory.
+		SpinLock commit_lock;
+		MemoryArena *arena = nullptr;
 
 		LinearAllocator() : Allocator(AllocatorType::Linear) {}
 	};
 
+#ifndef LINEAR_ALLOCATOR_COMMIT_SIZE
+	/**
+	 * The minimum number of bytes a linear allocator in a reserved memory arena commits at a time.
+	 */
+#define LINEAR_ALLOCATOR_COMMIT_SIZE Kilobyte(64)
+#endif
+
+#ifndef LINEAR_ALLOCATOR_CONCURRENT_GRANULARITY
+	/**
+	 * Concurrent linear allocators round every allocation up to a multiple of this many bytes, which keeps every allocation aligned to it without reading the current offset first.
+	 */
+#define LINEAR_ALLOCATOR_CONCURRENT_GRANULARITY 16
+#endif
+
 	/**
 	 * Initialize a new linear allocator. This allocator is best used for memory that is allocated at the start of the program and isn't freed until the end of the program or temporary memory that is allocated once
 	 * then freed immediately.
 	 * This allocator has no memory fragmentation and is very fast but you cannot free individual elements and must instead free all allocated memory.
+	 * In an arena that is `MEM_ARENA_RESERVE_ONLY`, memory is committed as the allocator grows so a generous size costs nothing until it is used.
+	 *
+	 * A concurrent allocator can be shared by threads that allocate at the same time, for example job system workers sharing per frame scratch memory.
+	 * Every allocation is a single atomic `fetch_add` of its size rounded up to `LINEAR_ALLOCATOR_CONCURRENT_GRANULARITY`, and only committing more memory in a reserved arena takes a lock.
+	 * The cost is that the space of a failed allocation isn't given back until `linear_free`.
 	 *
 	 * @param MemoryArena *arena: The memory arena to create the allocator from.
 	 * @param size_t size: The total size that this allocator will be able to allocate in bytes.
+	 * @param bool concurrent: Whether `linear_alloc` can be called from multiple threads at the same time.
 	 *
 	 * @return LinearAllocator *: The allocator which can be now be used.
 	 *
@@ -31,27 +63,38 @@ namespace Vultr
 	 *
 	 * @no_thread_safety
 	 */
-	LinearAllocator *init_linear_allocator(MemoryArena *arena, size_t size);
+	LinearAllocator *init_linear_allocator(MemoryArena *arena, size_t size, bool concurrent = false);
 
 	/**
 	 * Allocate a chunk of memory from using a linear allocator.
 	 *
 	 * @param LinearAllocator *allocator: The allocator to use.
 	 * @param size_t size: The size of memory to allocate.
+	 * @param size_t alignment: The alignment of the memory, must be a power of 2. Concurrent allocators align to at least `LINEAR_ALLOCATOR_CONCURRENT_GRANULARITY`.
 	 *
 	 * @return void *: The memory that can now be used.
 	 *
-	 * @error The method will return nullptr if the linear allocator doesn't have enough space to allocate.
+	 * @error The method will return nullptr if the linear allocator doesn't have enough space to allocate or the memory could not be committed.
 	 *
-	 * @no_thread_safety
+	 * @no_thread_safety Unless the allocator was initialized as `concurrent`.
 	 */
-	void *linear_alloc(LinearAllocator *allocator, size_t size);
+	void *linear_alloc(LinearAllocator *allocator, size_t size, size_t alignment = 1);
 
 	/**
-	 * Free all allocated memory from a linear allocator.
+	 * Free all allocated memory from a linear allocator in O(1) time.
 	 * @param LinearAllocator *allocator: The allocator to use.
 	 *
-	 * @no_thread_safety
+	 * @no_thread_safety Even a concurrent allocator must not be allocated from while it is being freed.
 	 */
 	void linear_free(LinearAllocator *allocator);
+
+	/**
+	 * Get statistics about the memory usage of a linear allocator.
+	 *
+	 * @param LinearAllocator *allocator: The allocator to inspect.
+	 * @param AllocatorStats *stats: The stats to fill in.
+	 *
+	 * @no_thread_safety
+	 */
+	void linear_get_stats(LinearAllocator *allocator, AllocatorStats *stats);
 } // namespace Vultr
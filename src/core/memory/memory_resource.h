@@ -0,0 +1,129 @@
+#pragma once
+#include "vultr_memory.h"
+#include <memory_resource>
+
+namespace Vultr
+{
+	/**
+	 * `std::pmr::memory_resource` adapters over the engine's allocators, so that standard containers (and third party code built on them) allocate out of a memory arena instead of the system heap.
+	 *
+	 *     PoolResource resource(g_game_memory->pool_allocator);
+	 *     std::pmr::vector<u32> indices(&resource);
+	 *
+	 * Allocations show up in the allocator statistics, the heap profiler and the allocation trace exactly like those from `malloc`.
+	 * Standard containers expect a resource to throw when it runs out of memory, these crash the program instead.
+	 * Like the allocators underneath them, none of the resources are thread safe.
+	 */
+
+	/**
+	 * Memory resource over a `LinearAllocator`. Deallocating does nothing, the memory is only given back by @ref linear_free.
+	 */
+	struct LinearResource : public std::pmr::memory_resource
+	{
+		explicit LinearResource(LinearAllocator *allocator) : allocator(allocator) { ASSERT(allocator != nullptr, "Memory resource must be initialized with a valid memory allocator!"); }
+		LinearAllocator *allocator = nullptr;
+
+	  protected:
+		void *do_allocate(size_t bytes, size_t alignment) override
+		{
+			void *data = linear_alloc(allocator, bytes, alignment);
+			PRODUCTION_ASSERT(data != nullptr, "Failed to allocate memory!");
+			heap_profiler_record_alloc(data, bytes);
+			alloc_trace_record(AllocTraceOp::Alloc, allocator, data, data, bytes);
+			return data;
+		}
+
+		void do_deallocate(void *, size_t, size_t) override {}
+
+		bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+	};
+
+	/**
+	 * Memory resource over a `PoolAllocator`. Blocks are only as aligned as their size allows, which is asserted on every allocation.
+	 */
+	struct PoolResource : public std::pmr::memory_resource
+	{
+		explicit PoolResource(PoolAllocator *allocator) : allocator(allocator) { ASSERT(allocator != nullptr, "Memory resource must be initialized with a valid memory allocator!"); }
+		PoolAllocator *allocator = nullptr;
+
+	  protected:
+		void *do_allocate(size_t bytes, [[maybe_unused]] size_t alignment) override
+		{
+			void *data = pool_alloc(allocator, bytes);
+			PRODUCTION_ASSERT(data != nullptr, "Failed to allocate memory!");
+			ASSERT(reinterpret_cast<uintptr_t>(data) % alignment == 0, "Pool block is not aligned enough for the allocation!");
+			heap_profiler_record_alloc(data, bytes);
+			alloc_trace_record(AllocTraceOp::Alloc, allocator, data, data, bytes);
+			return data;
+		}
+
+		void do_deallocate(void *data, size_t, size_t) override
+		{
+			heap_profiler_record_free(data);
+			alloc_trace_record(AllocTraceOp::Free, allocator, data, nullptr, 0);
+			pool_free(allocator, data);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+		{
+			auto *resource = dynamic_cast<const PoolResource *>(&other);
+			return resource != nullptr && resource->allocator == allocator;
+		}
+	};
+
+	/**
+	 * Memory resource over a `FreeListAllocator`. Allocations can't be aligned more than the allocator was initialized with.
+	 */
+	struct FreeListResource : public std::pmr::memory_resource
+	{
+		explicit FreeListResource(FreeListAllocator *allocator) : allocator(allocator) { ASSERT(allocator != nullptr, "Memory resource must be initialized with a valid memory allocator!"); }
+		FreeListAllocator *allocator = nullptr;
+
+	  protected:
+		void *do_allocate(size_t bytes, [[maybe_unused]] size_t alignment) override
+		{
+			void *data = free_list_alloc(allocator, bytes);
+			PRODUCTION_ASSERT(data != nullptr, "Failed to allocate memory!");
+			ASSERT(reinterpret_cast<uintptr_t>(data) % alignment == 0, "Free list allocator is not aligned enough for the allocation!");
+			heap_profiler_record_alloc(data, bytes);
+			alloc_trace_record(AllocTraceOp::Alloc, allocator, data, data, bytes);
+			return data;
+		}
+
+		void do_deallocate(void *data, size_t, size_t) override
+		{
+			heap_profiler_record_free(data);
+			alloc_trace_record(AllocTraceOp::Free, allocator, data, nullptr, 0);
+			free_list_free(allocator, data);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+		{
+			auto *resource = dynamic_cast<const FreeListResource *>(&other);
+			return resource != nullptr && resource->allocator == allocator;
+		}
+	};
+
+	/**
+	 * Memory resource over a `FrameAllocator`, for containers that only live for a few frames. Deallocating does nothing, the memory is given back when its frame comes around again.
+	 */
+	struct FrameResource : public std::pmr::memory_resource
+	{
+		explicit FrameResource(FrameAllocator *allocator) : allocator(allocator) { ASSERT(allocator != nullptr, "Memory resource must be initialized with a valid memory allocator!"); }
+		FrameAllocator *allocator = nullptr;
+
+	  protected:
+		void *do_allocate(size_t bytes, size_t alignment) override
+		{
+			void *data = frame_allocator_alloc(allocator, bytes, alignment);
+			PRODUCTION_ASSERT(data != nullptr, "Failed to allocate memory!");
+			heap_profiler_record_alloc(data, bytes);
+			alloc_trace_record(AllocTraceOp::Alloc, allocator, data, data, bytes);
+			return data;
+		}
+
+		void do_deallocate(void *, size_t, size_t) override {}
+
+		bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+	};
+} // namespace Vultr
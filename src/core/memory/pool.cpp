@@ -1,4 +1,6 @@
 #include "pool.h"
+#include "allocator_stats.h"
+#include <bit>
 
 namespace Vultr
 {
@@ -9,141 +11,274 @@ namespace Vultr
 
 	struct PoolSegment
 	{
-		u32 size                   = 0;
-		u32 count                  = 0;
-		PoolMemoryBlock *free_head = nullptr;
+		// Description of the segment, this is never written to after initialization.
+		u32 size    = 0;
+		u32 count   = 0;
+		byte *start = nullptr;
+		byte *end   = nullptr;
+
+		// The shared free list lives on its own cache line so that threads reading the description above don't contend with threads allocating from this segment.
+		// The head is tagged: the low 32 bits hold the byte offset of the first free block from `start` plus one (0 meaning empty) and the high 32 bits a generation counter
+		// which is bumped on every change. This lets concurrent pools swap the head with a single compare-and-swap without falling victim to the ABA problem.
+		alignas(CACHE_LINE_SIZE) atomic_u64 free_head = 0;
+		SpinLock lock;
 	};
 
-	static void init_pool_segment(PoolSegment *segment) {}
+	/**
+	 * Per-thread stack of free blocks belonging to a single segment.
+	 */
+	struct PoolMagazine
+	{
+		u32 count = 0;
+		PoolMemoryBlock *blocks[POOL_MAGAZINE_SIZE];
+	};
 
-	PoolAllocator *init_pool_allocator(MemoryArena *arena, u32 allocation_size, u32 count)
+	struct PoolThreadCache
 	{
-		ASSERT(count > 0, R"(Cannot create a pool allocator with 0 blocks)")
-		ASSERT(allocation_size > sizeof(PoolMemoryBlock), "Minimum size of a chunk not reached!");
+		PoolAllocator *allocator = nullptr;
+		PoolMagazine magazines[MAX_POOL_SEGMENTS];
+	};
 
-		// Calculate the total space in bytes this allocator will have.
-		size_t size = allocation_size * count;
+	static thread_local PoolThreadCache t_pool_caches[MAX_POOL_THREAD_CACHES];
 
-		// Designate a region within the memory arena for our allocator.
-		auto *allocator = static_cast<PoolAllocator *>(mem_arena_designate(arena, AllocatorType::Pool, sizeof(PoolAllocator) + sizeof(PoolSegment) + size));
-		allocator->type = AllocatorType::Pool;
+	static void init_pool_segment(PoolSegment *segment, u32 size, u32 count, byte *start)
+	{
+		new (segment) PoolSegment();
+		segment->size      = size;
+		segment->count     = count;
+		segment->start     = start;
+		segment->end       = start + static_cast<size_t>(size) * count;
+
+		// Every block in the segment starts out free.
+		segment->free_head.store(1, std::memory_order_relaxed);
+		auto *current = reinterpret_cast<PoolMemoryBlock *>(start);
+		for (u32 i = 0; i < count - 1; i++)
+		{
+			current->next = reinterpret_cast<PoolMemoryBlock *>(reinterpret_cast<byte *>(current) + size);
+			current       = current->next;
+		}
+		current->next = nullptr;
+	}
 
-		// If we were unable to allocate the required size, then there is nothing to do.
-		if (allocator == nullptr)
-			return nullptr;
+	PoolAllocator *init_pool_allocator(MemoryArena *arena, u32 allocation_size, u32 count, bool concurrent)
+	{
+		PoolRegion region = {.size = allocation_size, .count = count};
+		return init_pool_allocator(arena, &region, 1, concurrent);
+	}
 
-		allocator->segments              = reinterpret_cast<PoolSegment *>(allocator + 1);
-		allocator->num_segments          = 1;
-		allocator->segments[0].size      = allocation_size;
-		allocator->segments[0].count     = count;
-		allocator->segments[0].free_head = reinterpret_cast<PoolMemoryBlock *>(&allocator->segments[0] + 1);
+	// Rounded up log2 of a size, this is the index into `PoolAllocator::size_classes`.
+	static u32 get_size_bucket(size_t size) { return std::bit_width(size > 0 ? size - 1 : 0); }
 
-		PoolMemoryBlock *current         = allocator->segments[0].free_head;
+	static void init_lookup_tables(PoolAllocator *allocator)
+	{
+		auto *segments = allocator->segments;
+		u32 count      = allocator->num_segments;
 
-		for (size_t i = 0; i < count; i++)
+		// For every power of 2 store the first segment that fits the smallest size rounding up to it.
+		for (u32 bucket = 0; bucket < sizeof(allocator->size_classes); bucket++)
 		{
-			if (i == count - 1)
+			size_t smallest = bucket == 0 ? 0 : (1ULL << (bucket - 1)) + 1;
+			u32 i           = 0;
+			while (i < count && segments[i].size < smallest)
 			{
-				current->next = nullptr;
+				i++;
 			}
-			else
+			allocator->size_classes[bucket] = i;
+		}
+
+		// For every page store the segment that its first byte belongs to.
+		size_t pages = ((allocator->blocks_end - allocator->blocks_start) >> allocator->segment_map_shift) + 1;
+		u32 i        = 0;
+		for (size_t page = 0; page < pages; page++)
+		{
+			byte *page_start = allocator->blocks_start + (page << allocator->segment_map_shift);
+			while (i < count - 1 && page_start >= segments[i].end)
 			{
-				current->next = reinterpret_cast<PoolMemoryBlock *>(reinterpret_cast<byte *>(current) + allocation_size);
+				i++;
 			}
-			current = current->next;
+			allocator->segment_map[page] = i;
 		}
-
-		return allocator;
 	}
 
-	PoolAllocator *init_pool_allocator(MemoryArena *arena, PoolRegion *regions, u32 region_count)
+	PoolAllocator *init_pool_allocator(MemoryArena *arena, PoolRegion *regions, u32 region_count, bool concurrent)
 	{
-		// TODO(Brandon): Sort the regions so that allocations are faster and less fragmented.
+		ASSERT(region_count > 0 && region_count <= MAX_POOL_SEGMENTS, "Invalid number of pool regions!");
+
+		// Sort the regions by size so that allocations can always take the smallest segment that fits and fall back to the next larger ones.
+		PoolRegion sorted[MAX_POOL_SEGMENTS];
+		for (u32 i = 0; i < region_count; i++)
+		{
+			auto region = regions[i];
+			u32 j       = i;
+			while (j > 0 && sorted[j - 1].size > region.size)
+			{
+				sorted[j] = sorted[j - 1];
+				j--;
+			}
+			sorted[j] = region;
+		}
+
 		size_t size = 0;
-		for (s32 i = 0; i < region_count; i++)
+		for (u32 i = 0; i < region_count; i++)
 		{
-			auto *region = &regions[i];
+			auto *region = &sorted[i];
 
+			ASSERT(region->count > 0, "Cannot create a pool region with 0 blocks");
 			ASSERT(region->size > sizeof(PoolMemoryBlock), "Minimum size of a chunk not reached!");
+			ASSERT(static_cast<size_t>(region->size) * region->count < U32Max, "Pool regions must be smaller than 4 gigabytes!");
+			ASSERT(!concurrent || region->size % alignof(PoolMemoryBlock) == 0, "Concurrent pool regions must keep their blocks pointer aligned!");
+
+			size += static_cast<size_t>(region->size) * region->count;
+		}
 
-			size += region->size * region->count;
+		// Use 4 kilobyte pages for the segment map unless that would make it larger than 64 kilobytes.
+		u32 map_shift = 12;
+		while ((size >> map_shift) >= Kilobyte(64))
+		{
+			map_shift++;
 		}
+		size_t map_size    = (size >> map_shift) + 1;
+
+		// Leave room to align the segments to a cache line and the blocks to 16 bytes.
+		size_t header_size = sizeof(PoolAllocator) + alignof(PoolSegment) + sizeof(PoolSegment) * region_count + map_size + 16;
 
 		// Designate a region within the memory arena for our allocator.
-		auto *allocator = static_cast<PoolAllocator *>(mem_arena_designate(arena, AllocatorType::Pool, size + sizeof(PoolAllocator) + (sizeof(PoolSegment) * region_count)));
+		// All of it is committed, every block gets written to when the segments are set up.
+		auto *allocator    = static_cast<PoolAllocator *>(mem_arena_designate(arena, AllocatorType::Pool, header_size + size));
 
 		// If we were unable to allocate the required size, then there is nothing to do.
 		if (allocator == nullptr)
 			return nullptr;
 
-		allocator->segments              = reinterpret_cast<PoolSegment *>(allocator + 1);
-		allocator->num_segments          = region_count;
-		allocator->segments[0].free_head = reinterpret_cast<PoolMemoryBlock *>(allocator->segments + 1);
-
-		PoolMemoryBlock *current         = allocator->segments[0].free_head;
-		for (s32 i = 0; i < region_count; i++)
+		allocator->type              = AllocatorType::Pool;
+		allocator->segments          = static_cast<PoolSegment *>(align_forward(allocator + 1, alignof(PoolSegment)));
+		allocator->num_segments      = region_count;
+		allocator->concurrent        = concurrent;
+		allocator->segment_map       = reinterpret_cast<u8 *>(allocator->segments + region_count);
+		allocator->segment_map_shift = map_shift;
+		allocator->blocks_start      = static_cast<byte *>(align_forward(allocator->segment_map + map_size, 16));
+		allocator->blocks_end        = allocator->blocks_start + size;
+
+		// The blocks of each segment are laid out one after another, from the smallest to the largest block size.
+		byte *current                = allocator->blocks_start;
+		for (u32 i = 0; i < region_count; i++)
 		{
-			allocator->segments[i].size      = regions[i].size;
-			allocator->segments[i].count     = regions[i].count;
-			allocator->segments[i].free_head = reinterpret_cast<PoolMemoryBlock *>(current);
-
-			for (size_t j = 0; j < allocator->segments[0].count; j++)
-			{
-				if (j == allocator->segments[0].count - 1)
-				{
-					current->next = nullptr;
-				}
-				else
-				{
-					current->next = current + 1;
-				}
-				current++;
-			}
+			init_pool_segment(&allocator->segments[i], sorted[i].size, sorted[i].count, current);
+			current = allocator->segments[i].end;
 		}
 
+		init_lookup_tables(allocator);
+
 		return allocator;
 	}
 
-	void *pool_alloc(PoolAllocator *allocator, size_t size)
+	// Index of the first segment that can fit an allocation of `size`, or `num_segments` if none can.
+	static u32 get_size_class(PoolAllocator *allocator, size_t size)
 	{
-		for (s32 i = 0; i < allocator->num_segments; i++)
+		if (size > allocator->segments[allocator->num_segments - 1].size)
+			return allocator->num_segments;
+
+		// The lookup gets us to the first segment in the right power of 2, only segments that aren't powers of 2 themselves can require a step or two forward.
+		u32 i = allocator->size_classes[get_size_bucket(size)];
+		while (allocator->segments[i].size < size)
 		{
-			// If the requested allocation size can't fit here, then we need to find another region.
-			if (size > allocator->segments[i].size)
-			{
-				continue;
-			}
+			i++;
+		}
+		return i;
+	}
 
-			auto *segment = &allocator->segments[i];
+	static PoolMemoryBlock *get_head_block(PoolSegment *segment, u64 head)
+	{
+		u32 offset = static_cast<u32>(head);
+		if (offset == 0)
+			return nullptr;
+
+		return reinterpret_cast<PoolMemoryBlock *>(segment->start + offset - 1);
+	}
 
-			// If the segment doesn't have anymore blocks to allocate, then we need to find another segment.
-			if (segment->free_head == nullptr)
+	static u64 make_head(PoolSegment *segment, PoolMemoryBlock *block, u64 previous_head)
+	{
+		u64 generation = (previous_head >> 32) + 1;
+		u64 offset     = block == nullptr ? 0 : reinterpret_cast<byte *>(block) - segment->start + 1;
+		return (generation << 32) | offset;
+	}
+
+	static PoolMemoryBlock *segment_pop(PoolSegment *segment, bool concurrent)
+	{
+		u64 head = segment->free_head.load(std::memory_order_acquire);
+		while (true)
+		{
+			auto *block = get_head_block(segment, head);
+			if (block == nullptr)
+				return nullptr;
+
+			if (!concurrent)
 			{
-				continue;
+				segment->free_head.store(make_head(segment, block->next, head), std::memory_order_relaxed);
+				return block;
 			}
 
-			auto *data         = segment->free_head;
-			segment->free_head = data->next;
-			return data;
+			// Another thread may pop this block and hand it out before our swap, in which case this reads user data. That is fine since the generation will have moved on and the swap will fail.
+			auto *next = std::atomic_ref<PoolMemoryBlock *>(block->next).load(std::memory_order_relaxed);
+			if (segment->free_head.compare_exchange_weak(head, make_head(segment, next, head), std::memory_order_acquire, std::memory_order_acquire))
+				return block;
 		}
-		return nullptr;
 	}
 
-	static PoolSegment *get_segment(PoolAllocator *allocator, void *data)
+	// Push a chain of blocks already linked together from `first` to `last` onto the free list.
+	static void segment_push(PoolSegment *segment, PoolMemoryBlock *first, PoolMemoryBlock *last, bool concurrent)
 	{
-		for (s32 i = 0; i < allocator->num_segments; i++)
+		u64 head = segment->free_head.load(std::memory_order_relaxed);
+		if (!concurrent)
 		{
-			auto *segment = &allocator->segments[i];
+			last->next = get_head_block(segment, head);
+			segment->free_head.store(make_head(segment, first, head), std::memory_order_relaxed);
+			return;
+		}
+
+		while (true)
+		{
+			// Paired with the racy load in `segment_pop`.
+			std::atomic_ref<PoolMemoryBlock *>(last->next).store(get_head_block(segment, head), std::memory_order_relaxed);
+
+			if (segment->free_head.compare_exchange_weak(head, make_head(segment, first, head), std::memory_order_release, std::memory_order_relaxed))
+				return;
+		}
+	}
 
-			// If the segment pointer is inside the range of this segment, then we can assume that this data belongs to this segment.
-			if (data > segment && data <= reinterpret_cast<byte *>(segment) + segment->count * segment->size)
+	static void segment_push(PoolSegment *segment, PoolMemoryBlock *block, bool concurrent) { segment_push(segment, block, block, concurrent); }
+
+	void *pool_alloc(PoolAllocator *allocator, size_t size)
+	{
+		// Segments are sorted by size, so if the best fitting segment has run out of blocks the following ones can be used instead.
+		for (u32 i = get_size_class(allocator, size); i < allocator->num_segments; i++)
+		{
+			auto *data = segment_pop(&allocator->segments[i], allocator->concurrent);
+			if (data != nullptr)
 			{
-				return segment;
+				allocator_stats_alloc(allocator, size, allocator->segments[i].size);
+				return data;
 			}
 		}
+		allocator_stats_failure(allocator);
 		return nullptr;
 	}
 
+	static PoolSegment *get_segment(PoolAllocator *allocator, void *data)
+	{
+		auto *address = static_cast<byte *>(data);
+		if (address < allocator->blocks_start || address >= allocator->blocks_end)
+			return nullptr;
+
+		// The map tells us which segment the start of this page belongs to, the data can only be in that segment or one of the ones following it if they share the page.
+		u32 i = allocator->segment_map[(address - allocator->blocks_start) >> allocator->segment_map_shift];
+		while (address >= allocator->segments[i].end)
+		{
+			i++;
+		}
+		return &allocator->segments[i];
+	}
+
 	void *pool_realloc(PoolAllocator *allocator, void *data, size_t size)
 	{
 		auto *segment = get_segment(allocator, data);
@@ -170,9 +305,8 @@ namespace Vultr
 				memcpy(new_data, data, segment->size);
 
 				// Free the memory block of the old location.
-				auto *memory_block = reinterpret_cast<PoolMemoryBlock *>(data);
-				memory_block->next = segment->free_head;
-				segment->free_head = memory_block;
+				segment_push(segment, reinterpret_cast<PoolMemoryBlock *>(data), allocator->concurrent);
+				allocator_stats_free(allocator, segment->size);
 
 				// Return the data.
 				return new_data;
@@ -186,8 +320,162 @@ namespace Vultr
 		auto *segment = get_segment(allocator, data);
 		ASSERT(segment != nullptr, "Failed to find segment for requested free from pool allocator!");
 
-		auto *memory_block = reinterpret_cast<PoolMemoryBlock *>(data);
-		memory_block->next = segment->free_head;
-		segment->free_head = memory_block;
+		segment_push(segment, reinterpret_cast<PoolMemoryBlock *>(data), allocator->concurrent);
+		allocator_stats_free(allocator, segment->size);
+	}
+
+	static PoolThreadCache *get_thread_cache(PoolAllocator *allocator)
+	{
+		PoolThreadCache *unused = nullptr;
+		for (u32 i = 0; i < MAX_POOL_THREAD_CACHES; i++)
+		{
+			auto *cache = &t_pool_caches[i];
+			if (cache->allocator == allocator)
+				return cache;
+
+			if (cache->allocator == nullptr && unused == nullptr)
+				unused = cache;
+		}
+
+		PRODUCTION_ASSERT(unused != nullptr, "This thread is caching too many pool allocators, increase MAX_POOL_THREAD_CACHES!");
+		unused->allocator = allocator;
+		return unused;
+	}
+
+	// Take up to half a magazine worth of blocks from the shared free list of a segment.
+	static u32 refill_magazine(PoolAllocator *allocator, PoolSegment *segment, PoolMagazine *magazine)
+	{
+		// Concurrent pools don't need the lock since every pop is atomic on its own.
+		if (!allocator->concurrent)
+			spin_lock(&segment->lock);
+
+		while (magazine->count < POOL_MAGAZINE_SIZE / 2)
+		{
+			auto *block = segment_pop(segment, allocator->concurrent);
+			if (block == nullptr)
+				break;
+
+			magazine->blocks[magazine->count] = block;
+			magazine->count++;
+		}
+
+		if (!allocator->concurrent)
+			spin_unlock(&segment->lock);
+
+		return magazine->count;
+	}
+
+	// Give every block above `keep` back to the shared free list of a segment.
+	static void flush_magazine(PoolAllocator *allocator, PoolSegment *segment, PoolMagazine *magazine, u32 keep)
+	{
+		if (magazine->count <= keep)
+			return;
+
+		// Link the blocks together before taking the lock, these still belong to this thread so this doesn't touch any shared memory.
+		auto *first = magazine->blocks[keep];
+		auto *last  = first;
+		for (u32 i = keep + 1; i < magazine->count; i++)
+		{
+			last->next = magazine->blocks[i];
+			last       = last->next;
+		}
+		magazine->count = keep;
+
+		if (allocator->concurrent)
+		{
+			segment_push(segment, first, last, true);
+		}
+		else
+		{
+			spin_lock(&segment->lock);
+			segment_push(segment, first, last, false);
+			spin_unlock(&segment->lock);
+		}
+	}
+
+	void *pool_cached_alloc(PoolAllocator *allocator, size_t size)
+	{
+		auto *cache = get_thread_cache(allocator);
+
+		for (u32 i = get_size_class(allocator, size); i < allocator->num_segments; i++)
+		{
+			// If neither this thread nor the shared pool have any blocks left for this segment, then we need to fall back to a larger segment.
+			auto *segment  = &allocator->segments[i];
+			auto *magazine = &cache->magazines[i];
+			if (magazine->count == 0 && refill_magazine(allocator, segment, magazine) == 0)
+			{
+				continue;
+			}
+
+			magazine->count--;
+			allocator_stats_alloc(allocator, size, segment->size);
+			return magazine->blocks[magazine->count];
+		}
+		allocator_stats_failure(allocator);
+		return nullptr;
+	}
+
+	void pool_cached_free(PoolAllocator *allocator, void *data)
+	{
+		auto *cache   = get_thread_cache(allocator);
+		auto *segment = get_segment(allocator, data);
+		ASSERT(segment != nullptr, "Failed to find segment for requested free from pool allocator!");
+
+		auto *magazine = &cache->magazines[segment - allocator->segments];
+
+		// Keep half of the magazine so that alternating allocations and frees don't bounce blocks back and forth with the shared pool.
+		if (magazine->count == POOL_MAGAZINE_SIZE)
+		{
+			flush_magazine(allocator, segment, magazine, POOL_MAGAZINE_SIZE / 2);
+		}
+
+		magazine->blocks[magazine->count] = reinterpret_cast<PoolMemoryBlock *>(data);
+		magazine->count++;
+		allocator_stats_free(allocator, segment->size);
+	}
+
+	void pool_cached_flush(PoolAllocator *allocator)
+	{
+		auto *cache = get_thread_cache(allocator);
+		for (u32 i = 0; i < allocator->num_segments; i++)
+		{
+			flush_magazine(allocator, &allocator->segments[i], &cache->magazines[i], 0);
+		}
+		cache->allocator = nullptr;
+	}
+
+	u32 pool_get_block_size(PoolAllocator *allocator, void *data)
+	{
+		auto *segment = get_segment(allocator, data);
+		ASSERT(segment != nullptr, "Data was not allocated from this pool allocator!");
+		return segment->size;
+	}
+
+	void pool_get_stats(PoolAllocator *allocator, AllocatorStats *stats)
+	{
+		*stats              = {};
+		stats->num_segments = allocator->num_segments;
+		for (u32 i = 0; i < allocator->num_segments; i++)
+		{
+			auto *segment = &allocator->segments[i];
+
+			// Count what is left on the shared free list.
+			u32 free_blocks = 0;
+			for (auto *block = get_head_block(segment, segment->free_head.load(std::memory_order_acquire)); block != nullptr; block = block->next)
+			{
+				free_blocks++;
+			}
+
+			stats->segments[i] = {.block_size = segment->size, .block_count = segment->count, .used_blocks = segment->count - free_blocks};
+			stats->capacity += static_cast<size_t>(segment->size) * segment->count;
+			stats->free_bytes += static_cast<size_t>(segment->size) * free_blocks;
+			stats->free_block_count += free_blocks;
+			if (free_blocks > 0)
+			{
+				stats->largest_free_block = MAX(stats->largest_free_block, static_cast<size_t>(segment->size));
+			}
+		}
+		stats->bytes_in_use = stats->capacity - stats->free_bytes;
+		fill_allocator_stats(allocator, stats);
 	}
 } // namespace Vultr
@@ -6,6 +6,28 @@ namespace Vultr
 {
 	struct PoolSegment;
 
+#ifndef MAX_POOL_SEGMENTS
+	/**
+	 * The maximum number of segments (differently sized regions) a single pool allocator can have.
+	 */
+#define MAX_POOL_SEGMENTS 16
+#endif
+
+#ifndef POOL_MAGAZINE_SIZE
+	/**
+	 * The number of blocks each thread can hold on to per segment before it has to give some back to the shared pool.
+	 * Refills and flushes move half of this many blocks at once.
+	 */
+#define POOL_MAGAZINE_SIZE 32
+#endif
+
+#ifndef MAX_POOL_THREAD_CACHES
+	/**
+	 * The maximum number of different pool allocators a single thread can have a cache for at the same time.
+	 */
+#define MAX_POOL_THREAD_CACHES 4
+#endif
+
 	/**
 	 * Allocator that has segment(s) containing memory blocks of the same size which can be allocated.
 	 */
@@ -14,6 +36,18 @@ namespace Vultr
 		PoolSegment *segments = nullptr;
 		u32 num_segments      = 0;
 
+		// Whether the segment free lists are shared lock-free between threads, see `init_pool_allocator`.
+		bool concurrent       = false;
+
+		// Index of the first segment (sorted by size) that can hold an allocation, indexed by the allocation size rounded up to a power of 2 (its ceiling log2).
+		u8 size_classes[33]   = {};
+
+		// Index of the segment the start of every page of blocks belongs to, so that the owner of a block can be found without searching.
+		u8 *segment_map       = nullptr;
+		u32 segment_map_shift = 0;
+		byte *blocks_start    = nullptr;
+		byte *blocks_end      = nullptr;
+
 		PoolAllocator() : Allocator(AllocatorType::Pool) {}
 	};
 
@@ -33,6 +67,7 @@ namespace Vultr
 	 * @param MemoryArena *arena: The memory arena to create the allocator from.
 	 * @param u32 allocation_size: The size of all elements in the pool.
 	 * @param u32 count: The maximum number of elements that can be allocated at one time.
+	 * @param bool concurrent: Whether `pool_alloc`, `pool_realloc` and `pool_free` can be called from multiple threads at the same time. See the overload taking regions.
 	 *
 	 * @return PoolAllocator *: The allocator which can be now be used.
 	 *
@@ -40,16 +75,21 @@ namespace Vultr
 	 *
 	 * @no_thread_safety
 	 */
-	PoolAllocator *init_pool_allocator(MemoryArena *arena, u32 allocation_size, u32 count);
+	PoolAllocator *init_pool_allocator(MemoryArena *arena, u32 allocation_size, u32 count, bool concurrent = false);
 
 	/**
 	 * Initialize a new pool allocator. This allocator is best used for frequent but small allocations or frequent allocations of one specific type of object.
 	 * This allocator has fairly large memory fragmentation but is very fast. This is best used as a "general purpose" heap allocator, for things like strings and small buffers.
+	 * Unlike the other allocators, the whole pool is committed up front even in an arena that is `MEM_ARENA_RESERVE_ONLY`, since every block is linked into a free list right away.
 	 *
 	 * @param MemoryArena *arena: The memory arena to create the allocator from.
 	 * @param PoolRegion *regions: An array that tells the pool allocator the different sizes of elements that can be allocated, each of these sizes is known as a `region` or `segment`.
 	 * This parameter is best created on the stack.
-	 * @param u32 region_count: The number of regions that exist in this pool allocator.
+	 * The regions don't have to be in any particular order, they are sorted by size so that an allocation always lands in the smallest region that can fit it.
+	 * @param u32 region_count: The number of regions that exist in this pool allocator. This can be at most `MAX_POOL_SEGMENTS`.
+	 * @param bool concurrent: Whether `pool_alloc`, `pool_realloc` and `pool_free` can be called from multiple threads at the same time.
+	 * Concurrent pools push and pop their free lists with a compare-and-swap on a head tagged with a generation counter instead of plain stores, which is slightly slower on a single thread.
+	 * Every region size must then be a multiple of 8 bytes and every region must be smaller than 4 gigabytes.
 	 *
 	 * @return PoolAllocator *: The allocator which can be now be used.
 	 *
@@ -57,7 +97,7 @@ namespace Vultr
 	 *
 	 * @no_thread_safety
 	 */
-	PoolAllocator *init_pool_allocator(MemoryArena *arena, PoolRegion *regions, u32 region_count);
+	PoolAllocator *init_pool_allocator(MemoryArena *arena, PoolRegion *regions, u32 region_count, bool concurrent = false);
 
 	/**
 	 * Allocate a chunk of memory using a pool allocator.
@@ -69,7 +109,7 @@ namespace Vultr
 	 *
 	 * @error The method will return nullptr if there is no memory chunk available to allocate.
 	 *
-	 * @no_thread_safety
+	 * @no_thread_safety Unless the allocator was initialized as `concurrent`.
 	 */
 	void *pool_alloc(PoolAllocator *allocator, size_t size);
 
@@ -84,7 +124,7 @@ namespace Vultr
 	 *
 	 * @error The method will return nullptr if there is no memory chunk available to allocate and will leave the original data untouched.
 	 *
-	 * @no_thread_safety
+	 * @no_thread_safety Unless the allocator was initialized as `concurrent`.
 	 */
 	void *pool_realloc(PoolAllocator *allocator, void *data, size_t size);
 
@@ -93,7 +133,69 @@ namespace Vultr
 	 * @param PoolAllocator *allocator: The allocator to use.
 	 * @param void *data: The data to free.
 	 *
-	 * @no_thread_safety
+	 * @no_thread_safety Unless the allocator was initialized as `concurrent`.
 	 */
 	void pool_free(PoolAllocator *allocator, void *data);
+
+	/**
+	 * Get the size of the block that holds an allocation, which can be more than was asked for.
+	 *
+	 * @param PoolAllocator *allocator: The allocator the data was allocated from.
+	 * @param void *data: The allocated data.
+	 *
+	 * @return u32: The number of bytes that can be used at `data`.
+	 *
+	 * @error The method will assert if the data wasn't allocated from this pool.
+	 *
+	 * @thread_safe
+	 */
+	u32 pool_get_block_size(PoolAllocator *allocator, void *data);
+
+	/**
+	 * Allocate a chunk of memory using the calling thread's cache in front of a pool allocator.
+	 * Every thread keeps a small stack of blocks (a magazine) for each segment, which is refilled from and flushed to the shared pool in batches.
+	 * Most calls never touch memory shared with other threads.
+	 *
+	 * @param PoolAllocator *allocator: The allocator to use.
+	 * @param size_t size: The size of memory to allocate.
+	 *
+	 * @return void *: The memory that can now be used.
+	 *
+	 * @error The method will return nullptr if there is no memory chunk available to allocate.
+	 *
+	 * @thread_safe Only with other `pool_cached_*` calls, unless the allocator was initialized as `concurrent` it is not safe to concurrently use `pool_alloc`, `pool_realloc` or `pool_free` on the same allocator.
+	 */
+	void *pool_cached_alloc(PoolAllocator *allocator, size_t size);
+
+	/**
+	 * Free a chunk of memory into the calling thread's cache in front of a `PoolAllocator`.
+	 * The memory can have been allocated by any thread.
+	 *
+	 * @param PoolAllocator *allocator: The allocator to use.
+	 * @param void *data: The data to free.
+	 *
+	 * @thread_safe Only with other `pool_cached_*` calls, unless the allocator was initialized as `concurrent` it is not safe to concurrently use `pool_alloc`, `pool_realloc` or `pool_free` on the same allocator.
+	 */
+	void pool_cached_free(PoolAllocator *allocator, void *data);
+
+	/**
+	 * Give all blocks cached by the calling thread back to a `PoolAllocator` and release the thread's cache for it.
+	 * This must be called before a thread that used `pool_cached_alloc` exits, otherwise the blocks it held on to are lost.
+	 *
+	 * @param PoolAllocator *allocator: The allocator to flush the cache of.
+	 *
+	 * @thread_safe Only with other `pool_cached_*` calls, unless the allocator was initialized as `concurrent` it is not safe to concurrently use `pool_alloc`, `pool_realloc` or `pool_free` on the same allocator.
+	 */
+	void pool_cached_flush(PoolAllocator *allocator);
+
+	/**
+	 * Get statistics about the memory usage and per segment occupancy of a pool allocator. This walks the free list of every segment so it is O(n).
+	 * Blocks held in the cache of a thread count as used.
+	 *
+	 * @param PoolAllocator *allocator: The allocator to inspect.
+	 * @param AllocatorStats *stats: The stats to fill in.
+	 *
+	 * @no_thread_safety
+	 */
+	void pool_get_stats(PoolAllocator *allocator, AllocatorStats *stats);
 } // namespace Vultr
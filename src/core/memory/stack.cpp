@@ -0,0 +1,101 @@
+#include "stack.h"
+#include "allocator_stats.h"
+
+namespace Vultr
+{
+	// Stored right below every allocation so that it can be popped without the caller having to remember anything.
+	struct StackAllocationHeader
+	{
+		size_t previous_used = 0;
+		void *previous_top   = nullptr;
+	};
+
+	static byte *stack_start(StackAllocator *allocator) { return reinterpret_cast<byte *>(allocator + 1); }
+	static StackAllocationHeader *get_header(void *data) { return reinterpret_cast<StackAllocationHeader *>(data) - 1; }
+
+	StackAllocator *init_stack_allocator(MemoryArena *arena, size_t size)
+	{
+		// Designate a region within the memory arena for our allocator.
+		// Only the header is committed right away, the rest is committed as it is used.
+		auto *allocator = static_cast<StackAllocator *>(mem_arena_designate(arena, AllocatorType::Stack, size + sizeof(StackAllocator), sizeof(StackAllocator)));
+
+		// If we were unable to allocate the required size, then there is nothing to do.
+		if (allocator == nullptr)
+			return nullptr;
+
+		new (allocator) StackAllocator();
+		allocator->size      = size;
+		allocator->arena     = arena;
+		allocator->committed = arena->flags & MEM_ARENA_RESERVE_ONLY ? 0 : size;
+
+		return allocator;
+	}
+
+	void *stack_alloc(StackAllocator *allocator, size_t size, size_t alignment)
+	{
+		ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0, "Stack allocation alignment must be a power of 2!");
+
+		// Leave room for the header, then align the data itself.
+		byte *current = stack_start(allocator) + allocator->used;
+		auto *data    = static_cast<byte *>(align_forward(current + sizeof(StackAllocationHeader), MAX(alignment, alignof(StackAllocationHeader))));
+		size_t used   = (data - stack_start(allocator)) + size;
+
+		// If there isn't enough space then there is nothing to do.
+		if (used > allocator->size || !mem_arena_commit_to(allocator->arena, stack_start(allocator), &allocator->committed, used, allocator->size))
+		{
+			allocator_stats_failure(allocator);
+			return nullptr;
+		}
+
+		new (get_header(data)) StackAllocationHeader{.previous_used = allocator->used, .previous_top = allocator->top};
+		allocator_stats_alloc(allocator, size, used - allocator->used);
+
+		allocator->used = used;
+		allocator->top  = data;
+
+		return data;
+	}
+
+	void stack_free(StackAllocator *allocator, void *data)
+	{
+		ASSERT(data != nullptr, "Cannot free nullptr from a stack allocator!");
+		ASSERT(data == allocator->top, "Stack allocator memory must be freed in the reverse order it was allocated in!");
+
+		auto *header    = get_header(data);
+		allocator_stats_free(allocator, allocator->used - header->previous_used);
+		allocator->used = header->previous_used;
+		allocator->top  = header->previous_top;
+	}
+
+	StackMarker stack_get_marker(StackAllocator *allocator) { return {.used = allocator->used, .top = allocator->top}; }
+
+	void stack_free_to_marker(StackAllocator *allocator, StackMarker marker)
+	{
+		ASSERT(marker.used <= allocator->used, "Stack allocator has already been rewound past this marker!");
+
+#ifdef VULTR_ALLOCATOR_STATS
+		u64 count = 0;
+		for (void *top = allocator->top; top != marker.top; top = get_header(top)->previous_top)
+		{
+			count++;
+		}
+		allocator_stats_free(allocator, allocator->used - marker.used, count);
+#endif
+
+		allocator->used = marker.used;
+		allocator->top  = marker.top;
+	}
+
+	void stack_clear(StackAllocator *allocator) { stack_free_to_marker(allocator, {}); }
+
+	void stack_get_stats(StackAllocator *allocator, AllocatorStats *stats)
+	{
+		*stats                    = {};
+		stats->capacity           = allocator->size;
+		stats->bytes_in_use       = allocator->used;
+		stats->free_bytes         = allocator->size - allocator->used;
+		stats->free_block_count   = stats->free_bytes > 0 ? 1 : 0;
+		stats->largest_free_block = stats->free_bytes;
+		fill_allocator_stats(allocator, stats);
+	}
+} // namespace Vultr
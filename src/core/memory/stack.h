@@ -0,0 +1,133 @@
+#pragma once
+#include <types/types.h>
+#include "vultr_memory_internal.h"
+
+namespace Vultr
+{
+	/**
+	 * Allocator which allocates memory blocks in O(1) time by pushing them on top of each other. Memory can only be freed in the reverse order it was allocated (LIFO).
+	 * The stack starts right after the allocator, which is aligned so that the stack always starts on a 16 byte boundary no matter what the allocator header contains.
+	 */
+	struct alignas(16) StackAllocator : public Allocator
+	{
+		size_t size = 0;
+		size_t used = 0;
+
+		// The most recent allocation, which is the only one that can be individually freed.
+		void *top   = nullptr;
+
+		// How many bytes of the stack are backed by physical memory, which only grows past the size of the allocator up front if the arena is `MEM_ARENA_RESERVE_ONLY`.
+		size_t committed   = 0;
+		MemoryArena *arena = nullptr;
+
+		StackAllocator() : Allocator(AllocatorType::Stack) {}
+	};
+
+	/**
+	 * A saved position in a stack allocator that can later be rewound to, freeing everything that was allocated after it.
+	 */
+	struct StackMarker
+	{
+		size_t used = 0;
+		void *top   = nullptr;
+	};
+
+	/**
+	 * Initialize a new stack allocator. This allocator is best used for temporary scratch memory that is allocated and freed in a nested fashion, for example the buffers of a single system or function call.
+	 * This allocator has no memory fragmentation and is very fast but memory must be freed in the reverse order it was allocated in.
+	 * In an arena that is `MEM_ARENA_RESERVE_ONLY`, memory is committed as the stack grows so a generous size costs nothing until it is used.
+	 *
+	 * @param MemoryArena *arena: The memory arena to create the allocator from.
+	 * @param size_t size: The total size that this allocator will be able to allocate in bytes.
+	 *
+	 * @return StackAllocator *: The allocator which can be now be used.
+	 *
+	 * @error The method will return nullptr if the memory arena has run out of memory and cannot allocate.
+	 *
+	 * @no_thread_safety
+	 */
+	StackAllocator *init_stack_allocator(MemoryArena *arena, size_t size);
+
+	/**
+	 * Push a chunk of memory on top of a stack allocator.
+	 *
+	 * @param StackAllocator *allocator: The allocator to use.
+	 * @param size_t size: The size of memory to allocate.
+	 * @param size_t alignment: The alignment of the returned memory, must be a power of 2.
+	 *
+	 * @return void *: The memory that can now be used.
+	 *
+	 * @error The method will return nullptr if the stack allocator doesn't have enough space to allocate or the memory could not be committed.
+	 *
+	 * @no_thread_safety
+	 */
+	void *stack_alloc(StackAllocator *allocator, size_t size, size_t alignment = 16);
+
+	/**
+	 * Pop the most recent allocation off of a stack allocator.
+	 *
+	 * @param StackAllocator *allocator: The allocator to use.
+	 * @param void *data: The data to free, this must be the most recent allocation that hasn't been freed yet.
+	 *
+	 * @error The method will assert if `data` is not on top of the stack.
+	 *
+	 * @no_thread_safety
+	 */
+	void stack_free(StackAllocator *allocator, void *data);
+
+	/**
+	 * Get a marker for the current top of a stack allocator.
+	 *
+	 * @param StackAllocator *allocator: The allocator to use.
+	 *
+	 * @return StackMarker: The marker that can be passed to `stack_free_to_marker`.
+	 *
+	 * @no_thread_safety
+	 */
+	StackMarker stack_get_marker(StackAllocator *allocator);
+
+	/**
+	 * Free everything that was allocated from a stack allocator after a marker was taken.
+	 *
+	 * @param StackAllocator *allocator: The allocator to use.
+	 * @param StackMarker marker: The marker to rewind to, which must have been taken from this allocator and not already been rewound past.
+	 *
+	 * @no_thread_safety
+	 */
+	void stack_free_to_marker(StackAllocator *allocator, StackMarker marker);
+
+	/**
+	 * Free all allocated memory from a stack allocator.
+	 *
+	 * @param StackAllocator *allocator: The allocator to use.
+	 *
+	 * @no_thread_safety
+	 */
+	void stack_clear(StackAllocator *allocator);
+
+	/**
+	 * Get statistics about the memory usage of a stack allocator. The bytes in use include the padding and headers of every allocation.
+	 *
+	 * @param StackAllocator *allocator: The allocator to inspect.
+	 * @param AllocatorStats *stats: The stats to fill in.
+	 *
+	 * @no_thread_safety
+	 */
+	void stack_get_stats(StackAllocator *allocator, AllocatorStats *stats);
+
+	/**
+	 * Takes a marker of a stack allocator when created and rewinds the stack back to it when it goes out of scope.
+	 * These can be nested, as long as the inner ones go out of scope first.
+	 */
+	struct ScopedStackMarker
+	{
+		explicit ScopedStackMarker(StackAllocator *allocator) : allocator(allocator), marker(stack_get_marker(allocator)) {}
+		~ScopedStackMarker() { stack_free_to_marker(allocator, marker); }
+
+		ScopedStackMarker(const ScopedStackMarker &other)            = delete;
+		ScopedStackMarker &operator=(const ScopedStackMarker &other) = delete;
+
+		StackAllocator *allocator = nullptr;
+		StackMarker marker{};
+	};
+} // namespace Vultr
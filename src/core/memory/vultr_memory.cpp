@@ -2,14 +2,171 @@
 #include "linear.cpp"
 #include "pool.cpp"
 #include "free_list.cpp"
+#include "stack.cpp"
+#include "frame.cpp"
+#include "heap_profiler.cpp"
+#include "alloc_trace.cpp"
 #include <platform/platform.h>
 
 namespace Vultr
 {
-	MemoryArena *init_mem_arena(size_t size, u8 alignment)
+	/**
+	 * Every memory arena that is alive, sorted by address so that the arena of a pointer can be found with a binary search.
+	 * Arenas come and go rarely while lookups happen on every generic free, so lookups never take the lock and are instead retried if the sequence changed under them.
+	 * The bounds of every arena are copied into the table so that a lookup never has to touch an arena that is being destroyed.
+	 */
+	struct MemoryArenaRegistryEntry
 	{
+		std::atomic<uintptr_t> start{0};
+		std::atomic<uintptr_t> end{0};
+		std::atomic<MemoryArena *> arena{nullptr};
+	};
+
+	struct MemoryArenaRegistry
+	{
+		SpinLock lock;
+
+		// Odd while the table is being changed.
+		atomic_u32 sequence{0};
+		atomic_u32 count{0};
+		MemoryArenaRegistryEntry entries[MAX_MEMORY_ARENAS];
+	};
+
+	static MemoryArenaRegistry g_mem_arena_registry{};
+
+	static void copy_registry_entry(MemoryArenaRegistryEntry *dst, MemoryArenaRegistryEntry *src)
+	{
+		dst->start.store(src->start.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		dst->end.store(src->end.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		dst->arena.store(src->arena.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+
+	// Index of the first arena that starts after the address.
+	static u32 registry_upper_bound(MemoryArenaRegistry *registry, u32 count, uintptr_t address)
+	{
+		u32 low  = 0;
+		u32 high = MIN(count, MAX_MEMORY_ARENAS);
+		while (low < high)
+		{
+			u32 mid = (low + high) / 2;
+			if (registry->entries[mid].start.load(std::memory_order_relaxed) <= address)
+			{
+				low = mid + 1;
+			}
+			else
+			{
+				high = mid;
+			}
+		}
+		return low;
+	}
+
+	static bool register_mem_arena(MemoryArena *arena)
+	{
+		auto *registry = &g_mem_arena_registry;
+		auto start     = reinterpret_cast<uintptr_t>(arena->memory);
+
+		spin_lock(&registry->lock);
+		u32 count = registry->count.load(std::memory_order_relaxed);
+		if (count == MAX_MEMORY_ARENAS)
+		{
+			spin_unlock(&registry->lock);
+			return false;
+		}
+
+		registry->sequence.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		u32 index = registry_upper_bound(registry, count, start);
+		for (u32 i = count; i > index; i--)
+		{
+			copy_registry_entry(&registry->entries[i], &registry->entries[i - 1]);
+		}
+		auto *entry = &registry->entries[index];
+		entry->start.store(start, std::memory_order_relaxed);
+		entry->end.store(start + Platform::get_memory_size(arena->memory), std::memory_order_relaxed);
+		entry->arena.store(arena, std::memory_order_relaxed);
+		registry->count.store(count + 1, std::memory_order_relaxed);
+
+		registry->sequence.fetch_add(1, std::memory_order_release);
+		spin_unlock(&registry->lock);
+		return true;
+	}
+
+	static void unregister_mem_arena(MemoryArena *arena)
+	{
+		auto *registry = &g_mem_arena_registry;
+
+		spin_lock(&registry->lock);
+		u32 count = registry->count.load(std::memory_order_relaxed);
+		u32 index = registry_upper_bound(registry, count, reinterpret_cast<uintptr_t>(arena->memory));
+		if (index > 0 && registry->entries[index - 1].arena.load(std::memory_order_relaxed) == arena)
+		{
+			registry->sequence.fetch_add(1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			for (u32 i = index; i < count; i++)
+			{
+				copy_registry_entry(&registry->entries[i - 1], &registry->entries[i]);
+			}
+			registry->count.store(count - 1, std::memory_order_relaxed);
+
+			registry->sequence.fetch_add(1, std::memory_order_release);
+		}
+		spin_unlock(&registry->lock);
+	}
+
+	MemoryArena *find_mem_arena(void *data)
+	{
+		auto *registry     = &g_mem_arena_registry;
+		auto address       = reinterpret_cast<uintptr_t>(data);
+		MemoryArena *found = nullptr;
+		u32 sequence;
+		do
+		{
+			sequence = registry->sequence.load(std::memory_order_acquire);
+			if (sequence & 1)
+				continue;
+
+			found     = nullptr;
+			u32 count = registry->count.load(std::memory_order_relaxed);
+			u32 index = registry_upper_bound(registry, count, address);
+			if (index > 0 && address < registry->entries[index - 1].end.load(std::memory_order_relaxed))
+			{
+				found = registry->entries[index - 1].arena.load(std::memory_order_relaxed);
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+		} while ((sequence & 1) || registry->sequence.load(std::memory_order_relaxed) != sequence);
+
+		return found;
+	}
+
+	MemoryArena *init_mem_arena(size_t size, u8 alignment, u16 flags, void *base_address)
+	{
+		u16 platform_flags = Platform::VIRTUAL_ALLOC_DEFAULT;
+		if (flags & MEM_ARENA_RESERVE_ONLY)
+		{
+			platform_flags |= Platform::VIRTUAL_ALLOC_RESERVE_ONLY;
+		}
+		if (flags & MEM_ARENA_HUGE_PAGES)
+		{
+			platform_flags |= Platform::VIRTUAL_ALLOC_HUGE_PAGES;
+		}
+		if (flags & MEM_ARENA_PREFAULT)
+		{
+			platform_flags |= Platform::VIRTUAL_ALLOC_POPULATE;
+		}
+		if (flags & MEM_ARENA_SNAPSHOTS)
+		{
+			platform_flags |= Platform::VIRTUAL_ALLOC_SNAPSHOTS;
+		}
+		if (base_address != nullptr)
+		{
+			platform_flags |= Platform::VIRTUAL_ALLOC_FIXED;
+		}
+
 		// Virtual alloc some memory.
-		auto *memory_block = Platform::virtual_alloc(nullptr, sizeof(MemoryArena) + size);
+		auto *memory_block = Platform::virtual_alloc(base_address, sizeof(MemoryArena) + size, platform_flags);
 
 		// If it returned nullptr, then we can assume that the allocation failed.
 		if (memory_block == nullptr)
@@ -18,32 +175,94 @@ namespace Vultr
 		}
 
 		// The memory allocator will be at the start of this platform memory block.
-		auto *arena            = reinterpret_cast<MemoryArena *>(Platform::get_memory(memory_block));
+		auto *arena = reinterpret_cast<MemoryArena *>(Platform::get_memory(memory_block));
+		if (!Platform::virtual_commit(memory_block, arena, sizeof(MemoryArena)))
+		{
+			Platform::virtual_free(memory_block);
+			return nullptr;
+		}
+
+		new (arena) MemoryArena();
 		arena->memory          = memory_block;
 		arena->next_free_chunk = reinterpret_cast<byte *>(arena) + sizeof(MemoryArena);
-		arena->next_index      = 0;
+		arena->flags           = flags;
+		arena->alignment       = MAX(alignment, 16);
+
+		ASSERT(std::has_single_bit(arena->alignment), "Memory arena alignment must be a power of 2!");
+
+		// Restoring an arena that was never snapshotted brings it back to empty rather than to zeroes.
+		if ((flags & MEM_ARENA_SNAPSHOTS) && !Platform::virtual_snapshot(memory_block))
+		{
+			Platform::virtual_free(memory_block);
+			return nullptr;
+		}
+
+		if (!register_mem_arena(arena))
+		{
+			Platform::virtual_free(memory_block);
+			return nullptr;
+		}
 
 		return arena;
 	}
 
-	void *mem_arena_designate(MemoryArena *arena, AllocatorType type, size_t size)
+	bool mem_arena_snapshot(MemoryArena *arena)
+	{
+		ASSERT(arena != nullptr && arena->memory != nullptr, "Invalid memory arena!");
+		if (!(arena->flags & MEM_ARENA_SNAPSHOTS))
+			return false;
+
+		return Platform::virtual_snapshot(arena->memory);
+	}
+
+	bool mem_arena_restore(MemoryArena *arena)
+	{
+		ASSERT(arena != nullptr && arena->memory != nullptr, "Invalid memory arena!");
+		if (!(arena->flags & MEM_ARENA_SNAPSHOTS))
+			return false;
+
+		// The arena header is restored along with everything else, so read what is needed out of it first.
+		auto *memory = arena->memory;
+		if (!Platform::virtual_restore(memory))
+			return false;
+
+		// Sections designated after the snapshot are gone, so threads can't keep using the regions they last looked up.
+		auto *registry = &g_mem_arena_registry;
+		spin_lock(&registry->lock);
+		registry->sequence.fetch_add(2, std::memory_order_release);
+		spin_unlock(&registry->lock);
+		return true;
+	}
+
+	void *mem_arena_designate(MemoryArena *arena, AllocatorType type, size_t size, size_t commit_size)
 	{
 		ASSERT(type != AllocatorType::None, "Cannot designate an invalid allocator!");
 
-		if (arena->next_index >= MAX_ALLOCATORS)
+		u32 index = arena->region_count.load(std::memory_order_relaxed);
+		if (index >= MAX_ALLOCATORS)
 			return nullptr;
 
 		if (arena->next_free_chunk == nullptr)
 			return nullptr;
 
-		void *chunk           = arena->next_free_chunk;
-		size_t remaining_size = Platform::get_memory_size(arena->memory) - (reinterpret_cast<byte *>(chunk) - reinterpret_cast<byte *>(arena));
-		if (remaining_size >= size)
+		// The platform memory block size includes its own header, so measure from the very start of it.
+		byte *end   = reinterpret_cast<byte *>(arena->memory) + Platform::get_memory_size(arena->memory);
+		auto *chunk = static_cast<byte *>(align_forward(arena->next_free_chunk, arena->alignment));
+		if (chunk <= end && static_cast<size_t>(end - chunk) >= size)
 		{
-			auto index                    = arena->next_index;
-			arena->allocators[index]      = chunk;
-			arena->allocator_types[index] = type;
-			arena->next_index++;
+			if (!mem_arena_commit(arena, chunk, MIN(size, commit_size)))
+				return nullptr;
+
+			// The region is filled in before it is published so that lookups on other threads never see half of it.
+			auto *region  = &arena->regions[index];
+			region->start = chunk;
+			region->end   = chunk + size;
+			region->type  = type;
+			arena->region_count.store(index + 1, std::memory_order_release);
+
+			// Move past this allocator so that the next one doesn't overlap it.
+			auto *next_free_chunk  = chunk + size;
+			arena->next_free_chunk = next_free_chunk < end ? next_free_chunk : nullptr;
 			return chunk;
 		}
 		else
@@ -52,60 +271,178 @@ namespace Vultr
 		}
 	}
 
+	bool mem_arena_commit(MemoryArena *arena, void *address, size_t size)
+	{
+		if (!(arena->flags & MEM_ARENA_RESERVE_ONLY))
+			return true;
+
+		return Platform::virtual_commit(arena->memory, address, size);
+	}
+
+	bool mem_arena_commit_to(MemoryArena *arena, void *start, size_t *committed, size_t used, size_t size)
+	{
+		if (used <= *committed)
+			return true;
+
+		size_t new_committed = MIN(MAX(used, *committed + MEM_ARENA_COMMIT_SIZE), size);
+		if (!mem_arena_commit(arena, static_cast<byte *>(start) + *committed, new_committed - *committed))
+			return false;
+
+		*committed = new_committed;
+		return true;
+	}
+
+	void mem_arena_decommit(MemoryArena *arena, void *address, size_t size) { Platform::virtual_decommit(arena->memory, address, size); }
+
+	size_t mem_arena_discard(MemoryArena *arena, void *address, size_t size) { return Platform::virtual_discard(arena->memory, address, size); }
+
+	static MemoryArenaRegion *find_region(MemoryArena *arena, void *data)
+	{
+		u32 count = arena->region_count.load(std::memory_order_acquire);
+
+		// Find the last region that starts at or before the pointer.
+		u32 low  = 0;
+		u32 high = count;
+		while (low < high)
+		{
+			u32 mid = (low + high) / 2;
+			if (arena->regions[mid].start <= data)
+			{
+				low = mid + 1;
+			}
+			else
+			{
+				high = mid;
+			}
+		}
+
+		if (low == 0)
+			return nullptr;
+
+		auto *region = &arena->regions[low - 1];
+		if (data >= region->end)
+			return nullptr;
+
+		return region;
+	}
+
+	Allocator *mem_arena_get_allocator(MemoryArena *arena, void *data)
+	{
+		auto *region = find_region(arena, data);
+		if (region == nullptr)
+			return nullptr;
+
+		return static_cast<Allocator *>(region->start);
+	}
+
+	/**
+	 * The last region every thread found an allocator in. Regions never change once they are designated, so this stays valid until an arena is created or destroyed.
+	 */
+	struct AllocatorLookupCache
+	{
+		u32 sequence = 0;
+		void *start  = nullptr;
+		void *end    = nullptr;
+	};
+
+	static thread_local AllocatorLookupCache g_allocator_lookup_cache{};
+
+	Allocator *find_allocator(void *data)
+	{
+		// Memory is usually freed in runs from the same allocator, so check the last region that was found first.
+		auto *cache  = &g_allocator_lookup_cache;
+		u32 sequence = g_mem_arena_registry.sequence.load(std::memory_order_acquire);
+		if (cache->sequence == sequence && data >= cache->start && data < cache->end)
+			return static_cast<Allocator *>(cache->start);
+
+		auto *arena = find_mem_arena(data);
+		if (arena == nullptr)
+			return nullptr;
+
+		auto *region = find_region(arena, data);
+		if (region == nullptr)
+			return nullptr;
+
+		cache->sequence = sequence;
+		cache->start    = region->start;
+		cache->end      = region->end;
+		return static_cast<Allocator *>(region->start);
+	}
+
 	void destroy_mem_arena(MemoryArena *arena)
 	{
 		ASSERT(arena != nullptr && arena->memory != nullptr, "Invalid memory arena!");
+		unregister_mem_arena(arena);
 		Platform::virtual_free(arena->memory);
 	}
 
 	void *malloc(Allocator *allocator, size_t size)
 	{
 		ASSERT(allocator != nullptr, "Cannot allocate from an invalid memory allocator!");
+		void *data = nullptr;
 		switch (allocator->type)
 		{
 			case AllocatorType::Linear:
-				return linear_alloc(static_cast<LinearAllocator *>(allocator), size);
+				data = linear_alloc(static_cast<LinearAllocator *>(allocator), size);
 				break;
 			case AllocatorType::Pool:
-				return pool_alloc(static_cast<PoolAllocator *>(allocator), size);
+				data = pool_alloc(static_cast<PoolAllocator *>(allocator), size);
 				break;
 			case AllocatorType::FreeList:
-				return free_list_alloc(static_cast<FreeListAllocator *>(allocator), size);
+				data = free_list_alloc(static_cast<FreeListAllocator *>(allocator), size);
 				break;
 			case AllocatorType::Stack:
-				NOT_IMPLEMENTED("Stack has not yet been implemented in the engine :(");
+				data = stack_alloc(static_cast<StackAllocator *>(allocator), size);
+				break;
+			case AllocatorType::Frame:
+				data = frame_allocator_alloc(static_cast<FrameAllocator *>(allocator), size);
 				break;
 			case AllocatorType::None:
 			default:
 				THROW("Invalid memory allocator, how the fuck did you even get here.");
 				return nullptr;
 		}
+		heap_profiler_record_alloc(data, size);
+		alloc_trace_record(AllocTraceOp::Alloc, allocator, data, data, size);
+		return data;
 	}
 
 	void *mrealloc(Allocator *allocator, void *memory, size_t size)
 	{
+		void *data = nullptr;
+
+		HeapProfilerReallocState profiler_state;
+		heap_profiler_record_realloc_begin(memory, &profiler_state);
 		switch (allocator->type)
 		{
 			case AllocatorType::Linear:
 				THROW("Cannot reallocate in a linear allocator, the entire point of linear is to not do that.");
 				break;
 			case AllocatorType::Pool:
-				return pool_realloc(static_cast<PoolAllocator *>(allocator), memory, size);
+				data = pool_realloc(static_cast<PoolAllocator *>(allocator), memory, size);
 				break;
 			case AllocatorType::FreeList:
-				return free_list_realloc(static_cast<FreeListAllocator *>(allocator), memory, size);
+				data = free_list_realloc(static_cast<FreeListAllocator *>(allocator), memory, size);
 				break;
 			case AllocatorType::Stack:
 				THROW("Cannot reallocate in a stack allocator, this is not what a stack allocator is for.");
 				break;
+			case AllocatorType::Frame:
+				THROW("Cannot reallocate in a frame allocator, the entire point of frame allocators is to not do that.");
+				break;
 			case AllocatorType::None:
 			default:
 				THROW("Invalid memory allocator, how the fuck did you even get here.");
 		}
+		heap_profiler_record_realloc_end(memory, data, size, profiler_state);
+		alloc_trace_record(AllocTraceOp::Realloc, allocator, memory, data, size);
+		return data;
 	}
 
-	void free(Allocator *allocator, void *memory)
+	void mfree(Allocator *allocator, void *memory)
 	{
+		heap_profiler_record_free(memory);
+		alloc_trace_record(AllocTraceOp::Free, allocator, memory, nullptr, 0);
 		switch (allocator->type)
 		{
 			case AllocatorType::Linear:
@@ -118,7 +455,49 @@ namespace Vultr
 				free_list_free(static_cast<FreeListAllocator *>(allocator), memory);
 				break;
 			case AllocatorType::Stack:
-				NOT_IMPLEMENTED("Stack has not yet been implemented in the engine :(");
+				stack_free(static_cast<StackAllocator *>(allocator), memory);
+				break;
+			case AllocatorType::Frame:
+				THROW("You cannot free individual blocks of memory from a frame allocator, they are freed when their frame comes around again.");
+				break;
+			case AllocatorType::None:
+			default:
+				THROW("Invalid memory allocator, how the fuck did you even get here.");
+		}
+	}
+
+	void free(void *memory)
+	{
+		if (memory == nullptr)
+			return;
+
+		auto *allocator = find_allocator(memory);
+		ASSERT(allocator != nullptr, "Cannot free memory that doesn't belong to any allocator!");
+		if (allocator == nullptr)
+			return;
+
+		mfree(allocator, memory);
+	}
+
+	void get_allocator_stats(Allocator *allocator, AllocatorStats *stats)
+	{
+		ASSERT(allocator != nullptr, "Cannot get the stats of an invalid memory allocator!");
+		switch (allocator->type)
+		{
+			case AllocatorType::Linear:
+				linear_get_stats(static_cast<LinearAllocator *>(allocator), stats);
+				break;
+			case AllocatorType::Pool:
+				pool_get_stats(static_cast<PoolAllocator *>(allocator), stats);
+				break;
+			case AllocatorType::FreeList:
+				free_list_get_stats(static_cast<FreeListAllocator *>(allocator), stats);
+				break;
+			case AllocatorType::Stack:
+				stack_get_stats(static_cast<StackAllocator *>(allocator), stats);
+				break;
+			case AllocatorType::Frame:
+				frame_allocator_get_stats(static_cast<FrameAllocator *>(allocator), stats);
 				break;
 			case AllocatorType::None:
 			default:
@@ -3,6 +3,11 @@
 #include "linear.h"
 #include "pool.h"
 #include "free_list.h"
+#include "stack.h"
+#include "frame.h"
+#include "allocator_stats.h"
+#include "heap_profiler.h"
+#include "alloc_trace.h"
 
 namespace Vultr
 {
@@ -39,6 +44,30 @@ namespace Vultr
 	 */
 	void mfree(Allocator *allocator, void *memory);
 
+	/**
+	 * Free a block of memory without knowing which allocator it came from. The allocator is looked up from the address, see @ref find_allocator,
+	 * so memory can be handed between subsystems without also handing over its allocator.
+	 * This fails in the same way as @ref mfree for allocators that can't free individual blocks.
+	 *
+	 * @param void *memory: The memory that was allocated from any allocator in any memory arena, or nullptr.
+	 *
+	 * @error This will assert if the memory doesn't belong to any allocator.
+	 *
+	 * @thread_safe As long as the allocator the memory belongs to is.
+	 */
+	void free(void *memory);
+
+	/**
+	 * Get a snapshot of the memory usage and fragmentation of any allocator.
+	 * The allocation counters and size histogram are only collected when the engine is built with `VULTR_ALLOCATOR_STATS`.
+	 *
+	 * @param Allocator *allocator: The memory allocator.
+	 * @param AllocatorStats *stats: The stats to fill in.
+	 *
+	 * @no_thread_safety
+	 */
+	void get_allocator_stats(Allocator *allocator, AllocatorStats *stats);
+
 	/**
 	 * Allocate some memory using a memory arena.
 	 *
@@ -52,14 +81,15 @@ namespace Vultr
 	void *persist_alloc(size_t size);
 
 	/**
-	 * Allocate some memory using a memory arena.
+	 * Allocate some temporary memory from the game's frame allocator. The memory stays valid for the current frame and the frames after it until its buffer comes around again in the ring.
 	 *
-	 * @param Allocator *allocator: The memory allocator.
 	 * @param size_t size: The size of memory to allocate.
 	 *
 	 * @return void *: The newly allocated memory.
 	 *
 	 * @error This will return nullptr if it failed to allocate.
+	 *
+	 * @no_thread_safety
 	 */
 	void *frame_alloc(size_t size);
 
@@ -130,27 +160,10 @@ namespace Vultr
 	template <typename T>
 	T *realloc(Allocator *allocator, T *memory, size_t count)
 	{
-		void *new_buf = nullptr;
-		switch (allocator->type)
-		{
-			case AllocatorType::Linear:
-				THROW("Cannot reallocate in a linear allocator, the entire point of linear is to not do that.");
-				break;
-			case AllocatorType::Pool:
-				new_buf = pool_realloc(static_cast<PoolAllocator *>(allocator), memory, sizeof(T) * count);
-				break;
-			case AllocatorType::FreeList:
-				new_buf = free_list_realloc(static_cast<FreeListAllocator *>(allocator), memory, sizeof(T) * count);
-				break;
-			case AllocatorType::Stack:
-				THROW("Cannot reallocate in a stack allocator, this is not what a stack allocator is for.");
-				break;
-			case AllocatorType::None:
-			default:
-				THROW("Invalid memory allocator, how the fuck did you even get here.");
-		}
+		// Goes through mrealloc so that the heap profiler sees it.
+		void *new_buf = mrealloc(allocator, memory, sizeof(T) * count);
 		PRODUCTION_ASSERT(new_buf != nullptr, "Failed to reallocate memory!");
-		return new_buf;
+		return static_cast<T *>(new_buf);
 	}
 
 	/**
@@ -163,7 +176,7 @@ namespace Vultr
 	void free(Allocator *allocator, T *memory)
 	{
 		// Call destructor.
-		memory.~T();
+		memory->~T();
 		mfree(allocator, memory);
 	}
 
@@ -1,6 +1,7 @@
 #pragma once
 #include <types/types.h>
 #include <string.h>
+#include <bit>
 
 namespace Vultr
 {
@@ -14,8 +15,69 @@ namespace Vultr
 		Stack    = 0x2,
 		Pool     = 0x4,
 		FreeList = 0x8,
+		Frame    = 0x10,
 	};
 
+	/**
+	 * Round a pointer up to the next multiple of `alignment`, which must be a power of 2.
+	 */
+	inline void *align_forward(void *ptr, size_t alignment)
+	{
+		auto address = reinterpret_cast<uintptr_t>(ptr);
+		return reinterpret_cast<void *>((address + alignment - 1) & ~(uintptr_t)(alignment - 1));
+	}
+
+	/**
+	 * Minimal spin lock used by allocators for short critical sections that can't afford a kernel mutex.
+	 * Lives inside allocator headers in arena memory, so it must be explicitly initialized with `spin_lock_init`.
+	 */
+	struct SpinLock
+	{
+		atomic_bool locked = false;
+	};
+
+	inline void spin_lock_init(SpinLock *lock) { lock->locked.store(false, std::memory_order_relaxed); }
+
+	inline void spin_lock(SpinLock *lock)
+	{
+		while (lock->locked.exchange(true, std::memory_order_acquire))
+		{
+			// Wait on a plain load so that contending threads don't keep stealing the cache line from each other.
+			while (lock->locked.load(std::memory_order_relaxed))
+			{
+			}
+		}
+	}
+
+	inline void spin_unlock(SpinLock *lock) { lock->locked.store(false, std::memory_order_release); }
+
+#ifndef ALLOCATOR_STATS_HISTOGRAM_BUCKETS
+	/**
+	 * The number of power of 2 size buckets in the allocation size histogram of allocator statistics. The last bucket also counts every larger allocation.
+	 */
+#define ALLOCATOR_STATS_HISTOGRAM_BUCKETS 32
+#endif
+
+#ifdef VULTR_ALLOCATOR_STATS
+	/**
+	 * Running counters kept by every allocator when allocator statistics are compiled in with `VULTR_ALLOCATOR_STATS`.
+	 * They are atomic so that allocators that can be used from multiple threads don't need a lock to update them.
+	 */
+	struct AllocatorCounters
+	{
+		atomic_size_t bytes_in_use{0};
+		atomic_size_t peak_bytes_in_use{0};
+		atomic_u64 allocation_count{0};
+		atomic_u64 live_allocations{0};
+		atomic_u64 failed_allocations{0};
+
+		// Bucket i counts allocations of at most 2^i bytes that didn't fit in bucket i - 1.
+		atomic_u64 size_histogram[ALLOCATOR_STATS_HISTOGRAM_BUCKETS]{};
+	};
+#endif
+
+	struct AllocatorStats;
+
 	/**
 	 * Base class that all allocators inherit from.
 	 */
@@ -23,14 +85,70 @@ namespace Vultr
 	{
 		Allocator(AllocatorType type) : type(type) {}
 		AllocatorType type;
+
+#ifdef VULTR_ALLOCATOR_STATS
+		AllocatorCounters counters;
+#endif
 	};
 
+	// These record allocator statistics, and compile to nothing unless `VULTR_ALLOCATOR_STATS` is defined.
+	// `size` is the number of bytes actually taken from the allocator and `requested_size` the number of bytes the caller asked for.
+
+	inline void allocator_stats_alloc([[maybe_unused]] Allocator *allocator, [[maybe_unused]] size_t requested_size, [[maybe_unused]] size_t size)
+	{
+#ifdef VULTR_ALLOCATOR_STATS
+		auto *counters = &allocator->counters;
+		size_t in_use  = counters->bytes_in_use.fetch_add(size, std::memory_order_relaxed) + size;
+		size_t peak    = counters->peak_bytes_in_use.load(std::memory_order_relaxed);
+		while (in_use > peak && !counters->peak_bytes_in_use.compare_exchange_weak(peak, in_use, std::memory_order_relaxed))
+		{
+		}
+
+		counters->allocation_count.fetch_add(1, std::memory_order_relaxed);
+		counters->live_allocations.fetch_add(1, std::memory_order_relaxed);
+
+		u32 bucket = std::bit_width(requested_size > 0 ? requested_size - 1 : 0);
+		counters->size_histogram[MIN(bucket, ALLOCATOR_STATS_HISTOGRAM_BUCKETS - 1)].fetch_add(1, std::memory_order_relaxed);
+#endif
+	}
+
+	inline void allocator_stats_free([[maybe_unused]] Allocator *allocator, [[maybe_unused]] size_t size, [[maybe_unused]] u64 count = 1)
+	{
+#ifdef VULTR_ALLOCATOR_STATS
+		allocator->counters.bytes_in_use.fetch_sub(size, std::memory_order_relaxed);
+		allocator->counters.live_allocations.fetch_sub(count, std::memory_order_relaxed);
+#endif
+	}
+
+	// For allocators that free everything at once.
+	inline void allocator_stats_free_all([[maybe_unused]] Allocator *allocator)
+	{
+#ifdef VULTR_ALLOCATOR_STATS
+		allocator->counters.bytes_in_use.store(0, std::memory_order_relaxed);
+		allocator->counters.live_allocations.store(0, std::memory_order_relaxed);
+#endif
+	}
+
+	inline void allocator_stats_failure([[maybe_unused]] Allocator *allocator)
+	{
+#ifdef VULTR_ALLOCATOR_STATS
+		allocator->counters.failed_allocations.fetch_add(1, std::memory_order_relaxed);
+#endif
+	}
+
 #ifndef MAX_ALLOCATORS
 	/**
 	 * The maximum number of different types of allocators that can be used in a memory arena.
 	 * Technically this is just the maximum number of sections within a memory arena available.
 	 */
-#define MAX_ALLOCATORS 16
+#define MAX_ALLOCATORS 64
+#endif
+
+#ifndef MAX_MEMORY_ARENAS
+	/**
+	 * The maximum number of memory arenas that can be alive at once, which is the size of the table used to find the arena any pointer belongs to.
+	 */
+#define MAX_MEMORY_ARENAS 32
 #endif
 
 	namespace Platform
@@ -38,6 +156,34 @@ namespace Vultr
 		struct PlatformMemoryBlock;
 	}
 
+	/**
+	 * Options for how the memory of a `MemoryArena` is allocated from the OS.
+	 */
+	enum MemoryArenaFlags : u16
+	{
+		MEM_ARENA_DEFAULT      = 0x0,
+		// Only reserve address space for the arena. Physical memory is committed as allocators are designated and grow, so large arenas cost nothing until they are used.
+		MEM_ARENA_RESERVE_ONLY = 0x1,
+		// Back the arena with huge pages, which cuts down on TLB misses for arenas of hundreds of megabytes or more.
+		// Explicit huge pages are used if the OS has any reserved, otherwise the OS is asked to use transparent huge pages.
+		MEM_ARENA_HUGE_PAGES   = 0x2,
+		// Fault in all of the arena's memory up front so that first touches don't show up as spikes in frame time. Ignored with `MEM_ARENA_RESERVE_ONLY`.
+		MEM_ARENA_PREFAULT     = 0x4,
+		// Back the arena with a memory file mapped copy-on-write so that it can be checkpointed with `mem_arena_snapshot` and rolled back with `mem_arena_restore`.
+		// Huge pages and prefaulting are ignored. Only supported on Linux, elsewhere creating the arena fails.
+		MEM_ARENA_SNAPSHOTS    = 0x8,
+	};
+
+	/**
+	 * A section of a memory arena that was designated for an allocator, which lives at the start of it.
+	 */
+	struct MemoryArenaRegion
+	{
+		void *start        = nullptr;
+		void *end          = nullptr;
+		AllocatorType type = AllocatorType::None;
+	};
+
 	/**
 	 * An arena of memory allocated from the OS that can be used for allocators throughout the program.
 	 * This avoids kernel-user-space switching along with other performance benefits.
@@ -45,30 +191,41 @@ namespace Vultr
 	struct MemoryArena
 	{
 		Platform::PlatformMemoryBlock *memory = nullptr;
-		AllocatorType allocator_types[MAX_ALLOCATORS];
-		void *allocators[MAX_ALLOCATORS];
-		u32 next_index        = 0;
+
+		// Regions are only ever added at the end of the arena, so they are always sorted by address.
+		MemoryArenaRegion regions[MAX_ALLOCATORS];
+		atomic_u32 region_count{0};
+
 		void *next_free_chunk = nullptr;
+		u16 flags             = MEM_ARENA_DEFAULT;
+		u8 alignment          = 16;
 	};
 
 	/**
 	 * Allocate a chunk of memory from the OS and put it in a `MemoryArena`.
 	 * @param size_t size: Size in bytes of how much space the memory arena should have.
+	 * @param u8 alignment: The alignment of every section designated in the arena, a power of 2. Sections are always aligned to at least 16 bytes.
+	 * @param u16 flags: A combination of `MemoryArenaFlags`.
+	 * @param void *base_address: Where to put the arena, which must be page aligned. The arena is created exactly at this address or not at all, so that
+	 * pointers into it stay meaningful across runs, for example in replays of snapshots. nullptr lets the OS pick.
 	 *
 	 * @return MemoryArena *: The memory arena object.
 	 *
-	 * @error The method will return nullptr if it is unable to allocate the memory arena. This should be handled properly.
+	 * @error The method will return nullptr if it is unable to allocate the memory arena, or if anything is already mapped at `base_address`. This should be handled properly.
 	 *
 	 * @thread_safe
 	 */
-	MemoryArena *init_mem_arena(size_t size, u8 alignment = 16);
+	MemoryArena *init_mem_arena(size_t size, u8 alignment = 16, u16 flags = MEM_ARENA_DEFAULT, void *base_address = nullptr);
 
 	/**
 	 * Designate a section within a memory arena for a certain type of allocator.
+	 * The section is registered so that @ref mem_arena_get_allocator can find the allocator of any pointer inside of it.
 	 *
 	 * @param MemoryArena *arena: The memory arena to use.
 	 * @param AllocatorType type: The type of allocator to use in this section.
 	 * @param size_t size: The size in bytes of the memory allocator. This includes any header information the allocator needs.
+	 * @param size_t commit_size: How many bytes at the start of the section to commit right away if the arena is `MEM_ARENA_RESERVE_ONLY`.
+	 * Allocators only commit their header here and the rest with `mem_arena_commit` as they need it, except for pool allocators which write to every block up front.
 	 *
 	 * @return void *: The new memory allocator starting pointer.
 	 *
@@ -76,9 +233,139 @@ namespace Vultr
 	 *
 	 * @no_thread_safety
 	 */
-	void *mem_arena_designate(MemoryArena *arena, AllocatorType type, size_t size);
+	void *mem_arena_designate(MemoryArena *arena, AllocatorType type, size_t size, size_t commit_size = SIZE_MAX);
+
+	/**
+	 * Commit a range of a memory arena so that it can be used. Does nothing unless the arena is `MEM_ARENA_RESERVE_ONLY`.
+	 *
+	 * @param MemoryArena *arena: The memory arena the range belongs to.
+	 * @param void *address: The start of the range.
+	 * @param size_t size: The size of the range in bytes.
+	 *
+	 * @return bool: Whether the range could be committed.
+	 *
+	 * @thread_safe
+	 */
+	bool mem_arena_commit(MemoryArena *arena, void *address, size_t size);
+
+#ifndef MEM_ARENA_COMMIT_SIZE
+	/**
+	 * The minimum number of bytes the stack, frame and free list allocators in a reserved memory arena commit at a time.
+	 */
+#define MEM_ARENA_COMMIT_SIZE Kilobyte(64)
+#endif
+
+	/**
+	 * Make sure that the first `used` bytes of a range of a memory arena are committed, for allocators that commit memory as they grow.
+	 * Anything past `*committed` is committed in steps of at least `MEM_ARENA_COMMIT_SIZE` so that growing doesn't need a system call every time.
+	 *
+	 * @param MemoryArena *arena: The memory arena the range belongs to.
+	 * @param void *start: The start of the range.
+	 * @param size_t *committed: How many bytes at the start of the range are already committed, which is updated. Start this at `size` if the arena isn't `MEM_ARENA_RESERVE_ONLY`.
+	 * @param size_t used: How many bytes at the start of the range need to be committed.
+	 * @param size_t size: The size of the range in bytes, which is never committed past.
+	 *
+	 * @return bool: Whether the memory could be committed.
+	 *
+	 * @no_thread_safety
+	 */
+	bool mem_arena_commit_to(MemoryArena *arena, void *start, size_t *committed, size_t used, size_t size);
+
+	/**
+	 * Give the physical memory of the pages fully inside of a range of a memory arena back to the OS. The contents of the range are lost.
+	 * If the arena is `MEM_ARENA_RESERVE_ONLY` the range must be committed again before it is used.
+	 *
+	 * @param MemoryArena *arena: The memory arena the range belongs to.
+	 * @param void *address: The start of the range.
+	 * @param size_t size: The size of the range in bytes.
+	 *
+	 * @thread_safe
+	 */
+	void mem_arena_decommit(MemoryArena *arena, void *address, size_t size);
+
+	/**
+	 * Let the OS reclaim the physical memory of the pages fully inside of a range of a memory arena. Unlike `mem_arena_decommit` the range stays usable.
+	 * Its contents are lost and read back as zeroes, or as their last snapshot in an arena created with `MEM_ARENA_SNAPSHOTS`.
+	 *
+	 * @param MemoryArena *arena: The memory arena the range belongs to.
+	 * @param void *address: The start of the range.
+	 * @param size_t size: The size of the range in bytes.
+	 *
+	 * @return size_t: The number of bytes that were given back to the OS.
+	 *
+	 * @thread_safe
+	 */
+	size_t mem_arena_discard(MemoryArena *arena, void *address, size_t size);
+
+	/**
+	 * Checkpoint everything in a memory arena created with `MEM_ARENA_SNAPSHOTS`, including every allocator in it, so that `mem_arena_restore` can roll back to it.
+	 * Only the pages written since the last snapshot or restore are copied, so a snapshot costs next to nothing when little has changed.
+	 *
+	 * @param MemoryArena *arena: The memory arena to snapshot.
+	 *
+	 * @return bool: Whether the snapshot was taken.
+	 *
+	 * @error Returns false if the arena wasn't created with `MEM_ARENA_SNAPSHOTS` or the snapshot couldn't be written.
+	 *
+	 * @no_thread_safety Nothing may allocate from or write to the arena while it is being snapshotted.
+	 */
+	bool mem_arena_snapshot(MemoryArena *arena);
 
-	void *mem_arena_get_allocator(MemoryArena *arena, void *data);
+	/**
+	 * Roll a memory arena created with `MEM_ARENA_SNAPSHOTS` back to its last snapshot, or to how it was created if there hasn't been one.
+	 * The arena stays at the same address, so every pointer into it, including the ones inside of its allocators, means the same thing it did at the snapshot.
+	 * Only the pages written since the last snapshot or restore are touched, and they are thrown away rather than copied.
+	 * Sections designated after the snapshot are gone, along with their allocators.
+	 *
+	 * @param MemoryArena *arena: The memory arena to restore.
+	 *
+	 * @return bool: Whether the arena was restored.
+	 *
+	 * @error Returns false if the arena wasn't created with `MEM_ARENA_SNAPSHOTS`.
+	 *
+	 * @no_thread_safety Nothing may use the arena while it is being restored.
+	 */
+	bool mem_arena_restore(MemoryArena *arena);
+
+	/**
+	 * Find the allocator that owns a pointer, which is the allocator at the start of the section of the memory arena the pointer is in.
+	 *
+	 * @param MemoryArena *arena: The memory arena to look in.
+	 * @param void *data: Any pointer into a designated section of the arena.
+	 *
+	 * @return Allocator *: The allocator the pointer belongs to.
+	 *
+	 * @error Returns nullptr if the pointer isn't in any designated section of the arena.
+	 *
+	 * @thread_safe
+	 */
+	Allocator *mem_arena_get_allocator(MemoryArena *arena, void *data);
+
+	/**
+	 * Find the memory arena a pointer belongs to out of every arena that is alive. The search is a binary search over the arenas, which are kept sorted by address.
+	 *
+	 * @param void *data: Any pointer into a memory arena.
+	 *
+	 * @return MemoryArena *: The memory arena the pointer belongs to.
+	 *
+	 * @error Returns nullptr if the pointer isn't in any memory arena.
+	 *
+	 * @thread_safe
+	 */
+	MemoryArena *find_mem_arena(void *data);
+
+	/**
+	 * Find the allocator that owns a pointer out of every memory arena that is alive, so that memory can be freed without knowing where it came from.
+	 *
+	 * @param void *data: Any pointer into a designated section of a memory arena.
+	 *
+	 * @return Allocator *: The allocator the pointer belongs to.
+	 *
+	 * @error Returns nullptr if the pointer doesn't belong to any allocator.
+	 *
+	 * @thread_safe
+	 */
+	Allocator *find_allocator(void *data);
 
 	/**
 	 * Free a `MemoryArena` from the OS.
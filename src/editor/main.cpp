@@ -28,6 +28,9 @@ int Vultr::vultr_main(Platform::EntryArgs *args)
 		update();
 		Platform::swap_buffers(window);
 		Platform::poll_events(window);
+
+		// Frame boundary, free whatever was allocated `FRAMES_IN_FLIGHT` frames ago.
+		frame_allocator_rotate(g_game_memory->frame_storage);
 	}
 	Platform::close_window(window);
 
@@ -67,6 +67,8 @@ namespace Vultr
 	template <typename T>
 	struct ResourceCache
 	{
+		explicit ResourceCache(Allocator *allocator) : cache(allocator) {}
+
 		vtl::DynamicArray<ResourceData<T>> cache;
 
 		// std::unordered_map<size_t, VFileHandle> asset_to_index{};
@@ -85,7 +87,10 @@ namespace Vultr
 
 		vtl::mutex mutex;
 
-		ResourceManager()  = default;
+		explicit ResourceManager(Allocator *allocator)
+			: free_queue(allocator), load_queue(allocator), finalize_queue(allocator), texture_cache(allocator), shader_cache(allocator), mesh_cache(allocator)
+		{
+		}
 		~ResourceManager() = default;
 
 		template <typename T>
@@ -0,0 +1,52 @@
+#include <types/types.h>
+#include "../platform.h"
+#include <execinfo.h>
+#include <dlfcn.h>
+#include <cxxabi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace Vultr
+{
+	namespace Platform
+	{
+		u32 capture_stack_trace(void **frames, u32 max_frames, u32 skip)
+		{
+			// Don't count this function itself.
+			skip++;
+
+			void *buffer[128];
+			s32 depth = backtrace(buffer, static_cast<s32>(MIN(max_frames + skip, 128u)));
+			if (depth <= static_cast<s32>(skip))
+				return 0;
+
+			u32 count = static_cast<u32>(depth) - skip;
+			memcpy(frames, buffer + skip, count * sizeof(void *));
+			return count;
+		}
+
+		bool get_symbol_name(void *address, char *buffer, size_t size)
+		{
+			Dl_info info{};
+			if (dladdr(address, &info) == 0)
+			{
+				snprintf(buffer, size, "%p", address);
+				return false;
+			}
+
+			if (info.dli_sname == nullptr)
+			{
+				// Without a symbol the best we can do is the module and the offset into it.
+				const char *module = info.dli_fname != nullptr ? info.dli_fname : "?";
+				snprintf(buffer, size, "%s+0x%zx", module, static_cast<size_t>(reinterpret_cast<byte *>(address) - reinterpret_cast<byte *>(info.dli_fbase)));
+				return false;
+			}
+
+			s32 status      = 0;
+			char *demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+			snprintf(buffer, size, "%s", status == 0 ? demangled : info.dli_sname);
+			::free(demangled);
+			return true;
+		}
+	} // namespace Platform
+} // namespace Vultr
@@ -0,0 +1,50 @@
+#include <types/types.h>
+#include "../platform.h"
+#include <windows.h>
+#include <dbghelp.h>
+#include <stdio.h>
+
+#pragma comment(lib, "dbghelp.lib")
+
+namespace Vultr
+{
+	namespace Platform
+	{
+		u32 capture_stack_trace(void **frames, u32 max_frames, u32 skip)
+		{
+			// Don't count this function itself.
+			return RtlCaptureStackBackTrace(skip + 1, max_frames, frames, nullptr);
+		}
+
+		bool get_symbol_name(void *address, char *buffer, size_t size)
+		{
+			// DbgHelp is single threaded, so every call into it has to be serialized.
+			static SRWLOCK lock     = SRWLOCK_INIT;
+			static bool initialized = false;
+
+			AcquireSRWLockExclusive(&lock);
+			if (!initialized)
+			{
+				SymSetOptions(SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS);
+				initialized = SymInitialize(GetCurrentProcess(), nullptr, TRUE);
+			}
+
+			byte symbol_buffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME];
+			auto *symbol         = reinterpret_cast<SYMBOL_INFO *>(symbol_buffer);
+			symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+			symbol->MaxNameLen   = MAX_SYM_NAME;
+
+			bool found = initialized && SymFromAddr(GetCurrentProcess(), reinterpret_cast<DWORD64>(address), nullptr, symbol);
+			if (found)
+			{
+				snprintf(buffer, size, "%s", symbol->Name);
+			}
+			else
+			{
+				snprintf(buffer, size, "%p", address);
+			}
+			ReleaseSRWLockExclusive(&lock);
+			return found;
+		}
+	} // namespace Platform
+} // namespace Vultr
@@ -1,6 +1,8 @@
 #include <types/types.h>
 #include "../platform.h"
 #include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace Vultr
 {
@@ -9,6 +11,10 @@ namespace Vultr
 		struct PlatformMemoryBlock
 		{
 			size_t size;
+			u16 flags;
+
+			// The memory file behind blocks allocated with `VIRTUAL_ALLOC_SNAPSHOTS`, which holds their last snapshot. -1 for every other block.
+			int fd;
 		};
 
 		void *get_memory(PlatformMemoryBlock *block)
@@ -24,29 +30,346 @@ namespace Vultr
 			return block->size;
 		}
 
-		PlatformMemoryBlock *virtual_alloc(void *address_hint, size_t size)
+		size_t get_page_size()
+		{
+			static size_t page_size = sysconf(_SC_PAGESIZE);
+			return page_size;
+		}
+
+		static byte *page_round_down(void *address) { return reinterpret_cast<byte *>(reinterpret_cast<uintptr_t>(address) & ~(get_page_size() - 1)); }
+		static byte *page_round_up(void *address) { return page_round_down(reinterpret_cast<byte *>(address) + get_page_size() - 1); }
+
+		// Size of the huge pages used for both hugetlbfs and transparent huge pages on x86-64 and aarch64 with 4KB base pages.
+		static constexpr size_t HUGE_PAGE_SIZE = Megabyte(2);
+
+		// Map memory at an address aligned to `alignment` by over-allocating and unmapping what hangs over on either side.
+		static void *mmap_aligned(void *address_hint, size_t size, size_t alignment, int protection, int map_flags)
+		{
+			size_t padded_size = size + alignment;
+			auto *memory       = static_cast<byte *>(mmap(address_hint, padded_size, protection, map_flags, -1, 0));
+			if (memory == MAP_FAILED)
+				return MAP_FAILED;
+
+			auto *aligned = reinterpret_cast<byte *>((reinterpret_cast<uintptr_t>(memory) + alignment - 1) & ~(alignment - 1));
+			auto *end     = page_round_up(aligned + size);
+			if (aligned != memory)
+			{
+				munmap(memory, aligned - memory);
+			}
+			if (end != memory + padded_size)
+			{
+				munmap(end, memory + padded_size - end);
+			}
+			return aligned;
+		}
+
+		// Fault in every page of a range right away so that the first touch doesn't happen in the middle of a frame.
+		static void prefault(void *memory, size_t size)
+		{
+#ifdef MADV_POPULATE_WRITE
+			if (madvise(memory, size, MADV_POPULATE_WRITE) == 0)
+				return;
+#endif
+			// Older kernels don't support populating through madvise, so just write to every page.
+			for (size_t offset = 0; offset < size; offset += get_page_size())
+			{
+				static_cast<volatile byte *>(memory)[offset] = 0;
+			}
+		}
+
+		// Write a whole range to a file, even if it takes more than one write.
+		static bool write_all(int fd, const byte *data, size_t size, off_t offset)
+		{
+			while (size > 0)
+			{
+				ssize_t written = pwrite(fd, data, size, offset);
+				if (written <= 0)
+					return false;
+
+				data += written;
+				size -= written;
+				offset += written;
+			}
+			return true;
+		}
+
+		// Bits of the entries of /proc/self/pagemap, one 64 bit entry per page.
+		static constexpr u64 PAGEMAP_PRESENT = 1ull << 63;
+		static constexpr u64 PAGEMAP_SWAPPED = 1ull << 62;
+		static constexpr u64 PAGEMAP_FILE    = 1ull << 61;
+
+		static int get_pagemap_fd()
+		{
+			static int fd = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+			return fd;
+		}
+
+		// Call `callback(first_page, page_count)` for every run of pages of a snapshot block that was written to since the last snapshot or restore, stopping if it returns false.
+		// Written pages are the private copies of the memory file, which the pagemap shows as present or swapped pages that aren't backed by a file.
+		// If the pagemap can't be read, the whole block is treated as written.
+		template <typename Callback>
+		static bool for_each_written_range(PlatformMemoryBlock *block, Callback callback)
+		{
+			size_t page_size  = get_page_size();
+			size_t page_count = (page_round_up(reinterpret_cast<byte *>(block) + block->size) - reinterpret_cast<byte *>(block)) / page_size;
+			size_t first_page = reinterpret_cast<uintptr_t>(block) / page_size;
+
+			int pagemap = get_pagemap_fd();
+			if (pagemap == -1)
+				return callback(0, page_count);
+
+			u64 entries[1024];
+			size_t run_start  = 0;
+			size_t run_length = 0;
+			for (size_t page = 0; page < page_count; page += 1024)
+			{
+				size_t count = MIN(page_count - page, static_cast<size_t>(1024));
+				if (pread(pagemap, entries, count * sizeof(u64), (first_page + page) * sizeof(u64)) != static_cast<ssize_t>(count * sizeof(u64)))
+					return callback(0, page_count);
+
+				for (size_t i = 0; i < count; i++)
+				{
+					u64 entry    = entries[i];
+					bool written = (entry & PAGEMAP_SWAPPED) || ((entry & PAGEMAP_PRESENT) && !(entry & PAGEMAP_FILE));
+					if (written)
+					{
+						if (run_length == 0)
+						{
+							run_start = page + i;
+						}
+						run_length++;
+					}
+					else if (run_length > 0)
+					{
+						if (!callback(run_start, run_length))
+							return false;
+						run_length = 0;
+					}
+				}
+			}
+
+			if (run_length > 0)
+				return callback(run_start, run_length);
+
+			return true;
+		}
+
+		PlatformMemoryBlock *virtual_alloc(void *address_hint, size_t size, u16 flags)
 		{
 			size_t total_size = size + sizeof(PlatformMemoryBlock);
 
-			// TODO(Brandon): Handle some flags
-			void *memory = mmap(address_hint, total_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			// Reserved memory is mapped without any access so the kernel doesn't have to back it with anything until it is committed.
+			bool reserve_only = flags & VIRTUAL_ALLOC_RESERVE_ONLY;
+			bool snapshots    = flags & VIRTUAL_ALLOC_SNAPSHOTS;
+			bool fixed        = flags & VIRTUAL_ALLOC_FIXED;
+			bool huge_pages   = (flags & VIRTUAL_ALLOC_HUGE_PAGES) && !snapshots;
+			bool populate     = (flags & VIRTUAL_ALLOC_POPULATE) && !reserve_only && !snapshots;
+			int protection    = reserve_only ? PROT_NONE : PROT_READ | PROT_WRITE;
+			int map_flags     = MAP_PRIVATE | MAP_ANONYMOUS;
+			if (reserve_only)
+			{
+				map_flags |= MAP_NORESERVE;
+			}
+
+			if (fixed)
+			{
+				ASSERT(address_hint != nullptr && page_round_down(address_hint) == address_hint, "A fixed memory block needs a page aligned address!");
+#ifdef MAP_FIXED_NOREPLACE
+				map_flags |= MAP_FIXED_NOREPLACE;
+#endif
+			}
+
+			void *memory = MAP_FAILED;
+			int fd       = -1;
+
+			if (snapshots)
+			{
+				// The memory file holds the last snapshot and the private mapping of it every page written since, which the kernel copies from the file on the first write.
+				fd = memfd_create("vultr_snapshot_memory", MFD_CLOEXEC);
+				if (fd == -1)
+					return nullptr;
+
+				if (ftruncate(fd, total_size) != 0)
+				{
+					close(fd);
+					return nullptr;
+				}
+
+				memory = mmap(address_hint, total_size, protection, map_flags & ~MAP_ANONYMOUS, fd, 0);
+				if (memory == MAP_FAILED)
+				{
+					close(fd);
+					return nullptr;
+				}
+			}
+
+			// Explicit huge pages only exist if the system has reserved some for hugetlbfs. They also can't be committed one small page at a time, so reserved memory never uses them.
+			if (huge_pages && !reserve_only)
+			{
+				size_t huge_size = (total_size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+				memory           = mmap(address_hint, huge_size, protection, map_flags | MAP_HUGETLB | (populate ? MAP_POPULATE : 0), -1, 0);
+				if (memory != MAP_FAILED)
+				{
+					total_size = huge_size;
+					populate   = false;
+				}
+			}
+
+			if (memory == MAP_FAILED && huge_pages)
+			{
+				// Fall back to transparent huge pages, which the kernel can only use for huge page aligned ranges.
+				// Prefaulting has to wait until after the advice, otherwise the range would already be backed by small pages.
+				memory = fixed ? mmap(address_hint, total_size, protection, map_flags, -1, 0) : mmap_aligned(address_hint, total_size, HUGE_PAGE_SIZE, protection, map_flags);
+				if (memory != MAP_FAILED)
+				{
+					madvise(memory, total_size, MADV_HUGEPAGE);
+				}
+			}
+
+			// Huge pages are only a hint, so if they didn't work out, for example because there wasn't enough address space to align the mapping, use regular pages.
+			if (memory == MAP_FAILED)
+			{
+				memory   = mmap(address_hint, total_size, protection, map_flags | (populate ? MAP_POPULATE : 0), -1, 0);
+				populate = false;
+			}
 
 			// If the allocation failed.
-			if (memory == (void *)-1)
+			if (memory == MAP_FAILED)
 				return nullptr;
 
-			auto *block = reinterpret_cast<PlatformMemoryBlock *>(memory);
-			block->size = total_size;
+			// Kernels older than 4.17 don't know about MAP_FIXED_NOREPLACE and treat the address as a hint.
+			if (fixed && memory != address_hint)
+			{
+				munmap(memory, total_size);
+				if (fd != -1)
+				{
+					close(fd);
+				}
+				return nullptr;
+			}
+
+			if (populate)
+			{
+				prefault(memory, total_size);
+			}
+
+			// The header always has to be accessible.
+			if (reserve_only && mprotect(memory, get_page_size(), PROT_READ | PROT_WRITE) != 0)
+			{
+				munmap(memory, total_size);
+				if (fd != -1)
+				{
+					close(fd);
+				}
+				return nullptr;
+			}
+
+			auto *block  = reinterpret_cast<PlatformMemoryBlock *>(memory);
+			block->size  = total_size;
+			block->flags = flags;
+			block->fd    = fd;
+
+			// The header has to survive restoring a block that was never snapshotted.
+			if (snapshots && !write_all(fd, reinterpret_cast<byte *>(block), sizeof(PlatformMemoryBlock), 0))
+			{
+				munmap(memory, total_size);
+				close(fd);
+				return nullptr;
+			}
 
 			return block;
 		}
 
+		bool virtual_commit(PlatformMemoryBlock *block, void *address, size_t size)
+		{
+			ASSERT(block != nullptr, "Cannot commit an invalid memory block.");
+			if (!(block->flags & VIRTUAL_ALLOC_RESERVE_ONLY))
+				return true;
+
+			byte *start = page_round_down(address);
+			byte *end   = page_round_up(reinterpret_cast<byte *>(address) + size);
+			ASSERT(start >= reinterpret_cast<byte *>(block) && end <= page_round_up(reinterpret_cast<byte *>(block) + block->size), "Cannot commit a range outside of the memory block.");
+
+			return mprotect(start, end - start, PROT_READ | PROT_WRITE) == 0;
+		}
+
+		void virtual_decommit(PlatformMemoryBlock *block, void *address, size_t size)
+		{
+			ASSERT(block != nullptr, "Cannot decommit an invalid memory block.");
+
+			// Partially covered pages might still hold data that is in use, so only touch the pages fully inside of the range.
+			byte *start = page_round_up(address);
+			byte *end   = page_round_down(reinterpret_cast<byte *>(address) + size);
+			if (start >= end)
+				return;
+
+			madvise(start, end - start, MADV_DONTNEED);
+			if (block->flags & VIRTUAL_ALLOC_RESERVE_ONLY)
+			{
+				mprotect(start, end - start, PROT_NONE);
+			}
+		}
+
+		size_t virtual_discard([[maybe_unused]] PlatformMemoryBlock *block, void *address, size_t size)
+		{
+			ASSERT(block != nullptr, "Cannot discard an invalid memory block.");
+
+			// Partially covered pages might still hold data that is in use, so only touch the pages fully inside of the range.
+			byte *start = page_round_up(address);
+			byte *end   = page_round_down(reinterpret_cast<byte *>(address) + size);
+			if (start >= end)
+				return 0;
+
+			// MADV_DONTNEED drops the pages right away, unlike MADV_FREE which only lowers RSS once the system is under memory pressure.
+			if (madvise(start, end - start, MADV_DONTNEED) != 0)
+				return 0;
+
+			return end - start;
+		}
+
+		bool virtual_snapshot(PlatformMemoryBlock *block)
+		{
+			ASSERT(block != nullptr, "Cannot snapshot an invalid memory block.");
+			if (!(block->flags & VIRTUAL_ALLOC_SNAPSHOTS))
+				return false;
+
+			int fd           = block->fd;
+			auto *base       = reinterpret_cast<byte *>(block);
+			size_t page_size = get_page_size();
+			return for_each_written_range(block, [&](size_t first_page, size_t page_count) {
+				size_t offset = first_page * page_size;
+				size_t size   = page_count * page_size;
+				if (!write_all(fd, base + offset, size, offset))
+					return false;
+
+				// Drop the private copies so that the range shares the pages of the memory file again until it is written to next.
+				madvise(base + offset, size, MADV_DONTNEED);
+				return true;
+			});
+		}
+
+		bool virtual_restore(PlatformMemoryBlock *block)
+		{
+			ASSERT(block != nullptr, "Cannot restore an invalid memory block.");
+			if (!(block->flags & VIRTUAL_ALLOC_SNAPSHOTS))
+				return false;
+
+			// Dropping the private copies of a file mapping maps the pages of the file back in, so there is nothing to copy.
+			auto *base       = reinterpret_cast<byte *>(block);
+			size_t page_size = get_page_size();
+			return for_each_written_range(block, [&](size_t first_page, size_t page_count) { return madvise(base + first_page * page_size, page_count * page_size, MADV_DONTNEED) == 0; });
+		}
+
 		void virtual_free(PlatformMemoryBlock *block)
 		{
 			ASSERT(block != nullptr, "Cannot free an invliad memory block.");
 			auto size = block->size;
-			// TODO(Brandon): Handle some flags
+			int fd    = block->fd;
 			munmap(block, size);
+			if (fd != -1)
+			{
+				close(fd);
+			}
 		}
 	} // namespace Platform
 } // namespace Vultr
@@ -8,6 +8,7 @@ namespace Vultr
 		struct PlatformMemoryBlock
 		{
 			size_t size;
+			u16 flags;
 		};
 
 		void *get_memory(PlatformMemoryBlock *block)
@@ -23,29 +24,145 @@ namespace Vultr
 			return block->size;
 		}
 
-		PlatformMemoryBlock *virtual_alloc(void *address_hint, size_t size)
+		size_t get_page_size()
+		{
+			static size_t page_size = []() {
+				SYSTEM_INFO info;
+				GetSystemInfo(&info);
+				return (size_t)info.dwPageSize;
+			}();
+			return page_size;
+		}
+
+		static byte *page_round_down(void *address) { return reinterpret_cast<byte *>(reinterpret_cast<uintptr_t>(address) & ~(get_page_size() - 1)); }
+		static byte *page_round_up(void *address) { return page_round_down(reinterpret_cast<byte *>(address) + get_page_size() - 1); }
+
+		PlatformMemoryBlock *virtual_alloc(void *address_hint, size_t size, u16 flags)
 		{
 			size_t total_size = size + sizeof(PlatformMemoryBlock);
 
-			// TODO(Brandon): Handle some flags
-			void *memory = VirtualAlloc(address_hint, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+			if (flags & VIRTUAL_ALLOC_SNAPSHOTS)
+				return nullptr;
+
+			bool reserve_only = flags & VIRTUAL_ALLOC_RESERVE_ONLY;
+			void *memory      = nullptr;
+
+			// Large pages need the "Lock pages in memory" privilege and have to be committed all at once, so fall back to regular pages when they aren't available.
+			size_t large_page_size = GetLargePageMinimum();
+			if ((flags & VIRTUAL_ALLOC_HUGE_PAGES) && !reserve_only && large_page_size != 0)
+			{
+				size_t large_size = (total_size + large_page_size - 1) & ~(large_page_size - 1);
+				memory            = VirtualAlloc(address_hint, large_size, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+				if (memory != nullptr)
+				{
+					total_size = large_size;
+				}
+			}
+
+			if (memory == nullptr)
+			{
+				memory = VirtualAlloc(address_hint, total_size, reserve_only ? MEM_RESERVE : MEM_COMMIT | MEM_RESERVE, reserve_only ? PAGE_NOACCESS : PAGE_READWRITE);
+			}
 
 			// If the allocation failed.
 			if (memory == nullptr)
 				return nullptr;
 
-			auto *block = reinterpret_cast<PlatformMemoryBlock *>(memory);
-			block->size = total_size;
+			// VirtualAlloc rounds the address down to the allocation granularity, which would move the block.
+			if ((flags & VIRTUAL_ALLOC_FIXED) && memory != address_hint)
+			{
+				VirtualFree(memory, 0, MEM_RELEASE);
+				return nullptr;
+			}
+
+			// Fault in every page right away so that the first touch doesn't happen in the middle of a frame.
+			if ((flags & VIRTUAL_ALLOC_POPULATE) && !reserve_only)
+			{
+				for (size_t offset = 0; offset < total_size; offset += get_page_size())
+				{
+					static_cast<volatile byte *>(memory)[offset] = 0;
+				}
+			}
+
+			// The header always has to be accessible.
+			if (reserve_only && VirtualAlloc(memory, get_page_size(), MEM_COMMIT, PAGE_READWRITE) == nullptr)
+			{
+				VirtualFree(memory, 0, MEM_RELEASE);
+				return nullptr;
+			}
+
+			auto *block  = reinterpret_cast<PlatformMemoryBlock *>(memory);
+			block->size  = total_size;
+			block->flags = flags;
 
 			return block;
 		}
 
+		bool virtual_commit(PlatformMemoryBlock *block, void *address, size_t size)
+		{
+			ASSERT(block != nullptr, "Cannot commit an invalid memory block.");
+			if (!(block->flags & VIRTUAL_ALLOC_RESERVE_ONLY))
+				return true;
+
+			byte *start = page_round_down(address);
+			byte *end   = page_round_up(reinterpret_cast<byte *>(address) + size);
+			return VirtualAlloc(start, end - start, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+		}
+
+		void virtual_decommit(PlatformMemoryBlock *block, void *address, size_t size)
+		{
+			ASSERT(block != nullptr, "Cannot decommit an invalid memory block.");
+
+			// Partially covered pages might still hold data that is in use, so only touch the pages fully inside of the range.
+			byte *start = page_round_up(address);
+			byte *end   = page_round_down(reinterpret_cast<byte *>(address) + size);
+			if (start >= end)
+				return;
+
+			if (block->flags & VIRTUAL_ALLOC_RESERVE_ONLY)
+			{
+				VirtualFree(start, end - start, MEM_DECOMMIT);
+			}
+			else
+			{
+				// Memory that was committed up front has to stay accessible.
+				virtual_discard(block, start, end - start);
+			}
+		}
+
+		size_t virtual_discard([[maybe_unused]] PlatformMemoryBlock *block, void *address, size_t size)
+		{
+			ASSERT(block != nullptr, "Cannot discard an invalid memory block.");
+
+			// Partially covered pages might still hold data that is in use, so only touch the pages fully inside of the range.
+			byte *start = page_round_up(address);
+			byte *end   = page_round_down(reinterpret_cast<byte *>(address) + size);
+			if (start >= end)
+				return 0;
+
+			// Decommitting and committing again is the only way to guarantee that the pages read back as zeroes.
+			if (!VirtualFree(start, end - start, MEM_DECOMMIT) || VirtualAlloc(start, end - start, MEM_COMMIT, PAGE_READWRITE) == nullptr)
+				return 0;
+
+			return end - start;
+		}
+
+		bool virtual_snapshot(PlatformMemoryBlock *block)
+		{
+			ASSERT(block != nullptr, "Cannot snapshot an invalid memory block.");
+			return false;
+		}
+
+		bool virtual_restore(PlatformMemoryBlock *block)
+		{
+			ASSERT(block != nullptr, "Cannot restore an invalid memory block.");
+			return false;
+		}
+
 		void virtual_free(PlatformMemoryBlock *block)
 		{
 			ASSERT(block != nullptr, "Cannot free an invliad memory block.");
-			auto size = block->size;
-			// TODO(Brandon): Handle some flags
-			VirtualFree(block, 0, MEM_FREE);
+			VirtualFree(block, 0, MEM_RELEASE);
 		}
 	} // namespace Platform
 } // namespace Vultr
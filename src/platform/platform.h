@@ -38,17 +38,116 @@ namespace Vultr
 		 */
 		size_t get_memory_size(PlatformMemoryBlock *block);
 
+		/**
+		 * Options for how virtual memory is allocated from the operating system.
+		 */
+		enum VirtualAllocFlags : u16
+		{
+			VIRTUAL_ALLOC_DEFAULT      = 0x0,
+			// Only reserve the address space, no physical memory is used until a range is committed with `virtual_commit`.
+			VIRTUAL_ALLOC_RESERVE_ONLY = 0x1,
+			// Back the memory with huge pages to cut down on TLB misses. Explicit huge pages are used if the OS has any reserved, otherwise the OS is asked to use transparent huge pages.
+			VIRTUAL_ALLOC_HUGE_PAGES   = 0x2,
+			// Fault in all of the memory up front instead of on first touch. Ignored for `VIRTUAL_ALLOC_RESERVE_ONLY`.
+			VIRTUAL_ALLOC_POPULATE     = 0x4,
+			// Back the memory with a memory file that is mapped copy-on-write, so that its contents can be saved with `virtual_snapshot` and brought back with `virtual_restore`.
+			// Huge pages and populating are ignored. Only supported on Linux, on Windows the allocation fails and `virtual_snapshot` and `virtual_restore` always return false.
+			VIRTUAL_ALLOC_SNAPSHOTS    = 0x8,
+			// The memory must be placed exactly at the address hint, otherwise the allocation fails. Nothing that is already mapped there is ever replaced.
+			VIRTUAL_ALLOC_FIXED        = 0x10,
+		};
+
 		/**
 		 * Reserves virtual address space memory from the operating system.
 		 *
-		 * @param void *address_hint: The requested address of the memory block. Does not have to be followed.
+		 * @param void *address_hint: The requested address of the memory block. Does not have to be followed unless `VIRTUAL_ALLOC_FIXED` is passed.
 		 * @param size_t size: The size of memory to allocate.
+		 * @param u16 flags: A combination of `VirtualAllocFlags`. The memory block header itself is always committed.
 		 *
 		 * @error Will return nullptr if the allocation failed.
 		 *
 		 * @thread_safe
 		 */
-		PlatformMemoryBlock *virtual_alloc(void *address_hint, size_t size);
+		PlatformMemoryBlock *virtual_alloc(void *address_hint, size_t size, u16 flags = VIRTUAL_ALLOC_DEFAULT);
+
+		/**
+		 * Commit a range of a reserved memory block so that it can be read and written. Already committed pages are left untouched.
+		 * Does nothing for memory blocks that were not allocated with `VIRTUAL_ALLOC_RESERVE_ONLY`, since they are committed from the start.
+		 *
+		 * @param PlatformMemoryBlock *block: The memory block the range belongs to.
+		 * @param void *address: The start of the range, it will be rounded down to a page boundary.
+		 * @param size_t size: The size of the range, the end will be rounded up to a page boundary.
+		 *
+		 * @return bool: Whether the range could be committed.
+		 *
+		 * @thread_safe
+		 */
+		bool virtual_commit(PlatformMemoryBlock *block, void *address, size_t size);
+
+		/**
+		 * Give the physical memory behind a range of a memory block back to the operating system. The contents of the range are lost.
+		 * For memory blocks allocated with `VIRTUAL_ALLOC_RESERVE_ONLY` the range must be committed again before it is used.
+		 * Only pages that are entirely inside of the range are decommitted.
+		 *
+		 * @param PlatformMemoryBlock *block: The memory block the range belongs to.
+		 * @param void *address: The start of the range.
+		 * @param size_t size: The size of the range.
+		 *
+		 * @thread_safe
+		 */
+		void virtual_decommit(PlatformMemoryBlock *block, void *address, size_t size);
+
+		/**
+		 * Let the operating system reclaim the physical memory behind a range of a memory block while keeping the range usable.
+		 * The contents of the range are lost and read back as zeroes, or as their last snapshot for memory blocks allocated with `VIRTUAL_ALLOC_SNAPSHOTS`.
+		 * Only pages that are entirely inside of the range are discarded.
+		 *
+		 * @param PlatformMemoryBlock *block: The memory block the range belongs to.
+		 * @param void *address: The start of the range.
+		 * @param size_t size: The size of the range.
+		 *
+		 * @return size_t: The number of bytes that were discarded.
+		 *
+		 * @thread_safe
+		 */
+		size_t virtual_discard(PlatformMemoryBlock *block, void *address, size_t size);
+
+		/**
+		 * Save the contents of a memory block allocated with `VIRTUAL_ALLOC_SNAPSHOTS`, so that `virtual_restore` can bring them back later.
+		 * Only the pages written since the last snapshot or restore are copied, so this is cheap when little has changed.
+		 *
+		 * @param PlatformMemoryBlock *block: The memory block to snapshot.
+		 *
+		 * @return bool: Whether the snapshot was taken.
+		 *
+		 * @error Returns false if the memory block doesn't support snapshots or the snapshot couldn't be written.
+		 *
+		 * @no_thread_safety The memory block must not be written to while it is being snapshotted.
+		 */
+		bool virtual_snapshot(PlatformMemoryBlock *block);
+
+		/**
+		 * Bring back the contents of a memory block allocated with `VIRTUAL_ALLOC_SNAPSHOTS` to what they were at the last `virtual_snapshot`, or to zeroes if there hasn't been one since it was allocated.
+		 * The memory stays at the same address. Only the pages written since the last snapshot or restore are touched, and they are thrown away rather than copied.
+		 *
+		 * @param PlatformMemoryBlock *block: The memory block to restore.
+		 *
+		 * @return bool: Whether the memory block was restored.
+		 *
+		 * @error Returns false if the memory block doesn't support snapshots.
+		 *
+		 * @no_thread_safety The memory block must not be used while it is being restored.
+		 */
+		bool virtual_restore(PlatformMemoryBlock *block);
+
+		/**
+		 * Get the granularity that memory is committed and decommitted in.
+		 *
+		 * @return size_t: The page size in bytes.
+		 *
+		 * @thread_safe
+		 */
+		size_t get_page_size();
 
 		/**
 		 * Frees virtual address memory from the operating system.
@@ -66,6 +165,27 @@ namespace Vultr
 		 */
 		struct Thread;
 
+		/**
+		 * Put the calling thread to sleep as long as the value at an address is still `expected`, without spinning. Built on futexes on Linux and `WaitOnAddress` on Windows.
+		 * The thread can also wake up spuriously, so the caller has to check the value again afterwards.
+		 *
+		 * @param atomic_u32 *address: The value to wait on.
+		 * @param u32 expected: The value to sleep through.
+		 *
+		 * @thread_safe
+		 */
+		void wait_on_address(atomic_u32 *address, u32 expected);
+
+		/**
+		 * Wake threads sleeping in @ref wait_on_address on an address.
+		 *
+		 * @param atomic_u32 *address: The value the threads are waiting on.
+		 * @param bool all: Whether to wake every waiting thread or just one of them.
+		 *
+		 * @thread_safe
+		 */
+		void wake_on_address(atomic_u32 *address, bool all = false);
+
 		/**
 		 * Load a dynamic library into memory.
 		 *
@@ -113,6 +233,32 @@ namespace Vultr
 		 */
 		void *dl_load_symbol(void *dll, const char *symbol);
 
+		/**
+		 * Capture the return addresses of the calling thread's stack, innermost call first.
+		 *
+		 * @param void **frames: The buffer to write the return addresses to.
+		 * @param u32 max_frames: The maximum number of addresses to write.
+		 * @param u32 skip: The number of innermost calls to leave out, not counting this function itself.
+		 *
+		 * @return u32: The number of addresses that were written.
+		 *
+		 * @thread_safe
+		 */
+		u32 capture_stack_trace(void **frames, u32 max_frames, u32 skip = 0);
+
+		/**
+		 * Look up the name of the function an address belongs to, for example a return address from `capture_stack_trace`.
+		 *
+		 * @param void *address: The address to look up.
+		 * @param char *buffer: The buffer to write the null terminated name to.
+		 * @param size_t size: The size of the buffer.
+		 *
+		 * @return bool: Whether a symbol was found. If not, the buffer will contain the address or module and offset instead.
+		 *
+		 * @thread_safe
+		 */
+		bool get_symbol_name(void *address, char *buffer, size_t size);
+
 		enum struct DisplayMode : u8
 		{
 			WINDOWED            = 0x0,
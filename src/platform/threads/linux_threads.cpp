@@ -1,4 +1,8 @@
 #include "linux_threads.h"
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <limits.h>
 
 namespace Vultr
 {
@@ -6,5 +10,11 @@ namespace Vultr
 	{
 		void join_thread(Thread *thread) { pthread_join(thread->pthread, nullptr); }
 		void detach_thread(Thread *thread) { pthread_detach(thread->pthread); }
+
+		static_assert(sizeof(atomic_u32) == sizeof(u32), "Futexes need the atomic to be a plain 32 bit value!");
+
+		void wait_on_address(atomic_u32 *address, u32 expected) { syscall(SYS_futex, reinterpret_cast<u32 *>(address), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0); }
+
+		void wake_on_address(atomic_u32 *address, bool all) { syscall(SYS_futex, reinterpret_cast<u32 *>(address), FUTEX_WAKE_PRIVATE, all ? INT_MAX : 1, nullptr, nullptr, 0); }
 	} // namespace Platform
 } // namespace Vultr
@@ -0,0 +1,25 @@
+#include <types/types.h>
+#include "../platform.h"
+#include <windows.h>
+
+#pragma comment(lib, "Synchronization.lib")
+
+namespace Vultr
+{
+	namespace Platform
+	{
+		void wait_on_address(atomic_u32 *address, u32 expected) { WaitOnAddress(address, &expected, sizeof(u32), INFINITE); }
+
+		void wake_on_address(atomic_u32 *address, bool all)
+		{
+			if (all)
+			{
+				WakeByAddressAll(address);
+			}
+			else
+			{
+				WakeByAddressSingle(address);
+			}
+		}
+	} // namespace Platform
+} // namespace Vultr
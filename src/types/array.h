@@ -1,6 +1,193 @@
 #pragma once
+#include "types.h"
+#include <core/memory/allocator_policy.h>
+#include <type_traits>
+#include <utility>
 
-namespace Vultr
+namespace vtl
 {
+	/**
+	 * Resizable array which keeps its first `N` elements inside the array itself, and only allocates once it grows past them.
+	 * Meant for the many small lists in the engine, like the attachments of a framebuffer, which then never touch an allocator at all.
+	 *
+	 * Memory past the inline elements comes from an allocator policy, see allocator_policy.h. The array grows by doubling its capacity.
+	 * Since elements can live inside the array, pointers to them are invalidated when it grows, and the array itself can't be copied or moved.
+	 */
+	template <typename T, u32 N, typename Policy = Vultr::DynamicAllocatorPolicy>
+	struct SmallArray
+	{
+		static_assert(N > 0, "Small arrays need at least 1 inline element, use DynamicArray otherwise!");
 
-}
+		SmallArray(Policy policy) : policy(policy) {}
+
+		SmallArray &operator=(const SmallArray &other) = delete;
+		SmallArray(const SmallArray &other)            = delete;
+
+		~SmallArray()
+		{
+			clear();
+			if (_heap != nullptr)
+			{
+				policy.free(_heap);
+			}
+		}
+
+		/**
+		 * Construct a new element at the end of the array.
+		 *
+		 * @param Args... args: The arguments to construct the element with.
+		 *
+		 * @return T *: The new element.
+		 *
+		 * @error This will crash the program if the array had to grow and failed to allocate.
+		 */
+		template <typename... Args>
+		T *emplace_back(Args &&...args)
+		{
+			T *element = nullptr;
+			if (len == _capacity)
+			{
+				// The arguments could refer to an element of this array, so they have to be used up before growing moves it.
+				T value(std::forward<Args>(args)...);
+				grow(_capacity * 2);
+				element = new (&data()[len]) T(std::move(value));
+			}
+			else
+			{
+				element = new (&data()[len]) T(std::forward<Args>(args)...);
+			}
+			len++;
+			return element;
+		}
+
+		T *push_back(const T &element) { return emplace_back(element); }
+
+		/**
+		 * Insert an element at an index, shifting every element at and after it one to the right.
+		 *
+		 * @error This will crash the program if the array had to grow and failed to allocate.
+		 */
+		T *insert(u32 index, T element)
+		{
+			ASSERT(index <= len, "Index out of bounds!");
+			if (index == len)
+				return emplace_back(std::move(element));
+
+			emplace_back(std::move(data()[len - 1]));
+
+			T *array = data();
+			for (u32 i = len - 2; i > index; i--)
+			{
+				array[i] = std::move(array[i - 1]);
+			}
+			array[index] = std::move(element);
+			return &array[index];
+		}
+
+		/**
+		 * Remove the element at an index, shifting every element after it one to the left.
+		 */
+		void remove(u32 index)
+		{
+			ASSERT(index < len, "Index out of bounds!");
+			T *array = data();
+			for (u32 i = index + 1; i < len; i++)
+			{
+				array[i - 1] = std::move(array[i]);
+			}
+			remove_last();
+		}
+
+		void remove_last()
+		{
+			ASSERT(len > 0, "Array is empty!");
+			len--;
+			data()[len].~T();
+		}
+
+		/**
+		 * Destroy every element. Memory that was allocated is kept.
+		 */
+		void clear()
+		{
+			T *array = data();
+			for (u32 i = 0; i < len; i++)
+			{
+				array[i].~T();
+			}
+			len = 0;
+		}
+
+		/**
+		 * Make room for at least `count` elements.
+		 *
+		 * @error This will crash the program if it failed to allocate.
+		 */
+		void reserve(u32 count)
+		{
+			if (count > _capacity)
+			{
+				grow(count);
+			}
+		}
+
+		bool empty() const { return len == 0; }
+
+		// Whether the elements are still stored inside the array.
+		bool is_inline() const { return _heap == nullptr; }
+
+		u32 capacity() const { return _capacity; }
+
+		T *data() const { return _heap != nullptr ? _heap : reinterpret_cast<T *>(const_cast<byte *>(_inline)); }
+
+		T &operator[](u32 index) const
+		{
+			ASSERT(index < len, "Index out of bounds!");
+			return data()[index];
+		}
+
+		T *begin() const { return data(); }
+
+		T *end() const { return data() + len; }
+
+		u32 len = 0;
+
+		// Where the memory of the array comes from once it grows past its inline elements
+		Policy policy;
+
+	  private:
+		void grow(u32 capacity)
+		{
+			T *array = data();
+			T *heap  = nullptr;
+
+			// Elements already on the heap that can be copied byte for byte are left for the allocator to move.
+			if (_heap != nullptr && std::is_trivially_copyable_v<T>)
+			{
+				heap = static_cast<T *>(policy.realloc(_heap, _capacity * sizeof(T), capacity * sizeof(T)));
+				PRODUCTION_ASSERT(heap != nullptr, "Failed to reallocate memory!");
+			}
+			else
+			{
+				heap = static_cast<T *>(policy.alloc(capacity * sizeof(T)));
+				PRODUCTION_ASSERT(heap != nullptr, "Failed to allocate memory!");
+				for (u32 i = 0; i < len; i++)
+				{
+					new (&heap[i]) T(std::move(array[i]));
+					array[i].~T();
+				}
+				if (_heap != nullptr)
+				{
+					policy.free(_heap);
+				}
+			}
+
+			_heap     = heap;
+			_capacity = capacity;
+		}
+
+		T *_heap      = nullptr;
+		u32 _capacity = N;
+		alignas(T) byte _inline[N * sizeof(T)];
+	};
+} // namespace vtl
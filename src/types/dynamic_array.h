@@ -2,76 +2,136 @@
 #pragma once
 #include <assert.h>
 #include <memory>
+#include <string.h>
+#include <type_traits>
+#include <utility>
 #include "types.h"
-#include <core/memory/vultr_memory.h>
+#include <core/memory/allocator_policy.h>
 
 namespace vtl
 {
+	/**
+	 * Whether moving a `T` to a new address and forgetting the old one is the same as copying its bytes, which lets containers shift and grow it with `memmove` and `realloc`.
+	 * This holds for every trivially copyable type, and can be specialized for other types that don't point into themselves.
+	 */
+	template <typename T>
+	struct is_trivially_relocatable : std::is_trivially_copyable<T>
+	{
+	};
+
+	template <typename T>
+	inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
 	/**
 	 * Resizable array.
+	 *
+	 * Memory comes from an allocator policy, see allocator_policy.h. The default goes through the generic allocation functions and takes any `Allocator *`,
+	 * a concrete policy such as `Vultr::PoolPolicy` takes that allocator type and calls it directly.
+	 *
+	 * The array grows by `growth_numerator / growth_denominator` of its capacity, and shrinks once less than `decay_percent_threshold` percent of it is used.
+	 * Shrinking leaves enough room that the array is then halfway between the threshold and full, so pushing and removing around a boundary never reallocates back and forth.
+	 * Elements that are trivially relocatable are shifted and grown with `memmove` and `realloc`, everything else is moved one element at a time.
 	 */
-	template <typename T, size_t reserved = 10, u32 growth_numerator = 3, u32 growth_denominator = 2, u32 decay_percent_threshold = 30>
-	struct DynamicArray : Vultr::MemoryStruct
+	template <typename T, size_t reserved = 10, u32 growth_numerator = 3, u32 growth_denominator = 2, u32 decay_percent_threshold = 30, typename Policy = Vultr::DynamicAllocatorPolicy>
+	struct DynamicArray
 	{
+		static_assert(growth_numerator > growth_denominator, "Dynamic arrays must grow when they are full!");
+		static_assert(decay_percent_threshold < 100, "Dynamic arrays can't shrink while they are full!");
+
 		// Initialize an empty DynamicArray
 		// Reserved specifies a _size of the DynamicArray that will be reserved initially
 		// which will be empty
-		DynamicArray(Vultr::Allocator *a) : Vultr::MemoryStruct(a)
+		DynamicArray(Policy policy) : policy(policy)
 		{
 			_size = reserved;
 			len   = 0;
 			if (reserved > 0)
 			{
-				_array = alloc(_size);
+				_array = alloc_array(_size);
 			}
 		}
 
-		DynamicArray(Vultr::Allocator *a, T *array, size_t count) : Vultr::MemoryStruct(a)
+		DynamicArray(Policy policy, const T *array, size_t count) : policy(policy)
 		{
 			assert(count != 0 && "Count must be greater than 0!");
 			assert(array != nullptr && "Array must not be null!");
 
-			len   = count;
-			_size = len * growth_factor;
-			if (_size < reserved)
-			{
-				_size = reserved;
-			}
-
-			_array = alloc(_size);
-
-			for (int i = 0; i < count; i++)
-			{
-				_array[i] = array[i];
-			}
+			_size = MAX(static_cast<size_t>(count * growth_factor), reserved);
+			_array = alloc_array(_size);
+			push_back_n(array, count);
 		}
 
 		// Delete copy methods because we don't want this to be done on accident, we want it to be very very explicit since we are essentially duplicating a buffer
-		DynamicArray<T> &operator=(const DynamicArray<T> &other) = delete;
-		DynamicArray(const DynamicArray<T> &other)               = delete;
+		DynamicArray &operator=(const DynamicArray &other) = delete;
+		DynamicArray(const DynamicArray &other)            = delete;
 
 		// Destructor for dynamic array
 		~DynamicArray()
 		{
+			destroy(0, len);
 			if (_array != nullptr)
-				free(_array);
+				policy.free(_array);
 		}
 
-		// Push element to back of dynamic_array
+		// Construct an element at the back of the dynamic_array
 		// If the dynamic_array does not have enough space, then a reallocation will
 		// occur
 		//
 		// Returns the element just inserted
-		T *push_back(const T &element)
+		template <typename... Args>
+		T *emplace_back(Args &&...args)
 		{
+			T *element = nullptr;
+			if (len == _size)
+			{
+				// The arguments could refer to an element of this array, so they have to be used up before growing moves it.
+				T value(std::forward<Args>(args)...);
+				grow(len + 1);
+				element = new (&_array[len]) T(std::move(value));
+			}
+			else
+			{
+				element = new (&_array[len]) T(std::forward<Args>(args)...);
+			}
 			len++;
-			reallocate();
+			return element;
+		}
+
+		// Push element to back of dynamic_array
+		//
+		// Returns the element just inserted
+		T *push_back(const T &element) { return emplace_back(element); }
 
-			// Increase the len amount and assign the last element of array to the new
-			// element
-			_array[len - 1] = element;
+		T *push_back(T &&element) { return emplace_back(std::move(element)); }
 
-			return &_array[len - 1];
+		// Push count elements to the back of the dynamic_array, reallocating at most once
+		//
+		// Returns the first element just inserted
+		T *push_back_n(const T *elements, size_t count)
+		{
+			assert((elements < _array || elements >= _array + _size) && "Elements must not come from this array!");
+			if (len + count > _size)
+			{
+				grow(len + count);
+			}
+
+			T *first = _array + len;
+			if constexpr (std::is_trivially_copyable_v<T>)
+			{
+				if (count > 0)
+				{
+					memcpy(first, elements, count * sizeof(T));
+				}
+			}
+			else
+			{
+				for (size_t i = 0; i < count; i++)
+				{
+					new (&first[i]) T(elements[i]);
+				}
+			}
+			len += count;
+			return first;
 		}
 
 		// Inserts element at specific index in dynamic_array
@@ -80,54 +140,68 @@ namespace vtl
 		// occur
 		//
 		// Throws index out of bounds error if index is greater than the
-		// dynamic_array._size or if index is negative
+		// dynamic_array.len
 		//
 		// Returns the element just inserted
-		T *insert(s32 index, T element)
+		T *insert(size_t index, T element)
 		{
-			// Fail if the index is greater than the dynamic_array._size or negative
-			assert(index <= _size && index >= 0 && "Index out of bounds!");
+			// Fail if the index is past the end of the dynamic_array
+			assert(index <= len && "Index out of bounds!");
 
-			// Increase the len amount
-			len++;
-
-			reallocate();
+			if (len == _size)
+			{
+				grow(len + 1);
+			}
 
-			if (len > 1)
+			if constexpr (is_trivially_relocatable_v<T>)
 			{
-				// Shift all elements right
-				for (s32 i = len - 2; i >= index; i--)
+				memmove(&_array[index + 1], &_array[index], (len - index) * sizeof(T));
+				new (&_array[index]) T(std::move(element));
+			}
+			else if (index == len)
+			{
+				new (&_array[index]) T(std::move(element));
+			}
+			else
+			{
+				// Shift all elements right, the last one into memory that isn't constructed yet
+				new (&_array[len]) T(std::move(_array[len - 1]));
+				for (size_t i = len - 1; i > index; i--)
 				{
-					_array[i + 1] = _array[i];
+					_array[i] = std::move(_array[i - 1]);
 				}
+				_array[index] = std::move(element);
 			}
-
-			// Assign last element of array to new element
-			_array[index] = element;
+			len++;
 
 			return &_array[index];
 		}
 
 		// Delete element at index in dynamic_array
 		// Shifts all elements to the right of that index 1 to the left
-		// If the dynamic_array len equals dynamic_array _size, then it will assume
-		// nothing is reserved and a reallocation will occur unless reallocate is
-		// explicitly false
+		// If less than decay_percent_threshold of the dynamic_array is used afterwards, then it will shrink
 		void remove(size_t index)
 		{
-			// Fail if the index is greater than the dynamic_array._size or negative
-			assert(index <= len && index >= 0 && "Index out of bounds!");
+			// Fail if the index is out of bounds
+			assert(index < len && "Index out of bounds!");
 
-			// Shift elements to the left
-			for (uint i = index + 1; i < _size; i++)
+			if constexpr (is_trivially_relocatable_v<T>)
 			{
-				_array[i - 1] = _array[i];
+				_array[index].~T();
+				memmove(&_array[index], &_array[index + 1], (len - index - 1) * sizeof(T));
+			}
+			else
+			{
+				// Shift elements to the left
+				for (size_t i = index + 1; i < len; i++)
+				{
+					_array[i - 1] = std::move(_array[i]);
+				}
+				_array[len - 1].~T();
 			}
 
-			// Decrease len even if no reallocation
 			len--;
-
-			reallocate();
+			shrink();
 		}
 
 		// Shorthand of removing last element of the array
@@ -137,23 +211,63 @@ namespace vtl
 			remove(len - 1);
 		}
 
+		// Make sure there is space for at least count elements, the array won't shrink below this until it is cleared
+		void reserve(size_t count)
+		{
+			_min_size = MAX(_min_size, count);
+			if (count > _size)
+			{
+				grow(count);
+			}
+		}
+
+		// Change the number of elements, default constructing new elements or destroying the ones past count
+		void resize(size_t count)
+		{
+			if (count > len)
+			{
+				if (count > _size)
+				{
+					grow(count);
+				}
+				for (size_t i = len; i < count; i++)
+				{
+					new (&_array[i]) T();
+				}
+				len = count;
+			}
+			else
+			{
+				destroy(count, len);
+				len = count;
+				shrink();
+			}
+		}
+
 		bool empty() const { return len == 0; }
 
 		void clear()
 		{
-			len   = 0;
-			_size = reserved;
+			destroy(0, len);
+			len       = 0;
+			_min_size = reserved;
+			_size     = reserved;
 			if (reserved > 0)
 			{
 				if (_array == nullptr)
 				{
-					_array = alloc(_size);
+					_array = alloc_array(_size);
 				}
 				else
 				{
-					_array = realloc(_array, _size);
+					_array = realloc_array(_array, 0, _size);
 				}
 			}
+			else if (_array != nullptr)
+			{
+				policy.free(_array);
+				_array = nullptr;
+			}
 		}
 
 		// Ability to index into the array and assign and retreive elements by
@@ -173,51 +287,86 @@ namespace vtl
 		// To make sure that the buffer expansion is geometric
 		f64 growth_factor = (f64)growth_numerator / (f64)growth_denominator;
 
+		// Where the memory of the array comes from
+		Policy policy;
+
 	  private:
-		void reallocate()
+		T *alloc_array(size_t count)
 		{
-			// Only reallocate and expand the array if we need to
-			if (len > _size)
-			{
-				_size = len * growth_factor;
-			}
-			else if ((f64)len / (f64)_size < (f64)decay_percent_threshold / 100.0)
-			{
-				_size = len * growth_factor;
-			}
-			else
-			{
-				return;
-			}
+			auto *array = static_cast<T *>(policy.alloc(count * sizeof(T)));
+			PRODUCTION_ASSERT(array != nullptr, "Failed to allocate memory!");
+			return array;
+		}
+
+		T *realloc_array(T *array, size_t old_count, size_t count)
+		{
+			auto *new_array = static_cast<T *>(policy.realloc(array, old_count * sizeof(T), count * sizeof(T)));
+			PRODUCTION_ASSERT(new_array != nullptr, "Failed to reallocate memory!");
+			return new_array;
+		}
 
-			if (_size < reserved)
+		void destroy(size_t from, size_t to)
+		{
+			if constexpr (!std::is_trivially_destructible_v<T>)
 			{
-				_size = reserved;
+				for (size_t i = from; i < to; i++)
+				{
+					_array[i].~T();
+				}
 			}
+		}
 
-			if (_size == 0)
+		// Move the elements into an array of a new size, which must fit all of them
+		void set_size(size_t size)
+		{
+			if (size == 0)
 			{
 				if (_array != nullptr)
 				{
-					free(_array);
+					policy.free(_array);
 					_array = nullptr;
 				}
 			}
+			else if (_array == nullptr)
+			{
+				_array = alloc_array(size);
+			}
+			else if constexpr (is_trivially_relocatable_v<T>)
+			{
+				_array = realloc_array(_array, len, size);
+			}
 			else
 			{
-				if (_array == nullptr)
+				T *array = alloc_array(size);
+				for (size_t i = 0; i < len; i++)
 				{
-					_array = malloc(_size * sizeof(T));
-				}
-				else
-				{
-					_array = realloc(_array, _size * sizeof(T));
+					new (&array[i]) T(std::move(_array[i]));
+					_array[i].~T();
 				}
+				policy.free(_array);
+				_array = array;
 			}
+			_size = size;
+		}
+
+		// Grow geometrically so that pushing one element at a time is amortized O(1), but at least to count elements
+		void grow(size_t count) { set_size(MAX(MAX(count, _size * growth_numerator / growth_denominator), reserved)); }
+
+		void shrink()
+		{
+			if (len * 100 >= _size * decay_percent_threshold || _size <= _min_size)
+				return;
+
+			// Leave the array halfway between the threshold and full, so it has to lose or gain a lot of elements before it reallocates again
+			size_t size = len * 200 / (100 + decay_percent_threshold) + 1;
+			set_size(MAX(size, _min_size));
 		}
 
 		// The internal array
-		T *_array;
+		T *_array = nullptr;
+
+		// The array never shrinks below this, which is raised by reserve
+		size_t _min_size = reserved;
 
 		// Dumbass C++ shit
 	  public:
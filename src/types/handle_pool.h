@@ -0,0 +1,291 @@
+#pragma once
+#include "types.h"
+#include <core/memory/allocator_policy.h>
+#include <bit>
+#include <type_traits>
+#include <utility>
+
+namespace vtl
+{
+	/**
+	 * Reference to an object in a `HandlePool`. A handle keeps pointing at the same object while the pool moves it around,
+	 * and stops resolving once the object is removed even if its slot is reused, because every removal bumps the generation of the slot.
+	 */
+	template <typename T>
+	struct Handle
+	{
+		u32 index = 0;
+
+		// Generations start at 1, so a default constructed handle never resolves.
+		u32 generation = 0;
+
+		bool operator==(const Handle &other) const { return index == other.index && generation == other.generation; }
+		bool operator!=(const Handle &other) const { return !(*this == other); }
+	};
+
+	/**
+	 * Storage for objects that are referred to by handles instead of pointers, for things like meshes, textures and entities.
+	 * Live objects are packed densely at the start of one array, removing an object moves the last one into its place, so iterating over them never skips anything.
+	 * Handles are resolved through a table of slots in O(1), and an occupancy bitmap of the slots allows walking the live handles 64 at a time.
+	 *
+	 * Memory comes from an allocator policy, see allocator_policy.h, which is a pool allocator by default. The pool grows by doubling its capacity.
+	 */
+	template <typename T, typename Policy = Vultr::PoolPolicy>
+	struct HandlePool
+	{
+		HandlePool(Policy policy, u32 capacity = 64) : policy(policy)
+		{
+			ASSERT(capacity > 0, "Handle pool capacity must be greater than 0!");
+			grow(capacity);
+		}
+
+		// Delete copy methods because copying would hand out a second set of objects for the same handles.
+		HandlePool &operator=(const HandlePool &other) = delete;
+		HandlePool(const HandlePool &other)            = delete;
+
+		~HandlePool()
+		{
+			clear();
+			policy.free(_data);
+			policy.free(_dense_to_slot);
+			policy.free(_slots);
+			policy.free(_occupancy);
+		}
+
+		/**
+		 * Construct a new object in the pool.
+		 *
+		 * @param Args... args: The arguments to construct the object with.
+		 *
+		 * @return Handle<T>: The handle of the new object.
+		 *
+		 * @error This will crash the program if the pool had to grow and failed to allocate.
+		 */
+		template <typename... Args>
+		Handle<T> insert(Args &&...args)
+		{
+			if (len == _capacity)
+			{
+				grow(_capacity * 2);
+			}
+
+			u32 index;
+			if (_free_slot != INVALID_INDEX)
+			{
+				index      = _free_slot;
+				_free_slot = _slots[index].dense;
+			}
+			else
+			{
+				index                    = _slot_count;
+				_slots[index].generation = 1;
+				_slot_count++;
+			}
+
+			auto *slot  = &_slots[index];
+			slot->dense = len;
+			new (&_data[len]) T(std::forward<Args>(args)...);
+			_dense_to_slot[len] = index;
+			_occupancy[index / 64] |= 1ull << (index % 64);
+			len++;
+
+			return {.index = index, .generation = slot->generation};
+		}
+
+		/**
+		 * Destroy the object a handle refers to. The last object in the pool is moved into its place.
+		 *
+		 * @param Handle<T> handle: The handle of the object.
+		 *
+		 * @return bool: Whether there was an object to remove, false if the handle was stale.
+		 */
+		bool remove(Handle<T> handle)
+		{
+			if (!contains(handle))
+				return false;
+
+			auto *slot = &_slots[handle.index];
+			u32 dense  = slot->dense;
+			u32 last   = len - 1;
+			if (dense != last)
+			{
+				_data[dense]                        = std::move(_data[last]);
+				_dense_to_slot[dense]               = _dense_to_slot[last];
+				_slots[_dense_to_slot[dense]].dense = dense;
+			}
+			_data[last].~T();
+			len--;
+
+			release_slot(handle.index);
+			return true;
+		}
+
+		/**
+		 * Resolve a handle.
+		 *
+		 * @param Handle<T> handle: The handle of the object.
+		 *
+		 * @return T *: The object, which moves if other objects are removed.
+		 *
+		 * @error Returns nullptr if the object was removed.
+		 */
+		T *get(Handle<T> handle) const
+		{
+			if (!contains(handle))
+				return nullptr;
+
+			return &_data[_slots[handle.index].dense];
+		}
+
+		bool contains(Handle<T> handle) const
+		{
+			return handle.index < _slot_count && _slots[handle.index].generation == handle.generation && (_occupancy[handle.index / 64] & (1ull << (handle.index % 64)));
+		}
+
+		T &operator[](Handle<T> handle) const
+		{
+			ASSERT(contains(handle), "Stale handle!");
+			return _data[_slots[handle.index].dense];
+		}
+
+		/**
+		 * Get the handle of the object at a position in the dense array, for example while iterating with `begin` and `end`.
+		 */
+		Handle<T> handle_at(u32 dense_index) const
+		{
+			ASSERT(dense_index < len, "Index out of bounds!");
+			u32 index = _dense_to_slot[dense_index];
+			return {.index = index, .generation = _slots[index].generation};
+		}
+
+		/**
+		 * Call `callback(Handle<T>, T &)` for every live object, in the order of their slots rather than their position in the dense array.
+		 * The occupancy bitmap is walked 64 slots at a time, so empty stretches of slots are skipped over quickly.
+		 * Objects must not be inserted or removed from within the callback.
+		 */
+		template <typename Callback>
+		void for_each(Callback callback) const
+		{
+			u32 words = (_slot_count + 63) / 64;
+			for (u32 word = 0; word < words; word++)
+			{
+				u64 bits = _occupancy[word];
+				while (bits != 0)
+				{
+					u32 index = word * 64 + std::countr_zero(bits);
+					bits &= bits - 1;
+
+					auto *slot = &_slots[index];
+					callback(Handle<T>{.index = index, .generation = slot->generation}, _data[slot->dense]);
+				}
+			}
+		}
+
+		/**
+		 * Destroy every object in the pool. Every handle that was handed out stops resolving.
+		 */
+		void clear()
+		{
+			for (u32 i = 0; i < len; i++)
+			{
+				_data[i].~T();
+				release_slot(_dense_to_slot[i]);
+			}
+			len = 0;
+		}
+
+		bool empty() const { return len == 0; }
+
+		T *begin() const { return _data; }
+
+		T *end() const { return _data + len; }
+
+		// The number of live objects.
+		u32 len = 0;
+
+		// Where the memory of the pool comes from
+		Policy policy;
+
+	  private:
+		static constexpr u32 INVALID_INDEX = UINT32_MAX;
+
+		struct Slot
+		{
+			// The position of the object in the dense array, or the next free slot if this slot is free.
+			u32 dense      = INVALID_INDEX;
+			u32 generation = 0;
+		};
+
+		void release_slot(u32 index)
+		{
+			auto *slot = &_slots[index];
+
+			// Skip 0 on overflow so that default constructed handles stay invalid.
+			slot->generation = slot->generation == UINT32_MAX ? 1 : slot->generation + 1;
+			slot->dense      = _free_slot;
+			_free_slot       = index;
+			_occupancy[index / 64] &= ~(1ull << (index % 64));
+		}
+
+		template <typename U>
+		U *realloc_array(U *array, size_t old_count, size_t count)
+		{
+			U *new_array = nullptr;
+			if (array == nullptr)
+			{
+				new_array = static_cast<U *>(policy.alloc(count * sizeof(U)));
+			}
+			else
+			{
+				new_array = static_cast<U *>(policy.realloc(array, old_count * sizeof(U), count * sizeof(U)));
+			}
+			PRODUCTION_ASSERT(new_array != nullptr, "Failed to allocate memory!");
+			return new_array;
+		}
+
+		void grow(u32 capacity)
+		{
+			// Objects that can't be copied byte for byte have to be moved into the new array one at a time.
+			if constexpr (std::is_trivially_copyable_v<T>)
+			{
+				_data = realloc_array(_data, _capacity, capacity);
+			}
+			else
+			{
+				auto *data = static_cast<T *>(policy.alloc(capacity * sizeof(T)));
+				PRODUCTION_ASSERT(data != nullptr, "Failed to allocate memory!");
+				for (u32 i = 0; i < len; i++)
+				{
+					new (&data[i]) T(std::move(_data[i]));
+					_data[i].~T();
+				}
+				if (_data != nullptr)
+				{
+					policy.free(_data);
+				}
+				_data = data;
+			}
+
+			u32 old_words  = (_capacity + 63) / 64;
+			u32 words      = (capacity + 63) / 64;
+			_dense_to_slot = realloc_array(_dense_to_slot, _capacity, capacity);
+			_slots         = realloc_array(_slots, _capacity, capacity);
+			_occupancy     = realloc_array(_occupancy, old_words, words);
+			for (u32 i = old_words; i < words; i++)
+			{
+				_occupancy[i] = 0;
+			}
+			_capacity = capacity;
+		}
+
+		T *_data            = nullptr;
+		u32 *_dense_to_slot = nullptr;
+		Slot *_slots        = nullptr;
+		u64 *_occupancy     = nullptr;
+		u32 _capacity       = 0;
+
+		// The number of slots that were ever used, every slot past this is untouched.
+		u32 _slot_count = 0;
+		u32 _free_slot  = INVALID_INDEX;
+	};
+} // namespace vtl
@@ -1,233 +1,490 @@
 #pragma once
+#include "types.h"
+#include <core/memory/allocator_policy.h>
+#include <bit>
+#include <string.h>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define VTL_HASHTABLE_SSE2
+#endif
 
 namespace vtl
 {
-}
-
-// #pragma once
-// #include <types/types.h>
-// #include <equals.h>
-// #include <stdio.h>
-// #include <string.h>
-// #include <assert.h>
-// #include <iterator>
-// #include <cstddef>
-
-// namespace vtl
-// {
-// #define TABLE_SIZE 10
-
-//     template <typename k, typename v>
-//     struct HashNode
-//     {
-//         k key;
-//         v value;
-//     };
-
-//     namespace internal
-//     {
-
-//         template <typename k, typename v>
-//         HashNode<k, v> *init_node(const HashNode<k, v> &other)
-//         {
-//             auto *n = (HashNode<k, v> *)malloc(sizeof(HashNode<k, v>));
-//             n->key = other.key;
-//             n->value = other.value;
-//             return n;
-//         }
-//     } // namespace internal
-
-//     // For providing custom hash functions
-//     typedef uint (*hash_function)(void *);
-
-//     // Default hash functions with explicit instantiation
-//     template <typename k>
-//     uint hash(k key);
-
-//     template <typename k, typename v>
-//     struct HashTable
-//     {
-//         HashTable()
-//         {
-//             for (int i = 0; i < TABLE_SIZE; i++)
-//             {
-//                 internal_array[i] = nullptr;
-//             }
-//         }
-//         ~HashTable()
-//         {
-//             assert(hashtable_exists(t, key) && "Cannot delete nonexistent key-value pair inhashtable!");
-//             int index = hash(key);
-//             auto *node = t.internal_array[index];
-//             free(node);
-//             t.internal_array[index] = nullptr;
-//         }
-
-//         v &operator[](k key)
-//         {
-//             int index = hash(key);
-//             auto *node = internal_array[index];
-//             if (node != nullptr)
-//             {
-//                 if (!generic_equals(node->key, key))
-//                 {
-//                     assert(true && "Collision!");
-//                 }
-//             }
-//             else
-//             {
-//                 internal_array[index] = (HashNode<k, v> *)malloc(sizeof(HashNode<k, v>));
-//                 internal_array[index]->key = key;
-//             }
-//             return internal_array[index]->value;
-//         }
-
-//         struct Iterator
-//         {
-//             typedef std::random_access_iterator_tag IteratorCategory;
-//             typedef HashNode<k, v> ValueType;
-//             typedef ValueType **Pointer;
-//             typedef ValueType &Reference;
-//             Iterator(Pointer p_ptr) : ptr(p_ptr)
-//             {
-//             }
-
-//             Iterator &operator++()
-//             {
-//                 // OMG THE FIRST TIME I'VE LITERALLY EVER USED DO WHILE
-//                 do
-//                 {
-//                     ptr++;
-//                 } while (*ptr == nullptr);
-//                 return *this;
-//             }
-
-//             Iterator operator++(int)
-//             {
-//                 Iterator iterator = *this;
-//                 ++(*this);
-//                 return iterator;
-//             }
-
-//             Iterator &operator--()
-//             {
-//                 do
-//                 {
-//                     ptr--;
-//                 } while (*ptr == nullptr);
-//                 return *this;
-//             }
-
-//             Iterator operator--(int)
-//             {
-//                 Iterator iterator = *this;
-//                 --(*this);
-//                 return iterator;
-//             }
-
-//             Pointer *operator->()
-//             {
-//                 while (*ptr == nullptr)
-//                 {
-//                     (*this)++;
-//                 }
-//                 return *ptr;
-//             }
-
-//             Reference operator*()
-//             {
-//                 while (*ptr == nullptr)
-//                 {
-//                     (*this)++;
-//                 }
-//                 return **ptr;
-//             }
-
-//             bool operator==(const Iterator &other) const
-//             {
-//                 return ptr == other.ptr;
-//             }
-
-//             bool operator!=(const Iterator &other) const
-//             {
-//                 return !(*this == other);
-//             }
-
-//           private:
-//             Pointer ptr;
-//         };
-
-//         Iterator begin()
-//         {
-//             HashNode<k, v> **ptr = internal_array;
-//             while (ptr < internal_array + TABLE_SIZE && *ptr == nullptr)
-//             {
-//                 ptr++;
-//             }
-//             return Iterator(ptr);
-//         }
-//         Iterator end()
-//         {
-//             return Iterator(internal_array + TABLE_SIZE);
-//         }
-
-//       private:
-//         HashNode<k, v> *internal_array[TABLE_SIZE];
-//     };
-
-//     template <typename k, typename v>
-//     HashTable<k, v> new_hashtable()
-//     {
-//         HashTable<k, v> t = {};
-//         return t;
-//     }
-
-//     template <typename k, typename v>
-//     bool hashtable_insert(HashTable<k, v> &t, HashNode<k, v> node)
-//     {
-//         int index = hash(node.key);
-//         if (t.internal_array[index] != nullptr)
-//         {
-//             return false;
-//         }
-//         auto *new_node = internal::init_node(node);
-
-//         t.internal_array[index] = new_node;
-//         return true;
-//     }
-
-//     template <typename k, typename v>
-//     bool hashtable_exists(const HashTable<k, v> &t, k key)
-//     {
-//         int index = hash(key);
-//         if (t.internal_array[index] != nullptr)
-//         {
-//             return generic_equals(t.internal_array[index], key);
-//         }
-//         else
-//         {
-//             return false;
-//         }
-//     }
-
-//     //
-//     //
-//     //
-//     // Default hash functions
-//     //
-//     //
-//     //
-//     template <>
-//     inline u32 hash<const char *>(const char *key)
-//     {
-//         int length = strlen(key);
-//         u32 hash_value = 0;
-//         for (int i = 0; i < length; i++)
-//         {
-//             hash_value += key[i];
-//             hash_value = (key[i] * hash_value) % TABLE_SIZE;
-//         }
-//         return hash_value;
-//     }
-
-// } // namespace vtl
+	/**
+	 * Default hash function of `HashTable`, which works for integers, enums, pointers and C strings.
+	 * Other key types need a specialization or a hash function of their own.
+	 */
+	template <typename K>
+	struct Hash
+	{
+		u64 operator()(const K &key) const
+		{
+			static_assert(std::is_integral_v<K> || std::is_enum_v<K> || std::is_pointer_v<K>, "Key type needs a vtl::Hash specialization!");
+
+			// The finalizer of MurmurHash3, so that keys which only differ in a few bits still end up far apart.
+			u64 hash;
+			if constexpr (std::is_pointer_v<K>)
+			{
+				hash = reinterpret_cast<uintptr_t>(key);
+			}
+			else
+			{
+				hash = static_cast<u64>(key);
+			}
+			hash ^= hash >> 33;
+			hash *= 0xFF51AFD7ED558CCDull;
+			hash ^= hash >> 33;
+			hash *= 0xC4CEB9FE1A85EC53ull;
+			hash ^= hash >> 33;
+			return hash;
+		}
+	};
+
+	template <>
+	struct Hash<const char *>
+	{
+		// 64 bit FNV-1a.
+		u64 operator()(const char *key) const
+		{
+			u64 hash = 0xCBF29CE484222325ull;
+			for (; *key != '\0'; key++)
+			{
+				hash ^= static_cast<u8>(*key);
+				hash *= 0x100000001B3ull;
+			}
+			return hash;
+		}
+	};
+
+	/**
+	 * Hash function for keys that already are a CRC32 hash, such as `VFileHandle`. The key is used as the hash as is, so lookups don't hash anything.
+	 * Combined with `HashTable::find_hashed` this also lets a path be hashed once with `crcdetail::compute` or `CRC32_STR` and used both as the key and its hash.
+	 */
+	struct CRC32Hash
+	{
+		u64 operator()(u32 crc) const { return crc; }
+	};
+
+	template <typename K>
+	struct Equal
+	{
+		bool operator()(const K &a, const K &b) const { return a == b; }
+	};
+
+	template <>
+	struct Equal<const char *>
+	{
+		bool operator()(const char *a, const char *b) const { return strcmp(a, b) == 0; }
+	};
+
+	template <typename K, typename V>
+	struct HashTableEntry
+	{
+		K key;
+		V value;
+	};
+
+	namespace internal
+	{
+		// Control byte of a slot without an entry. Full slots store the low 7 bits of the hash of their key, so only empty slots have the high bit set.
+		static constexpr u8 HASHTABLE_EMPTY      = 0x80;
+		static constexpr u32 HASHTABLE_GROUP_SIZE = 16;
+
+		/**
+		 * The control bytes of 16 slots, which are compared against a hash all at once.
+		 */
+		struct HashTableGroup
+		{
+#ifdef VTL_HASHTABLE_SSE2
+			explicit HashTableGroup(const u8 *ctrl) : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl))) {}
+
+			// Bit i is set if slot i might hold a key with this hash.
+			u32 match(u8 h2) const { return static_cast<u32>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(static_cast<char>(h2))))); }
+
+			// Bit i is set if slot i is empty.
+			u32 match_empty() const { return static_cast<u32>(_mm_movemask_epi8(ctrl)); }
+
+			__m128i ctrl;
+#else
+			explicit HashTableGroup(const u8 *ctrl) : ctrl(ctrl) {}
+
+			u32 match(u8 h2) const
+			{
+				u32 bits = 0;
+				for (u32 i = 0; i < HASHTABLE_GROUP_SIZE; i++)
+				{
+					bits |= static_cast<u32>(ctrl[i] == h2) << i;
+				}
+				return bits;
+			}
+
+			u32 match_empty() const { return match(HASHTABLE_EMPTY); }
+
+			const u8 *ctrl;
+#endif
+		};
+	} // namespace internal
+
+	/**
+	 * Open addressing hash table in the style of Swiss tables. Slots are split into groups of 16, and every slot has a control byte holding 7 bits of the hash of its key,
+	 * so a probe compares a whole group with a couple of SSE2 instructions and only compares the keys of the slots that matched.
+	 *
+	 * Instead of leaving tombstones behind, every group counts how many keys had to probe past it because it was full. A lookup stops at the first group no key
+	 * went past, and removing a key decrements the counts along its probe sequence, so a removed slot is simply empty again and lookups never slow down from churn.
+	 *
+	 * Memory comes from an allocator policy, see allocator_policy.h. The table grows by doubling when it is 7/8 full. Pointers to values are invalidated when it grows.
+	 */
+	template <typename K, typename V, typename HashFn = Hash<K>, typename EqualFn = Equal<K>, typename Policy = Vultr::DynamicAllocatorPolicy>
+	struct HashTable
+	{
+		typedef HashTableEntry<K, V> Entry;
+
+		HashTable(Policy policy, u32 capacity = 0) : policy(policy)
+		{
+			if (capacity > 0)
+			{
+				reserve(capacity);
+			}
+		}
+
+		// Delete copy methods because copying the table would mean rehashing every key, which should never happen by accident.
+		HashTable &operator=(const HashTable &other) = delete;
+		HashTable(const HashTable &other)            = delete;
+
+		~HashTable()
+		{
+			destroy_entries();
+			if (_entries != nullptr)
+			{
+				policy.free(_entries);
+			}
+		}
+
+		/**
+		 * Find the value of a key.
+		 *
+		 * @param const K &key: The key to look for.
+		 *
+		 * @return V *: The value, which is invalidated when the table grows.
+		 *
+		 * @error Returns nullptr if the key isn't in the table.
+		 */
+		V *find(const K &key) const { return find_hashed(key, HashFn{}(key)); }
+
+		/**
+		 * Same as `find` with a hash that was already computed, which must be the same as the hash function of the table returns for the key.
+		 */
+		V *find_hashed(const K &key, u64 hash) const
+		{
+			u64 slot = find_slot(key, hash);
+			if (slot == INVALID_SLOT)
+				return nullptr;
+
+			return &_entries[slot].value;
+		}
+
+		bool contains(const K &key) const { return find(key) != nullptr; }
+
+		/**
+		 * Insert a key, or overwrite its value if it is already in the table.
+		 *
+		 * @param const K &key: The key.
+		 * @param V value: The value to store.
+		 *
+		 * @return V *: The value in the table, which is invalidated when the table grows.
+		 *
+		 * @error This will crash the program if the table had to grow and failed to allocate.
+		 */
+		V *insert(const K &key, V value) { return insert_hashed(key, std::move(value), HashFn{}(key)); }
+
+		V *insert_hashed(const K &key, V value, u64 hash)
+		{
+			u64 slot = find_slot(key, hash);
+			if (slot != INVALID_SLOT)
+			{
+				_entries[slot].value = std::move(value);
+				return &_entries[slot].value;
+			}
+
+			slot = insert_new(key, hash);
+			new (&_entries[slot].value) V(std::move(value));
+			return &_entries[slot].value;
+		}
+
+		/**
+		 * Get the value of a key, inserting a default constructed value if it isn't in the table yet.
+		 */
+		V &operator[](const K &key)
+		{
+			u64 hash = HashFn{}(key);
+			u64 slot = find_slot(key, hash);
+			if (slot == INVALID_SLOT)
+			{
+				slot = insert_new(key, hash);
+				new (&_entries[slot].value) V();
+			}
+			return _entries[slot].value;
+		}
+
+		/**
+		 * Remove a key and its value.
+		 *
+		 * @param const K &key: The key to remove.
+		 *
+		 * @return bool: Whether the key was in the table.
+		 */
+		bool remove(const K &key) { return remove_hashed(key, HashFn{}(key)); }
+
+		bool remove_hashed(const K &key, u64 hash)
+		{
+			u64 slot = find_slot(key, hash);
+			if (slot == INVALID_SLOT)
+				return false;
+
+			// Every group before the one the key ended up in was only probed past because of this key.
+			u64 group = probe_start(hash);
+			for (u64 i = 1; group != slot / internal::HASHTABLE_GROUP_SIZE; i++)
+			{
+				if (_overflow[group] != UINT8_MAX)
+				{
+					_overflow[group]--;
+				}
+				group = (group + i) & group_mask();
+			}
+
+			_ctrl[slot] = internal::HASHTABLE_EMPTY;
+			_entries[slot].~Entry();
+			len--;
+			return true;
+		}
+
+		/**
+		 * Make room for at least `count` keys, so that inserting them doesn't have to grow the table.
+		 *
+		 * @error This will crash the program if it failed to allocate.
+		 */
+		void reserve(u32 count)
+		{
+			if (count > max_len())
+			{
+				rehash(static_cast<u32>(static_cast<u64>(count) * 8 / 7 + 1));
+			}
+		}
+
+		/**
+		 * Move every key into a new set of slots, which is the next power of 2 of `capacity` slots or however many the keys need, whichever is more.
+		 *
+		 * @error This will crash the program if it failed to allocate.
+		 */
+		void rehash(u32 capacity)
+		{
+			u64 needed = static_cast<u64>(len) * 8 / 7 + 1;
+			capacity   = std::bit_ceil(static_cast<u32>(MAX(MAX(static_cast<u64>(capacity), needed), internal::HASHTABLE_GROUP_SIZE)));
+
+			Entry *old_entries = _entries;
+			u8 *old_ctrl       = _ctrl;
+			u32 old_capacity   = _capacity;
+
+			// Entries, control bytes and the group overflow counts all share one allocation.
+			u32 groups         = capacity / internal::HASHTABLE_GROUP_SIZE;
+			auto *data         = static_cast<byte *>(policy.alloc(capacity * sizeof(Entry) + capacity + groups));
+			PRODUCTION_ASSERT(data != nullptr, "Failed to allocate memory!");
+			_entries  = reinterpret_cast<Entry *>(data);
+			_ctrl     = data + capacity * sizeof(Entry);
+			_overflow = _ctrl + capacity;
+			_capacity = capacity;
+			memset(_ctrl, internal::HASHTABLE_EMPTY, capacity);
+			memset(_overflow, 0, groups);
+
+			for (u32 i = 0; i < old_capacity; i++)
+			{
+				if (old_ctrl[i] & internal::HASHTABLE_EMPTY)
+					continue;
+
+				auto *entry = &old_entries[i];
+				u64 slot    = place(HashFn{}(entry->key));
+				new (&_entries[slot]) Entry(std::move(*entry));
+				entry->~Entry();
+			}
+
+			if (old_entries != nullptr)
+			{
+				policy.free(old_entries);
+			}
+		}
+
+		/**
+		 * Call `callback(const K &, V &)` for every key in the table, in no particular order. Keys must not be inserted or removed from within the callback.
+		 */
+		template <typename Callback>
+		void for_each(Callback callback) const
+		{
+			for (u32 i = 0; i < _capacity; i++)
+			{
+				if (!(_ctrl[i] & internal::HASHTABLE_EMPTY))
+				{
+					callback(static_cast<const K &>(_entries[i].key), _entries[i].value);
+				}
+			}
+		}
+
+		/**
+		 * Remove every key. The memory of the table is kept.
+		 */
+		void clear()
+		{
+			destroy_entries();
+			if (_capacity > 0)
+			{
+				memset(_ctrl, internal::HASHTABLE_EMPTY, _capacity);
+				memset(_overflow, 0, _capacity / internal::HASHTABLE_GROUP_SIZE);
+			}
+			len = 0;
+		}
+
+		bool empty() const { return len == 0; }
+
+		struct Iterator
+		{
+			Entry &operator*() const { return table->_entries[index]; }
+			Entry *operator->() const { return &table->_entries[index]; }
+
+			Iterator &operator++()
+			{
+				index++;
+				skip_empty();
+				return *this;
+			}
+
+			bool operator==(const Iterator &other) const { return index == other.index; }
+			bool operator!=(const Iterator &other) const { return index != other.index; }
+
+			void skip_empty()
+			{
+				while (index < table->_capacity && (table->_ctrl[index] & internal::HASHTABLE_EMPTY))
+				{
+					index++;
+				}
+			}
+
+			const HashTable *table = nullptr;
+			u32 index              = 0;
+		};
+
+		Iterator begin() const
+		{
+			Iterator iterator{.table = this, .index = 0};
+			iterator.skip_empty();
+			return iterator;
+		}
+
+		Iterator end() const { return Iterator{.table = this, .index = _capacity}; }
+
+		// The number of keys in the table.
+		u32 len = 0;
+
+		// Where the memory of the table comes from
+		Policy policy;
+
+	  private:
+		static constexpr u64 INVALID_SLOT = UINT64_MAX;
+
+		// The high bits of the hash pick the group the probe starts at, the low 7 bits are stored in the control byte.
+		static u8 h2(u64 hash) { return static_cast<u8>(hash & 0x7F); }
+
+		u64 group_mask() const { return _capacity / internal::HASHTABLE_GROUP_SIZE - 1; }
+
+		u64 probe_start(u64 hash) const { return (hash >> 7) & group_mask(); }
+
+		u32 max_len() const { return static_cast<u32>(static_cast<u64>(_capacity) * 7 / 8); }
+
+		u64 find_slot(const K &key, u64 hash) const
+		{
+			if (_capacity == 0)
+				return INVALID_SLOT;
+
+			// Groups are probed with triangular steps, which visit every group once when the number of groups is a power of 2.
+			u64 group  = probe_start(hash);
+			u64 groups = _capacity / internal::HASHTABLE_GROUP_SIZE;
+			for (u64 i = 1; i <= groups; i++)
+			{
+				internal::HashTableGroup ctrl(&_ctrl[group * internal::HASHTABLE_GROUP_SIZE]);
+				for (u32 bits = ctrl.match(h2(hash)); bits != 0; bits &= bits - 1)
+				{
+					u64 slot = group * internal::HASHTABLE_GROUP_SIZE + std::countr_zero(bits);
+					if (EqualFn{}(_entries[slot].key, key))
+						return slot;
+				}
+
+				// No key went past this group, so the key would have been in it.
+				if (_overflow[group] == 0)
+					return INVALID_SLOT;
+
+				group = (group + i) & group_mask();
+			}
+			return INVALID_SLOT;
+		}
+
+		// Claim the first empty slot along the probe sequence of a hash, counting every full group on the way as probed past.
+		u64 place(u64 hash)
+		{
+			u64 group = probe_start(hash);
+			for (u64 i = 1;; i++)
+			{
+				internal::HashTableGroup ctrl(&_ctrl[group * internal::HASHTABLE_GROUP_SIZE]);
+				u32 empty = ctrl.match_empty();
+				if (empty != 0)
+				{
+					u64 slot    = group * internal::HASHTABLE_GROUP_SIZE + std::countr_zero(empty);
+					_ctrl[slot] = h2(hash);
+					return slot;
+				}
+
+				// Counts that saturate stay there, which only costs lookups that could have stopped early.
+				if (_overflow[group] != UINT8_MAX)
+				{
+					_overflow[group]++;
+				}
+				group = (group + i) & group_mask();
+			}
+		}
+
+		// Insert a key that isn't in the table yet, leaving its value to be constructed by the caller.
+		u64 insert_new(const K &key, u64 hash)
+		{
+			if (len >= max_len())
+			{
+				rehash(_capacity * 2);
+			}
+
+			u64 slot = place(hash);
+			new (&_entries[slot].key) K(key);
+			len++;
+			return slot;
+		}
+
+		void destroy_entries()
+		{
+			if constexpr (!std::is_trivially_destructible_v<Entry>)
+			{
+				for (u32 i = 0; i < _capacity; i++)
+				{
+					if (!(_ctrl[i] & internal::HASHTABLE_EMPTY))
+					{
+						_entries[i].~Entry();
+					}
+				}
+			}
+		}
+
+		Entry *_entries = nullptr;
+		u8 *_ctrl       = nullptr;
+
+		// For every group, how many keys are stored past it because it was full when they were inserted.
+		u8 *_overflow   = nullptr;
+		u32 _capacity   = 0;
+	};
+} // namespace vtl
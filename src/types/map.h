@@ -1,6 +1,151 @@
 #pragma once
+#include "types.h"
+#include "array.h"
+#include <functional>
+#include <utility>
 
 namespace vtl
 {
+	/**
+	 * Map which keeps its keys sorted in one contiguous array and its values in another, for the many small tables in the engine like uniforms keyed by their location.
+	 * Lookups are a branchless binary search over the keys alone, which for a few dozen keys beats hashing and stays in a cache line or two.
+	 * Inserting and removing shift everything after the key, so this is not the right container for thousands of keys that change often, see `HashTable` for those.
+	 *
+	 * The first `N` keys and values are stored inside the map, past that memory comes from an allocator policy, see allocator_policy.h.
+	 * Pointers to values are invalidated by inserting or removing keys.
+	 */
+	template <typename K, typename V, u32 N = 8, typename Less = std::less<K>, typename Policy = Vultr::DynamicAllocatorPolicy>
+	struct FlatMap
+	{
+		FlatMap(Policy policy) : keys(policy), values(policy) {}
 
-}
+		FlatMap &operator=(const FlatMap &other) = delete;
+		FlatMap(const FlatMap &other)            = delete;
+
+		/**
+		 * Find the value of a key.
+		 *
+		 * @param const K &key: The key to look for.
+		 *
+		 * @return V *: The value, which is invalidated when keys are inserted or removed.
+		 *
+		 * @error Returns nullptr if the key isn't in the map.
+		 */
+		V *find(const K &key) const
+		{
+			u32 index = lower_bound(key);
+			if (!is_key_at(index, key))
+				return nullptr;
+
+			return &values[index];
+		}
+
+		bool contains(const K &key) const { return find(key) != nullptr; }
+
+		/**
+		 * Insert a key, or overwrite its value if it is already in the map.
+		 *
+		 * @return V *: The value in the map, which is invalidated when keys are inserted or removed.
+		 *
+		 * @error This will crash the program if the map had to grow and failed to allocate.
+		 */
+		V *insert(const K &key, V value)
+		{
+			u32 index = lower_bound(key);
+			if (is_key_at(index, key))
+			{
+				values[index] = std::move(value);
+				return &values[index];
+			}
+
+			keys.insert(index, key);
+			return values.insert(index, std::move(value));
+		}
+
+		/**
+		 * Get the value of a key, inserting a default constructed value if it isn't in the map yet.
+		 */
+		V &operator[](const K &key)
+		{
+			u32 index = lower_bound(key);
+			if (!is_key_at(index, key))
+			{
+				keys.insert(index, key);
+				values.insert(index, V());
+			}
+			return values[index];
+		}
+
+		/**
+		 * Remove a key and its value.
+		 *
+		 * @return bool: Whether the key was in the map.
+		 */
+		bool remove(const K &key)
+		{
+			u32 index = lower_bound(key);
+			if (!is_key_at(index, key))
+				return false;
+
+			keys.remove(index);
+			values.remove(index);
+			return true;
+		}
+
+		/**
+		 * Call `callback(const K &, V &)` for every key in the map, in sorted order. Keys must not be inserted or removed from within the callback.
+		 */
+		template <typename Callback>
+		void for_each(Callback callback) const
+		{
+			for (u32 i = 0; i < keys.len; i++)
+			{
+				callback(static_cast<const K &>(keys[i]), values[i]);
+			}
+		}
+
+		void clear()
+		{
+			keys.clear();
+			values.clear();
+		}
+
+		void reserve(u32 count)
+		{
+			keys.reserve(count);
+			values.reserve(count);
+		}
+
+		u32 size() const { return keys.len; }
+
+		bool empty() const { return keys.empty(); }
+
+		/**
+		 * The index of the first key that isn't less than `key`, which is where it is or would be inserted.
+		 */
+		u32 lower_bound(const K &key) const
+		{
+			u32 count = keys.len;
+			if (count == 0)
+				return 0;
+
+			// Halve the range every step without branching on the comparison, so the loop never mispredicts and the compiler can turn the select into a cmov.
+			const K *first = keys.data();
+			const K *base  = first;
+			while (count > 1)
+			{
+				u32 half = count / 2;
+				base     = Less{}(base[half], key) ? base + half : base;
+				count -= half;
+			}
+			return static_cast<u32>(base - first) + Less{}(*base, key);
+		}
+
+		// Sorted keys and the values at the same indices.
+		SmallArray<K, N, Policy> keys;
+		SmallArray<V, N, Policy> values;
+
+	  private:
+		bool is_key_at(u32 index, const K &key) const { return index < keys.len && !Less{}(key, keys[index]); }
+	};
+} // namespace vtl
@@ -0,0 +1,197 @@
+#pragma once
+#include "types.h"
+#include "thread.h"
+#include <core/memory/allocator_policy.h>
+#include <bit>
+#include <utility>
+
+namespace vtl
+{
+	/**
+	 * Bounded lock-free queue that any number of threads can push to and pop from, like the work queue of the resource loader.
+	 *
+	 * Every slot carries a sequence number that says whether it is ready to be written or read for the current lap around the buffer,
+	 * so pushing and popping are a single compare and swap on the back or front index unless another thread won the same slot.
+	 *
+	 * Memory comes from an allocator policy, see allocator_policy.h, and is allocated once up front. The capacity is rounded up to a power of 2.
+	 * A `blocking` queue lets consumers sleep in @ref pop_wait while it is empty, which costs producers a fence on every push.
+	 */
+	template <typename T, bool blocking = false, typename Policy = Vultr::DynamicAllocatorPolicy>
+	struct MpmcQueue
+	{
+		MpmcQueue(Policy policy, size_t capacity) : policy(policy)
+		{
+			ASSERT(capacity > 0, "Queue must have room for at least 1 element!");
+			_capacity = std::bit_ceil(MAX(capacity, static_cast<size_t>(2)));
+			_cells    = static_cast<Cell *>(policy.alloc(_capacity * sizeof(Cell)));
+			PRODUCTION_ASSERT(_cells != nullptr, "Failed to allocate memory!");
+
+			for (size_t i = 0; i < _capacity; i++)
+			{
+				new (&_cells[i].sequence) std::atomic<size_t>(i);
+			}
+		}
+
+		~MpmcQueue()
+		{
+			if constexpr (!std::is_trivially_destructible_v<T>)
+			{
+				size_t back = _back.load(std::memory_order_acquire);
+				for (size_t i = _front.load(std::memory_order_relaxed); i != back; i++)
+				{
+					_cells[i & (_capacity - 1)].item()->~T();
+				}
+			}
+			policy.free(_cells);
+		}
+
+		MpmcQueue(const MpmcQueue &)            = delete;
+		MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+		/**
+		 * Construct an element at the back of the queue.
+		 *
+		 * @return bool: Whether there was room for it.
+		 *
+		 * @thread_safe
+		 */
+		template <typename... Args>
+		bool try_emplace(Args &&...args)
+		{
+			Cell *cell = nullptr;
+			size_t pos = _back.load(std::memory_order_relaxed);
+			while (true)
+			{
+				cell          = &_cells[pos & (_capacity - 1)];
+				size_t seq    = cell->sequence.load(std::memory_order_acquire);
+				intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+				// The slot is free for this lap, try to claim it.
+				if (diff == 0)
+				{
+					if (_back.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				// The slot still holds an element from the last lap, so the queue is full.
+				else if (diff < 0)
+				{
+					return false;
+				}
+				// Another thread claimed the slot first.
+				else
+				{
+					pos = _back.load(std::memory_order_relaxed);
+				}
+			}
+
+			new (cell->item()) T(std::forward<Args>(args)...);
+			cell->sequence.store(pos + 1, std::memory_order_release);
+
+			if constexpr (blocking)
+			{
+				_event.notify();
+			}
+			return true;
+		}
+
+		bool try_push(const T &item) { return try_emplace(item); }
+
+		bool try_push(T &&item) { return try_emplace(std::move(item)); }
+
+		/**
+		 * Move the element at the front of the queue into `out`.
+		 *
+		 * @return bool: Whether there was an element.
+		 *
+		 * @thread_safe
+		 */
+		bool try_pop(T *out)
+		{
+			Cell *cell = nullptr;
+			size_t pos = _front.load(std::memory_order_relaxed);
+			while (true)
+			{
+				cell          = &_cells[pos & (_capacity - 1)];
+				size_t seq    = cell->sequence.load(std::memory_order_acquire);
+				intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+
+				// The slot was written this lap, try to claim it.
+				if (diff == 0)
+				{
+					if (_front.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				// Nothing has been written to the slot yet, so the queue is empty.
+				else if (diff < 0)
+				{
+					return false;
+				}
+				// Another thread claimed the slot first.
+				else
+				{
+					pos = _front.load(std::memory_order_relaxed);
+				}
+			}
+
+			T *item = cell->item();
+			*out    = std::move(*item);
+			item->~T();
+			// Hand the slot to the producer of the next lap.
+			cell->sequence.store(pos + _capacity, std::memory_order_release);
+			return true;
+		}
+
+		/**
+		 * Move the element at the front of the queue into `out`, sleeping until there is one.
+		 *
+		 * @thread_safe
+		 */
+		void pop_wait(T *out)
+		{
+			static_assert(blocking, "Queue must be blocking before you can pop wait!");
+			while (!try_pop(out))
+			{
+				u32 key = _event.prepare_wait();
+				if (try_pop(out))
+					return;
+				_event.wait(key);
+			}
+		}
+
+		/**
+		 * The number of elements in the queue. This is only a snapshot if other threads are using it, and counts elements that are still being pushed or popped.
+		 *
+		 * @thread_safe
+		 */
+		size_t size() const
+		{
+			size_t front = _front.load(std::memory_order_acquire);
+			size_t back  = _back.load(std::memory_order_acquire);
+			return back > front ? back - front : 0;
+		}
+
+		bool empty() const { return size() == 0; }
+
+		size_t capacity() const { return _capacity; }
+
+		// Where the memory of the queue comes from
+		Policy policy;
+
+	  private:
+		struct Cell
+		{
+			std::atomic<size_t> sequence;
+			alignas(T) byte storage[sizeof(T)];
+
+			T *item() { return reinterpret_cast<T *>(storage); }
+		};
+
+		Cell *_cells     = nullptr;
+		size_t _capacity = 0;
+
+		// The indices only ever count up, and are wrapped into the buffer when it is indexed.
+		alignas(CACHE_LINE_SIZE) std::atomic<size_t> _back  = 0;
+		alignas(CACHE_LINE_SIZE) std::atomic<size_t> _front = 0;
+		alignas(CACHE_LINE_SIZE) EventCount _event;
+	};
+} // namespace vtl
@@ -1,156 +1,291 @@
-// TODO(Brandon): Replace with custom allocator.
 #pragma once
 #include "thread.h"
 #include "types.h"
+#include "dynamic_array.h"
+#include <core/memory/allocator_policy.h>
+#include <bit>
+#include <string.h>
+#include <utility>
 
 namespace vtl
 {
-	template <typename T, size_t reserved = 10, u32 growth_numerator = 3, u32 growth_denominator = 2, u32 decay_percent_threshold = 30, bool threaded = false>
+	/**
+	 * First in first out queue over a ring buffer, so pushing to the back and popping from the front are both O(1).
+	 *
+	 * Memory comes from an allocator policy, see allocator_policy.h. The capacity is always a power of 2 and doubles when the queue is full,
+	 * the elements that wrapped around to the start of the buffer are then moved right after the rest of them.
+	 *
+	 * A `threaded` queue takes a mutex around every operation and can be waited on with @ref pop_wait.
+	 */
+	template <typename T, size_t reserved = 16, bool threaded = false, typename Policy = Vultr::DynamicAllocatorPolicy>
 	struct Queue
 	{
-		Queue()
+		Queue(Policy policy, size_t capacity = reserved) : policy(policy)
 		{
-			_size = reserved;
-			len   = 0;
-			if (reserved > 0)
+			if (capacity > 0)
 			{
-				// _array = static_cast<T *>(malloc(_size * sizeof(T)));
+				grow(capacity);
 			}
 		}
 
 		~Queue()
 		{
+			clear();
 			if (_array != nullptr)
 			{
-				// free(_array);
+				policy.free(_array);
 				_array = nullptr;
 			}
 		}
 
-		Queue(const Queue &) = delete;
+		Queue(const Queue &)            = delete;
 		Queue &operator=(const Queue &) = delete;
 
+		/**
+		 * Get the element that will be popped next.
+		 */
 		T *front()
 		{
 			if (threaded)
 				queue_mutex.lock();
-			assert(len > 0 && "No _array in queue!");
-			T *item = &_array[len - 1];
+			ASSERT(len > 0, "No elements in queue!");
+			T *item = &_array[_head];
 			if (threaded)
 				queue_mutex.unlock();
 			return item;
 		}
 
-		void push(const T &item)
+		/**
+		 * Push an element to the back of the queue.
+		 *
+		 * @error This will crash the program if the queue had to grow and failed to allocate.
+		 */
+		void push(const T &item) { emplace(item); }
+
+		void push(T &&item) { emplace(std::move(item)); }
+
+		template <typename... Args>
+		void emplace(Args &&...args)
 		{
 			if (threaded)
 				queue_mutex.lock();
+
+			if (len == _capacity)
+			{
+				// The arguments could refer to an element of this queue, so they have to be used up before growing moves it.
+				T value(std::forward<Args>(args)...);
+				grow(len + 1);
+				new (&_array[index(len)]) T(std::move(value));
+			}
+			else
+			{
+				new (&_array[index(len)]) T(std::forward<Args>(args)...);
+			}
 			len++;
-			_reallocate();
-			for (s32 i = len - 1; i >= 1; i--)
+
+			if (threaded)
+			{
+				queue_mutex.unlock();
+				queue_cond.notify_one();
+			}
+		}
+
+		/**
+		 * Push `count` elements to the back of the queue in order, growing at most once.
+		 *
+		 * @error This will crash the program if the queue had to grow and failed to allocate.
+		 */
+		void push_n(const T *items, size_t count)
+		{
+			if (count == 0)
+				return;
+
+			if (threaded)
+				queue_mutex.lock();
+
+			if (len + count > _capacity)
 			{
-				_array[i] = _array[i - 1];
+				grow(len + count);
 			}
 
-			_array[0] = item;
+			// The free space is at most two runs, one up to the end of the buffer and one from its start.
+			size_t tail  = index(len);
+			size_t first = MIN(count, _capacity - tail);
+			copy_construct(&_array[tail], items, first);
+			copy_construct(_array, items + first, count - first);
+			len += count;
 
 			if (threaded)
 			{
 				queue_mutex.unlock();
-				queue_cond.notify_one();
+				queue_cond.notify_all();
 			}
 		}
 
+		/**
+		 * Remove the element at the front of the queue.
+		 */
 		void pop()
 		{
-			assert(!empty() && "No elements to pop!");
-			len--;
-			_reallocate();
+			if (threaded)
+				queue_mutex.lock();
+			internal_pop();
+			if (threaded)
+				queue_mutex.unlock();
+		}
+
+		/**
+		 * Move up to `count` elements from the front of the queue into `out`, in order.
+		 *
+		 * @return size_t: How many elements were popped, which is less than `count` if the queue ran out.
+		 */
+		size_t pop_n(T *out, size_t count)
+		{
+			if (threaded)
+				queue_mutex.lock();
+
+			count        = MIN(count, len);
+			size_t first = MIN(count, _capacity - _head);
+			move_out(out, &_array[_head], first);
+			move_out(out + first, _array, count - first);
+			_head = index(count);
+			len -= count;
+
+			if (threaded)
+				queue_mutex.unlock();
+			return count;
 		}
 
-		void pop_wait()
+		/**
+		 * Wait until the queue has an element and pop it.
+		 *
+		 * @return T: The element that was at the front of the queue.
+		 */
+		T pop_wait()
 		{
-			assert(threaded && "Queue must be threaded before you can pop wait!");
+			static_assert(threaded, "Queue must be threaded before you can pop wait!");
 			std::unique_lock<vtl::mutex> lock(queue_mutex);
 			while (empty())
 			{
 				queue_cond.wait(lock);
 			}
-			pop();
+			T item(std::move(_array[_head]));
+			internal_pop();
+			return item;
 		}
 
 		bool empty() const { return len == 0; }
 
+		size_t capacity() const { return _capacity; }
+
+		/**
+		 * Destroy every element. The buffer is kept.
+		 */
 		void clear()
 		{
-			len   = 0;
-			_size = reserved;
-			if (reserved > 0)
+			if constexpr (!std::is_trivially_destructible_v<T>)
 			{
-				if (_array == nullptr)
+				for (size_t i = 0; i < len; i++)
 				{
-					// _array = (T *)malloc(_size * sizeof(T));
-				}
-				else
-				{
-					// _array = (T *)realloc(_array, _size * sizeof(T));
+					_array[index(i)].~T();
 				}
 			}
+			_head = 0;
+			len   = 0;
+		}
+
+		// Elements in the queue (not bytes)
+		size_t len = 0;
+
+		// Where the memory of the queue comes from
+		Policy policy;
+
+	  private:
+		// Index in the buffer of the i-th element from the front
+		size_t index(size_t i) const { return (_head + i) & (_capacity - 1); }
+
+		void internal_pop()
+		{
+			ASSERT(len > 0, "No elements to pop!");
+			_array[_head].~T();
+			_head = index(1);
+			len--;
 		}
 
-		void _reallocate()
+		static void copy_construct(T *dst, const T *src, size_t count)
 		{
-			// Only reallocate and expand the array if we need to
-			if (len > _size)
-			{
-				_size = len * growth_factor;
-			}
-			else if ((f64)len / (f64)_size < (f64)decay_percent_threshold / 100.0)
+			if constexpr (std::is_trivially_copyable_v<T>)
 			{
-				_size = len * growth_factor;
+				if (count > 0)
+				{
+					memcpy(dst, src, count * sizeof(T));
+				}
 			}
 			else
 			{
-				return;
+				for (size_t i = 0; i < count; i++)
+				{
+					new (&dst[i]) T(src[i]);
+				}
 			}
+		}
 
-			if (_size < reserved)
+		static void move_out(T *dst, T *src, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
 			{
-				_size = reserved;
+				dst[i] = std::move(src[i]);
+				src[i].~T();
 			}
+		}
+
+		// Move the elements into a buffer of the next power of 2 of `count` elements, starting at its first element.
+		void grow(size_t count)
+		{
+			size_t capacity = std::bit_ceil(MAX(MAX(count, _capacity * 2), static_cast<size_t>(2)));
 
-			if (_size == 0)
+			if (_array == nullptr)
+			{
+				_array = static_cast<T *>(policy.alloc(capacity * sizeof(T)));
+				PRODUCTION_ASSERT(_array != nullptr, "Failed to allocate memory!");
+			}
+			else if constexpr (is_trivially_relocatable_v<T>)
 			{
-				if (_array != nullptr)
+				_array = static_cast<T *>(policy.realloc(_array, _capacity * sizeof(T), capacity * sizeof(T)));
+				PRODUCTION_ASSERT(_array != nullptr, "Failed to reallocate memory!");
+
+				// Since the buffer at least doubled, the elements that wrapped around fit right after the old end of it.
+				size_t wrapped = _head + len > _capacity ? _head + len - _capacity : 0;
+				if (wrapped > 0)
 				{
-					// free(_array);
-					_array = nullptr;
+					memcpy(&_array[_capacity], _array, wrapped * sizeof(T));
 				}
 			}
 			else
 			{
-				if (_array == nullptr)
+				auto *array = static_cast<T *>(policy.alloc(capacity * sizeof(T)));
+				PRODUCTION_ASSERT(array != nullptr, "Failed to allocate memory!");
+				for (size_t i = 0; i < len; i++)
 				{
-					_array = (T *)malloc(_size * sizeof(T));
-				}
-				else
-				{
-					// _array = (T *)realloc(_array, _size * sizeof(T));
+					T *item = &_array[index(i)];
+					new (&array[_head + i]) T(std::move(*item));
+					item->~T();
 				}
+				policy.free(_array);
+				_array = array;
 			}
+
+			_capacity = capacity;
 		}
 
-		// The internal array
+		// The internal ring buffer
 		T *_array = nullptr;
 
-		// Spaces len (not bytes)
-		size_t len = 0;
-
-		// Space in _array (not bytes)
-		size_t _size = reserved;
+		// Index in _array of the front of the queue
+		size_t _head = 0;
 
-		// To make sure that the buffer expansion is geometric
-		f64 growth_factor = (f64)growth_numerator / (f64)growth_denominator;
+		// Space in _array (not bytes), always a power of 2
+		size_t _capacity = 0;
 
 		vtl::mutex queue_mutex;
 		vtl::condition_variable queue_cond;
@@ -0,0 +1,154 @@
+#pragma once
+#include "types.h"
+#include "thread.h"
+#include <core/memory/allocator_policy.h>
+#include <bit>
+#include <utility>
+
+namespace vtl
+{
+	/**
+	 * Bounded lock-free queue between exactly one producer thread and one consumer thread, like the render thread and whoever submits to it.
+	 *
+	 * Both sides only ever load the other side's index with acquire and publish their own with release, and each keeps a cached copy of the other's index
+	 * so that it only touches the other thread's cache line when the ring looks full or empty.
+	 *
+	 * Memory comes from an allocator policy, see allocator_policy.h, and is allocated once up front. The capacity is rounded up to a power of 2.
+	 * A `blocking` ring lets the consumer sleep in @ref pop_wait while it is empty, which costs the producer a fence on every push.
+	 */
+	template <typename T, bool blocking = false, typename Policy = Vultr::DynamicAllocatorPolicy>
+	struct SpscRing
+	{
+		SpscRing(Policy policy, size_t capacity) : policy(policy)
+		{
+			ASSERT(capacity > 0, "Ring must have room for at least 1 element!");
+			_capacity = std::bit_ceil(capacity);
+			_array    = static_cast<T *>(policy.alloc(_capacity * sizeof(T)));
+			PRODUCTION_ASSERT(_array != nullptr, "Failed to allocate memory!");
+		}
+
+		~SpscRing()
+		{
+			if constexpr (!std::is_trivially_destructible_v<T>)
+			{
+				size_t tail = _producer.tail.load(std::memory_order_acquire);
+				for (size_t i = _consumer.head.load(std::memory_order_relaxed); i != tail; i++)
+				{
+					_array[i & (_capacity - 1)].~T();
+				}
+			}
+			policy.free(_array);
+		}
+
+		SpscRing(const SpscRing &)            = delete;
+		SpscRing &operator=(const SpscRing &) = delete;
+
+		/**
+		 * Construct an element at the back of the ring.
+		 *
+		 * @return bool: Whether there was room for it.
+		 *
+		 * @no_thread_safety Must only be called from the producer thread.
+		 */
+		template <typename... Args>
+		bool try_emplace(Args &&...args)
+		{
+			size_t tail = _producer.tail.load(std::memory_order_relaxed);
+			if (tail - _producer.cached_head == _capacity)
+			{
+				_producer.cached_head = _consumer.head.load(std::memory_order_acquire);
+				if (tail - _producer.cached_head == _capacity)
+					return false;
+			}
+
+			new (&_array[tail & (_capacity - 1)]) T(std::forward<Args>(args)...);
+			_producer.tail.store(tail + 1, std::memory_order_release);
+
+			if constexpr (blocking)
+			{
+				_event.notify();
+			}
+			return true;
+		}
+
+		bool try_push(const T &item) { return try_emplace(item); }
+
+		bool try_push(T &&item) { return try_emplace(std::move(item)); }
+
+		/**
+		 * Move the element at the front of the ring into `out`.
+		 *
+		 * @return bool: Whether there was an element.
+		 *
+		 * @no_thread_safety Must only be called from the consumer thread.
+		 */
+		bool try_pop(T *out)
+		{
+			size_t head = _consumer.head.load(std::memory_order_relaxed);
+			if (head == _consumer.cached_tail)
+			{
+				_consumer.cached_tail = _producer.tail.load(std::memory_order_acquire);
+				if (head == _consumer.cached_tail)
+					return false;
+			}
+
+			T *item = &_array[head & (_capacity - 1)];
+			*out    = std::move(*item);
+			item->~T();
+			_consumer.head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		/**
+		 * Move the element at the front of the ring into `out`, sleeping until there is one.
+		 *
+		 * @no_thread_safety Must only be called from the consumer thread.
+		 */
+		void pop_wait(T *out)
+		{
+			static_assert(blocking, "Ring must be blocking before you can pop wait!");
+			while (!try_pop(out))
+			{
+				u32 key = _event.prepare_wait();
+				if (try_pop(out))
+					return;
+				_event.wait(key);
+			}
+		}
+
+		/**
+		 * The number of elements in the ring. This is only a snapshot if the other thread is using it.
+		 *
+		 * @thread_safe
+		 */
+		size_t size() const { return _producer.tail.load(std::memory_order_acquire) - _consumer.head.load(std::memory_order_acquire); }
+
+		bool empty() const { return size() == 0; }
+
+		size_t capacity() const { return _capacity; }
+
+		// Where the memory of the ring comes from
+		Policy policy;
+
+	  private:
+		T *_array        = nullptr;
+		size_t _capacity = 0;
+
+		// The indices only ever count up, and are wrapped into the array when it is indexed.
+		struct alignas(CACHE_LINE_SIZE) ProducerIndices
+		{
+			std::atomic<size_t> tail = 0;
+			size_t cached_head       = 0;
+		};
+
+		struct alignas(CACHE_LINE_SIZE) ConsumerIndices
+		{
+			std::atomic<size_t> head = 0;
+			size_t cached_tail       = 0;
+		};
+
+		ProducerIndices _producer;
+		ConsumerIndices _consumer;
+		alignas(CACHE_LINE_SIZE) EventCount _event;
+	};
+} // namespace vtl
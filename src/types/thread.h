@@ -2,6 +2,7 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <platform/platform.h>
 
 namespace vtl
 {
@@ -9,4 +10,76 @@ namespace vtl
 	typedef std::mutex mutex;
 	typedef std::condition_variable condition_variable;
 
+	/**
+	 * Lets consumers of a lock-free container sleep while it is empty, without producers paying for a system call unless somebody is actually asleep.
+	 *
+	 *     // Consumer
+	 *     while (!queue.try_pop(&item))
+	 *     {
+	 *         u32 key = event.prepare_wait();
+	 *         if (queue.try_pop(&item))
+	 *             break;
+	 *         event.wait(key);
+	 *     }
+	 *
+	 *     // Producer
+	 *     queue.try_push(item);
+	 *     event.notify();
+	 *
+	 * Checking the container again after @ref prepare_wait is what keeps a consumer from sleeping through an element that was pushed in between.
+	 * The lowest bit of the epoch says whether anyone prepared to wait since it was last bumped, so only the first notify after that wakes anybody,
+	 * and it wakes every waiter since it can't tell how many there are.
+	 */
+	struct EventCount
+	{
+		/**
+		 * Announce that the calling thread is about to wait. If it doesn't end up waiting, the next @ref notify makes a system call for nothing.
+		 *
+		 * @return u32: The key to pass to @ref wait.
+		 *
+		 * @thread_safe
+		 */
+		u32 prepare_wait()
+		{
+			u32 key = epoch.fetch_or(1, std::memory_order_seq_cst) | 1;
+			// Pairs with the fence in notify, so either the producer sees the waiter or the consumer sees the element.
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			return key;
+		}
+
+		/**
+		 * Sleep until @ref notify is called after the matching @ref prepare_wait.
+		 *
+		 * @thread_safe
+		 */
+		void wait(u32 key)
+		{
+			while (epoch.load(std::memory_order_acquire) == key)
+			{
+				Vultr::Platform::wait_on_address(&epoch, key);
+			}
+		}
+
+		/**
+		 * Wake sleeping consumers after something was pushed. This is only a fence and a load if nobody is waiting.
+		 *
+		 * @thread_safe
+		 */
+		void notify()
+		{
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			u32 current = epoch.load(std::memory_order_relaxed);
+			while (current & 1)
+			{
+				// Moving on to the next even epoch wakes everyone waiting on this one, and tells the next notify that there is nobody left.
+				if (epoch.compare_exchange_weak(current, current + 1, std::memory_order_release, std::memory_order_relaxed))
+				{
+					Vultr::Platform::wake_on_address(&epoch, true);
+					return;
+				}
+			}
+		}
+
+		atomic_u32 epoch = 0;
+	};
 } // namespace vtl
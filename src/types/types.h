@@ -75,6 +75,10 @@ typedef std::atomic<size_t> atomic_size_t;
 #endif // DEBUG
 
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+// Size in bytes of a cache line, used to keep data written by different threads from sharing a line.
+#define CACHE_LINE_SIZE 64
 
 #ifdef DEBUG
 // clang-format off
@@ -1,3 +1,5 @@
 #pragma once
+#include "array.h"
 #include "dynamic_array.h"
 #include "hashtable.h"
+#include "map.h"
@@ -1,24 +1,253 @@
 #include "vultr.h"
 namespace Vultr
 {
-	GameMemory *g_game_memory = nullptr;
+	GameMemory *g_game_memory                = nullptr;
+	thread_local ThreadArena *g_thread_arena = nullptr;
+
+	// Block sizes of the pool of every thread arena, allocations bigger than the last one go to the general allocator.
+	static PoolRegion s_thread_arena_pool_regions[] = {{.size = 64, .count = 1024}, {.size = 256, .count = 512}, {.size = Kilobyte(1), .count = 256}};
+#define THREAD_ARENA_MAX_POOL_BLOCK Kilobyte(1)
 
 	GameMemory *init_game_memory()
 	{
-		auto *arena                     = init_mem_arena(Gigabyte(1));
-		auto *persistent_storage        = init_linear_allocator(arena, Kilobyte(1));
+		// Only address space is reserved up front, physical memory is committed as the allocators grow.
+		auto *arena                     = init_mem_arena(Gigabyte(4), 16, MEM_ARENA_RESERVE_ONLY);
+		auto *persistent_storage        = init_linear_allocator(arena, Megabyte(64));
+
+		auto *frame_storage             = init_frame_allocator(arena, Megabyte(16), FRAMES_IN_FLIGHT);
+		auto *general_allocator         = init_free_list_allocator(arena, GAME_MEMORY_GENERAL_SIZE, 16);
 
 		auto *game_memory               = alloc<GameMemory>(persistent_storage);
 
 		game_memory->arena              = arena;
 		game_memory->persistent_storage = persistent_storage;
+		game_memory->frame_storage      = frame_storage;
+		game_memory->general_allocator  = general_allocator;
+
+		// Physical memory is only committed as the thread arenas are used, except for the pools which are set up front.
+		for (auto &thread_arena : game_memory->thread_arenas)
+		{
+			thread_arena.scratch_storage   = init_linear_allocator(arena, THREAD_ARENA_SCRATCH_SIZE);
+			thread_arena.pool_allocator    = init_pool_allocator(arena, s_thread_arena_pool_regions, sizeof(s_thread_arena_pool_regions) / sizeof(PoolRegion));
+			thread_arena.general_allocator = init_free_list_allocator(arena, THREAD_ARENA_GENERAL_SIZE, 16);
+			PRODUCTION_ASSERT(thread_arena.scratch_storage != nullptr && thread_arena.pool_allocator != nullptr && thread_arena.general_allocator != nullptr, "Failed to create thread arenas!");
+		}
 
 		return game_memory;
 	}
 
+	void *frame_alloc(size_t size)
+	{
+		ASSERT(g_game_memory != nullptr && g_game_memory->frame_storage != nullptr, "GameMemory not properly initialized!");
+		return frame_allocator_alloc(g_game_memory->frame_storage, size);
+	}
+
 	void destroy_game_memory(GameMemory *m)
 	{
 		ASSERT(m != nullptr && m->arena != nullptr, "GameMemory not properly initialized!");
+		if (m == g_game_memory)
+		{
+			g_game_memory = nullptr;
+		}
 		destroy_mem_arena(m->arena);
 	}
+
+	static void free_deferred(ThreadArena *thread_arena)
+	{
+		auto *deferred = thread_arena->deferred_frees.exchange(nullptr, std::memory_order_acquire);
+		while (deferred != nullptr)
+		{
+			auto *next = deferred->next;
+			mfree(find_allocator(deferred), deferred);
+			deferred = next;
+		}
+	}
+
+	ThreadArena *register_thread_arena(GameMemory *m)
+	{
+		ASSERT(m != nullptr && m->arena != nullptr, "GameMemory not properly initialized!");
+		ASSERT(g_thread_arena == nullptr, "Thread already has a thread arena!");
+
+		for (auto &thread_arena : m->thread_arenas)
+		{
+			bool registered = false;
+			if (thread_arena.registered.compare_exchange_strong(registered, true, std::memory_order_acquire))
+			{
+				g_thread_arena = &thread_arena;
+				free_deferred(&thread_arena);
+				return &thread_arena;
+			}
+		}
+
+		return nullptr;
+	}
+
+	void unregister_thread_arena()
+	{
+		ASSERT(g_thread_arena != nullptr, "Thread doesn't have a thread arena!");
+		free_deferred(g_thread_arena);
+		g_thread_arena->registered.store(false, std::memory_order_release);
+		g_thread_arena = nullptr;
+	}
+
+	void *thread_alloc(size_t size)
+	{
+		ASSERT(g_thread_arena != nullptr, "Thread doesn't have a thread arena!");
+
+		if (g_thread_arena->deferred_frees.load(std::memory_order_relaxed) != nullptr)
+		{
+			free_deferred(g_thread_arena);
+		}
+
+		if (size <= THREAD_ARENA_MAX_POOL_BLOCK)
+		{
+			void *data = malloc(g_thread_arena->pool_allocator, size);
+			if (data != nullptr)
+				return data;
+		}
+
+		return malloc(g_thread_arena->general_allocator, size);
+	}
+
+	// Find the thread arena an allocation made with `thread_alloc` belongs to.
+	static ThreadArena *get_owning_thread_arena(Allocator *allocator)
+	{
+		ASSERT(g_game_memory != nullptr, "GameMemory not properly initialized!");
+		for (auto &thread_arena : g_game_memory->thread_arenas)
+		{
+			if (allocator == thread_arena.pool_allocator || allocator == thread_arena.general_allocator)
+				return &thread_arena;
+		}
+		return nullptr;
+	}
+
+	void thread_free(void *data)
+	{
+		if (data == nullptr)
+			return;
+
+		auto *allocator    = find_allocator(data);
+		auto *thread_arena = get_owning_thread_arena(allocator);
+		ASSERT(thread_arena != nullptr, "Memory wasn't allocated with thread_alloc!");
+
+		if (thread_arena == g_thread_arena)
+		{
+			mfree(allocator, data);
+			return;
+		}
+
+		// The owner might be allocating from the same allocator right now, so leave it to the owner to free.
+		auto *deferred = static_cast<ThreadArenaDeferredFree *>(data);
+		deferred->next = thread_arena->deferred_frees.load(std::memory_order_relaxed);
+		while (!thread_arena->deferred_frees.compare_exchange_weak(deferred->next, deferred, std::memory_order_release, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	void collect_thread_arena()
+	{
+		ASSERT(g_thread_arena != nullptr, "Thread doesn't have a thread arena!");
+		free_deferred(g_thread_arena);
+	}
+
+	void *thread_scratch_alloc(size_t size, size_t alignment)
+	{
+		ASSERT(g_thread_arena != nullptr, "Thread doesn't have a thread arena!");
+		return linear_alloc(g_thread_arena->scratch_storage, size, alignment);
+	}
+
+	void thread_scratch_reset()
+	{
+		ASSERT(g_thread_arena != nullptr, "Thread doesn't have a thread arena!");
+		linear_free(g_thread_arena->scratch_storage);
+	}
 } // namespace Vultr
+
+#ifdef VULTR_GLOBAL_NEW
+// Route every `new` and `delete` into the game memory, so that heap traffic from standard containers and third party code stays inside the memory arena and shows up in the allocator stats.
+// Registered threads allocate from their thread arena and everything else comes from the general allocator behind `general_allocator_mutex`.
+// Anything allocated before `init_game_memory`, and anything aligned more than the allocators can do, comes from the system heap instead.
+// Memory from the game memory must all be deleted before `destroy_game_memory`.
+#include <new>
+#include <stdlib.h>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// The system heap is only used through these two so that Windows, where aligned memory has to be freed with `_aligned_free`, can use the aligned functions for everything.
+static void *system_alloc(size_t size, size_t alignment)
+{
+#ifdef _WIN32
+	return _aligned_malloc(size, alignment);
+#else
+	return alignment > 16 ? std::aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1)) : std::malloc(size);
+#endif
+}
+
+static void system_free(void *data)
+{
+#ifdef _WIN32
+	_aligned_free(data);
+#else
+	std::free(data);
+#endif
+}
+
+static void *global_new(size_t size, size_t alignment)
+{
+	using namespace Vultr;
+	void *data = nullptr;
+	if (g_game_memory == nullptr || alignment > 16)
+	{
+		data = system_alloc(size, MAX(alignment, static_cast<size_t>(16)));
+	}
+	else if (g_thread_arena != nullptr)
+	{
+		data = thread_alloc(size);
+	}
+	else
+	{
+		std::lock_guard<vtl::mutex> lock(g_game_memory->general_allocator_mutex);
+		data = malloc(g_game_memory->general_allocator, size);
+	}
+
+	if (data == nullptr)
+		throw std::bad_alloc();
+	return data;
+}
+
+static void global_delete(void *data)
+{
+	using namespace Vultr;
+	if (data == nullptr)
+		return;
+
+	auto *allocator = find_allocator(data);
+	if (allocator == nullptr)
+	{
+		system_free(data);
+	}
+	else if (allocator == g_game_memory->general_allocator)
+	{
+		std::lock_guard<vtl::mutex> lock(g_game_memory->general_allocator_mutex);
+		mfree(allocator, data);
+	}
+	else
+	{
+		thread_free(data);
+	}
+}
+
+void *operator new(size_t size) { return global_new(size, 16); }
+void *operator new[](size_t size) { return global_new(size, 16); }
+void *operator new(size_t size, std::align_val_t alignment) { return global_new(size, static_cast<size_t>(alignment)); }
+void *operator new[](size_t size, std::align_val_t alignment) { return global_new(size, static_cast<size_t>(alignment)); }
+void operator delete(void *data) noexcept { global_delete(data); }
+void operator delete[](void *data) noexcept { global_delete(data); }
+void operator delete(void *data, size_t) noexcept { global_delete(data); }
+void operator delete[](void *data, size_t) noexcept { global_delete(data); }
+void operator delete(void *data, std::align_val_t) noexcept { global_delete(data); }
+void operator delete[](void *data, std::align_val_t) noexcept { global_delete(data); }
+void operator delete(void *data, size_t, std::align_val_t) noexcept { global_delete(data); }
+void operator delete[](void *data, size_t, std::align_val_t) noexcept { global_delete(data); }
+#endif
@@ -1,10 +1,69 @@
 #pragma once
 #include "core/vultr_core.h"
+#include <types/thread.h>
 
 namespace Vultr
 {
 
+#ifndef GAME_MEMORY_GENERAL_SIZE
+	/**
+	 * The size of the general free list allocator of the game memory, which also takes every `new` when the engine is built with `VULTR_GLOBAL_NEW`.
+	 */
+#define GAME_MEMORY_GENERAL_SIZE Megabyte(256)
+#endif
+
+#ifndef THREAD_SAFE_ARENAS
+	/**
+	 * The number of threads that can have their own set of allocators registered with `register_thread_arena` at the same time.
+	 */
 #define THREAD_SAFE_ARENAS 8
+#endif
+
+#ifndef THREAD_ARENA_SCRATCH_SIZE
+	/**
+	 * The size of the scratch linear allocator of every thread arena.
+	 */
+#define THREAD_ARENA_SCRATCH_SIZE Megabyte(16)
+#endif
+
+#ifndef THREAD_ARENA_GENERAL_SIZE
+	/**
+	 * The size of the general free list allocator of every thread arena, which takes every allocation too big for its pool.
+	 */
+#define THREAD_ARENA_GENERAL_SIZE Megabyte(32)
+#endif
+
+#ifndef FRAMES_IN_FLIGHT
+	/**
+	 * The number of frames memory from `frame_alloc` stays valid for, so that the render thread can still read what the simulation wrote in the previous frame.
+	 */
+#define FRAMES_IN_FLIGHT 2
+#endif
+	/**
+	 * Memory freed by a thread that doesn't own it, linked through the freed memory itself until the owner gets around to freeing it.
+	 */
+	struct ThreadArenaDeferredFree
+	{
+		ThreadArenaDeferredFree *next = nullptr;
+	};
+
+	/**
+	 * Allocators owned by a single thread, so that worker threads can allocate without locking or contending with each other.
+	 * Only the owning thread allocates from or frees into these allocators, memory freed by other threads goes through `deferred_frees`.
+	 */
+	struct ThreadArena
+	{
+		LinearAllocator *scratch_storage     = nullptr;
+		PoolAllocator *pool_allocator        = nullptr;
+		FreeListAllocator *general_allocator = nullptr;
+
+		// Lock-free stack of memory freed by other threads, which the owner frees the next time it allocates or calls `collect_thread_arena`.
+		std::atomic<ThreadArenaDeferredFree *> deferred_frees = nullptr;
+
+		// Whether a thread currently owns this arena.
+		atomic_bool registered                                = false;
+	};
+
 	/**
 	 * Holds memory allocators that are used throughout the program.
 	 */
@@ -12,17 +71,101 @@ namespace Vultr
 	{
 		MemoryArena *arena                   = nullptr;
 		LinearAllocator *persistent_storage  = nullptr;
-		LinearAllocator *frame_storage       = nullptr;
+		FrameAllocator *frame_storage        = nullptr;
 		FreeListAllocator *general_allocator = nullptr;
 		PoolAllocator *pool_allocator        = nullptr;
+
+		// When the engine is built with `VULTR_GLOBAL_NEW`, `new` and `delete` on threads without a thread arena go through the general allocator while holding this.
+		// Anything else that uses the general allocator has to hold it as well in that case.
+		vtl::mutex general_allocator_mutex;
+
+		// Carved out of the arena up front, since designating new allocators isn't thread safe.
+		ThreadArena thread_arenas[THREAD_SAFE_ARENAS];
 	};
 
 	extern GameMemory *g_game_memory;
 
+	// The thread arena of the calling thread, nullptr if the thread isn't registered.
+	extern thread_local ThreadArena *g_thread_arena;
+
 	GameMemory *init_game_memory();
 
+	/**
+	 * Destroy the game memory and every allocator in it. If it is the global `g_game_memory`, that is reset to nullptr.
+	 */
 	void destroy_game_memory(GameMemory *m);
 
+	/**
+	 * Give the calling thread its own set of allocators out of the game memory, which are reachable through `g_thread_arena` from then on.
+	 * Any memory that was freed into the arena by other threads since its last owner left is freed first.
+	 *
+	 * @param GameMemory *m: The game memory to take a thread arena from.
+	 *
+	 * @return ThreadArena *: The thread arena of the calling thread.
+	 *
+	 * @error Returns nullptr if all `THREAD_SAFE_ARENAS` thread arenas are taken.
+	 *
+	 * @thread_safe
+	 */
+	ThreadArena *register_thread_arena(GameMemory *m);
+
+	/**
+	 * Give the thread arena of the calling thread back so that another thread can register it. Memory allocated from it stays valid and can still be freed with `thread_free`.
+	 *
+	 * @thread_safe
+	 */
+	void unregister_thread_arena();
+
+	/**
+	 * Allocate memory from the thread arena of the calling thread. Small allocations come from its pool, everything else from its general allocator.
+	 *
+	 * @param size_t size: The size of memory to allocate.
+	 *
+	 * @return void *: The newly allocated memory.
+	 *
+	 * @error This will return nullptr if it failed to allocate, and asserts if the calling thread isn't registered.
+	 *
+	 * @thread_safe
+	 */
+	void *thread_alloc(size_t size);
+
+	/**
+	 * Free memory allocated with `thread_alloc` on any thread. Memory owned by another thread is queued up for that thread to free.
+	 *
+	 * @param void *data: The memory to free.
+	 *
+	 * @thread_safe
+	 */
+	void thread_free(void *data);
+
+	/**
+	 * Free everything other threads queued up for the calling thread with `thread_free`. `thread_alloc` does this on its own, so this is only needed by threads that stop allocating.
+	 *
+	 * @thread_safe
+	 */
+	void collect_thread_arena();
+
+	/**
+	 * Allocate temporary memory from the scratch linear allocator of the calling thread, which is given back all at once with `thread_scratch_reset`.
+	 *
+	 * @param size_t size: The size of memory to allocate.
+	 * @param size_t alignment: The alignment of the memory, must be a power of 2.
+	 *
+	 * @return void *: The newly allocated memory.
+	 *
+	 * @error This will return nullptr if it failed to allocate, and asserts if the calling thread isn't registered.
+	 *
+	 * @thread_safe
+	 */
+	void *thread_scratch_alloc(size_t size, size_t alignment = 16);
+
+	/**
+	 * Free everything allocated with `thread_scratch_alloc` on the calling thread.
+	 *
+	 * @thread_safe
+	 */
+	void thread_scratch_reset();
+
 	typedef void (*UseGameMemoryApi)(GameMemory *m);
 
 	// TODO(Brandon): Update these with actual parameters.
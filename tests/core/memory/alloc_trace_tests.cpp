@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#define private public
+#define protected public
+
+#include <core/memory/vultr_memory.h>
+#include <core/memory/alloc_trace.h>
+#include <stdio.h>
+
+using namespace Vultr;
+
+#ifdef VULTR_ALLOC_TRACE
+TEST(AllocTraceTests, RecordEvents)
+{
+    MemoryArena *arena = init_mem_arena(Megabyte(8));
+    auto *free_list    = init_free_list_allocator(arena, Megabyte(2), 16);
+    auto *pool         = init_pool_allocator(arena, 64, 16);
+    ASSERT_NE(free_list, nullptr);
+    ASSERT_NE(pool, nullptr);
+
+    const char *path = "alloc_trace_test.vtrace";
+    ASSERT_TRUE(alloc_trace_start(path));
+    ASSERT_FALSE(alloc_trace_start(path));
+
+    void *a = malloc(free_list, 100);
+    void *b = malloc(pool, 32);
+    void *c = mrealloc(free_list, a, 400);
+    mfree(pool, b);
+    mfree(free_list, c);
+    alloc_trace_stop();
+
+    // Nothing after the trace is stopped shows up in it.
+    mfree(pool, malloc(pool, 32));
+
+    FILE *f = fopen(path, "rb");
+    ASSERT_NE(f, nullptr);
+    AllocTraceHeader header{};
+    ASSERT_EQ(fread(&header, sizeof(header), 1, f), 1);
+    ASSERT_EQ(header.magic, ALLOC_TRACE_MAGIC);
+    ASSERT_EQ(header.version, ALLOC_TRACE_VERSION);
+
+    AllocTraceEvent events[16];
+    size_t count = fread(events, sizeof(AllocTraceEvent), 16, f);
+    fclose(f);
+    remove(path);
+
+    // Each allocator is announced the first time it is used.
+    ASSERT_EQ(count, 7);
+    ASSERT_EQ(events[0].op, AllocTraceOp::Allocator);
+    ASSERT_EQ(events[0].size, static_cast<u32>(AllocatorType::FreeList));
+    ASSERT_EQ(events[1].op, AllocTraceOp::Alloc);
+    ASSERT_EQ(events[1].allocator, 0);
+    ASSERT_EQ(events[1].address, reinterpret_cast<uintptr_t>(a));
+    ASSERT_EQ(events[1].size, 100);
+    ASSERT_EQ(events[2].op, AllocTraceOp::Allocator);
+    ASSERT_EQ(events[2].size, static_cast<u32>(AllocatorType::Pool));
+    ASSERT_EQ(events[3].op, AllocTraceOp::Alloc);
+    ASSERT_EQ(events[3].allocator, 1);
+    ASSERT_EQ(events[4].op, AllocTraceOp::Realloc);
+    ASSERT_EQ(events[4].address, reinterpret_cast<uintptr_t>(a));
+    ASSERT_EQ(events[4].result, reinterpret_cast<uintptr_t>(c));
+    ASSERT_EQ(events[4].size, 400);
+    ASSERT_EQ(events[5].op, AllocTraceOp::Free);
+    ASSERT_EQ(events[5].address, reinterpret_cast<uintptr_t>(b));
+    ASSERT_EQ(events[6].op, AllocTraceOp::Free);
+    ASSERT_EQ(events[6].address, reinterpret_cast<uintptr_t>(c));
+
+    for (u32 i = 1; i < count; i++)
+    {
+        ASSERT_GE(events[i].timestamp, events[i - 1].timestamp);
+    }
+
+    destroy_mem_arena(arena);
+}
+#else
+TEST(AllocTraceTests, CompiledOut) { ASSERT_FALSE(alloc_trace_start("alloc_trace_test.vtrace")); }
+#endif
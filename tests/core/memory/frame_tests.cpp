@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+#define private public
+#define protected public
+
+#include <core/memory/vultr_memory.h>
+#include <core/memory/frame.h>
+
+using namespace Vultr;
+TEST(FrameTests, Rotate)
+{
+    MemoryArena *arena = init_mem_arena(Kilobyte(512));
+    auto *allocator    = init_frame_allocator(arena, Kilobyte(64), 3);
+    ASSERT_NE(allocator, nullptr);
+
+    ASSERT_EQ(frame_allocator_alloc(allocator, Kilobyte(65)), nullptr);
+    ASSERT_EQ(allocator->stats.failed_allocations, 1);
+
+    u8 *frames[4] = {};
+    for (u32 i = 0; i < 4; i++)
+    {
+        frames[i] = static_cast<u8 *>(frame_allocator_alloc(allocator, Kilobyte(i + 1)));
+        ASSERT_NE(frames[i], nullptr);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(frames[i]) % 16, 0);
+        memset(frames[i], i, Kilobyte(i + 1));
+
+        // Everything allocated in the frames still in flight must be untouched.
+        for (u32 j = (i >= 2 ? i - 2 : 0); j < i; j++)
+        {
+            for (u32 k = 0; k < Kilobyte(j + 1); k++)
+            {
+                ASSERT_EQ(frames[j][k], j);
+            }
+        }
+
+        frame_allocator_rotate(allocator);
+        ASSERT_EQ(allocator->stats.last_frame_used, Kilobyte(i + 1));
+    }
+
+    // The fourth frame reused the buffer of the first one.
+    ASSERT_EQ(frames[3], frames[0]);
+    ASSERT_EQ(allocator->stats.high_water, Kilobyte(4));
+    ASSERT_EQ(allocator->stats.frame_count, 4);
+
+    // Generic allocations go to the current frame.
+    ASSERT_NE(malloc(allocator, 128), nullptr);
+
+    destroy_mem_arena(arena);
+}
@@ -71,3 +71,203 @@ TEST(FreeListTests, AllocRealloc)
 
     destroy_mem_arena(arena);
 }
+
+static void realloc_in_place(FreeListBackend backend)
+{
+    MemoryArena *arena = init_mem_arena(Megabyte(1));
+    auto *allocator    = init_free_list_allocator(arena, Kilobyte(512), 16, backend);
+    ASSERT_NE(allocator, nullptr);
+
+    auto *a = static_cast<u8 *>(free_list_alloc(allocator, Kilobyte(4)));
+    auto *b = static_cast<u8 *>(free_list_alloc(allocator, Kilobyte(4)));
+    auto *c = static_cast<u8 *>(free_list_alloc(allocator, Kilobyte(4)));
+    auto *d = static_cast<u8 *>(free_list_alloc(allocator, Kilobyte(4)));
+    memset(b, 0xB, Kilobyte(4));
+    size_t used = allocator->used;
+
+    // Shrinking gives the tail back without moving.
+    ASSERT_EQ(free_list_realloc(allocator, b, Kilobyte(1)), b);
+    ASSERT_EQ(allocator->used, used - Kilobyte(3));
+    ASSERT_EQ(b[Kilobyte(1) - 1], 0xB);
+
+    // Growing again takes the tail back.
+    ASSERT_EQ(free_list_realloc(allocator, b, Kilobyte(3)), b);
+    ASSERT_EQ(allocator->used, used - Kilobyte(1));
+    ASSERT_EQ(b[Kilobyte(1) - 1], 0xB);
+
+    // With `a` gone there's room before `b`, so it moves down into it.
+    free_list_free(allocator, a);
+    ASSERT_EQ(free_list_realloc(allocator, b, Kilobyte(7)), a);
+    b = a;
+    for (u32 i = 0; i < Kilobyte(1); i++)
+    {
+        ASSERT_EQ(b[i], 0xB);
+    }
+
+    // Without backward expansion, growing `c` into the free tail of `b` isn't allowed so it has to move past `d`.
+    ASSERT_EQ(free_list_realloc(allocator, b, Kilobyte(1)), b);
+    allocator->realloc_expand_backward = false;
+    auto *moved                        = static_cast<u8 *>(free_list_realloc(allocator, c, Kilobyte(8)));
+    ASSERT_GT(moved, d);
+    allocator->realloc_expand_backward = true;
+
+    free_list_free(allocator, b);
+    free_list_free(allocator, d);
+    free_list_free(allocator, moved);
+    ASSERT_EQ(allocator->used, 0);
+
+    // Everything should have coalesced back into a single block spanning the allocator.
+    void *everything = free_list_alloc(allocator, Kilobyte(511));
+    ASSERT_NE(everything, nullptr);
+
+    destroy_mem_arena(arena);
+}
+
+TEST(FreeListTests, ReallocInPlace) { realloc_in_place(FreeListBackend::RedBlackTree); }
+
+TEST(FreeListTests, SegregatedFitReallocInPlace) { realloc_in_place(FreeListBackend::TwoLevelSegregatedFit); }
+
+static void random_trace(FreeListBackend backend)
+{
+    MemoryArena *arena = init_mem_arena(Megabyte(2));
+    auto *allocator    = init_free_list_allocator(arena, Megabyte(1), 16, backend);
+    ASSERT_NE(allocator, nullptr);
+
+    const u32 count = 256;
+    u8 *allocations[count]  = {};
+    size_t sizes[count]     = {};
+
+    srand(1);
+    for (u32 i = 0; i < 20000; i++)
+    {
+        u32 index = rand() % count;
+        if (allocations[index] != nullptr)
+        {
+            // Make sure no other allocation has been handed out overlapping memory.
+            for (size_t j = 0; j < sizes[index]; j++)
+            {
+                ASSERT_EQ(allocations[index][j], static_cast<u8>(index));
+            }
+
+            if (rand() % 3 == 0)
+            {
+                // Whether it grows or shrinks, in place or not, the contents have to come along.
+                size_t kept        = sizes[index];
+                sizes[index]       = 1 + rand() % Kilobyte(2);
+                allocations[index] = static_cast<u8 *>(free_list_realloc(allocator, allocations[index], sizes[index]));
+                ASSERT_NE(allocations[index], nullptr);
+                for (size_t j = 0; j < MIN(kept, sizes[index]); j++)
+                {
+                    ASSERT_EQ(allocations[index][j], static_cast<u8>(index));
+                }
+                memset(allocations[index], index, sizes[index]);
+            }
+            else
+            {
+                free_list_free(allocator, allocations[index]);
+                allocations[index] = nullptr;
+            }
+        }
+        else
+        {
+            sizes[index]       = 1 + rand() % Kilobyte(2);
+            allocations[index] = static_cast<u8 *>(free_list_alloc(allocator, sizes[index]));
+            ASSERT_NE(allocations[index], nullptr);
+            memset(allocations[index], index, sizes[index]);
+        }
+    }
+
+    for (auto *data : allocations)
+    {
+        if (data != nullptr)
+        {
+            free_list_free(allocator, data);
+        }
+    }
+
+    // Everything should have coalesced back into a single block spanning the allocator.
+    void *everything = free_list_alloc(allocator, Megabyte(1) - Kilobyte(1));
+    ASSERT_NE(everything, nullptr);
+    free_list_free(allocator, everything);
+
+    destroy_mem_arena(arena);
+}
+
+TEST(FreeListTests, RandomTrace) { random_trace(FreeListBackend::RedBlackTree); }
+
+TEST(FreeListTests, SegregatedFitRandomTrace) { random_trace(FreeListBackend::TwoLevelSegregatedFit); }
+
+TEST(FreeListTests, Trim)
+{
+    MemoryArena *arena = init_mem_arena(Megabyte(64));
+    auto *allocator    = init_free_list_allocator(arena, Megabyte(32), 16);
+    ASSERT_NE(allocator, nullptr);
+
+    // Nothing has been touched yet, but trimming a fresh allocator is still fine.
+    ASSERT_GT(free_list_trim(allocator), Megabyte(31));
+
+    void *small = free_list_alloc(allocator, 64);
+    auto *large = static_cast<u8 *>(free_list_alloc(allocator, Megabyte(16)));
+    ASSERT_NE(large, nullptr);
+    memset(small, 1, 64);
+    memset(large, 1, Megabyte(16));
+    free_list_free(allocator, large);
+
+    // The pages in the middle of the free block are given back and read back as zeroes, the small allocation before it is untouched.
+    ASSERT_GT(free_list_trim(allocator), Megabyte(31));
+    large = static_cast<u8 *>(free_list_alloc(allocator, Megabyte(16)));
+    ASSERT_EQ(large[Megabyte(8)], 0);
+    ASSERT_EQ(static_cast<u8 *>(small)[63], 1);
+    memset(large, 1, Megabyte(16));
+
+    // With a threshold, large frees are trimmed automatically.
+    allocator->trim_threshold = Megabyte(1);
+    free_list_free(allocator, large);
+    large = static_cast<u8 *>(free_list_alloc(allocator, Megabyte(16)));
+    ASSERT_EQ(large[Megabyte(8)], 0);
+    memset(large, 1, Megabyte(16));
+
+    // So is the tail that shrinking with realloc gives back.
+    ASSERT_EQ(free_list_realloc(allocator, large, Kilobyte(64)), large);
+    ASSERT_EQ(free_list_realloc(allocator, large, Megabyte(16)), large);
+    ASSERT_EQ(large[Megabyte(8)], 0);
+    ASSERT_EQ(large[Kilobyte(64) - 1], 1);
+    free_list_free(allocator, large);
+    free_list_free(allocator, small);
+
+    destroy_mem_arena(arena);
+}
+
+TEST(FreeListTests, ReservedArena)
+{
+    // Reserving a huge arena should be free, memory is only committed as blocks are handed out further into the allocator.
+    MemoryArena *arena = init_mem_arena(Gigabyte(64), 16, MEM_ARENA_RESERVE_ONLY);
+    ASSERT_NE(arena, nullptr);
+
+    auto *allocator = init_free_list_allocator(arena, Gigabyte(32), 16, FreeListBackend::TwoLevelSegregatedFit);
+    ASSERT_NE(allocator, nullptr);
+    size_t committed = allocator->committed;
+    ASSERT_LT(committed, Kilobyte(1));
+
+    auto *small = static_cast<u8 *>(free_list_alloc(allocator, 100));
+    ASSERT_NE(small, nullptr);
+    memset(small, 1, 100);
+    ASSERT_EQ(allocator->committed, MEM_ARENA_COMMIT_SIZE + committed);
+
+    // Growing in place commits the memory it grows into.
+    auto *large = static_cast<u8 *>(free_list_alloc(allocator, Megabyte(1)));
+    ASSERT_NE(large, nullptr);
+    large = static_cast<u8 *>(free_list_realloc(allocator, large, Megabyte(4)));
+    ASSERT_NE(large, nullptr);
+    memset(large, 2, Megabyte(4));
+    ASSERT_LT(allocator->committed, Megabyte(5));
+
+    for (u32 i = 0; i < 100; i++)
+    {
+        ASSERT_EQ(small[i], 1);
+    }
+
+    free_list_free(allocator, large);
+    free_list_free(allocator, small);
+    destroy_mem_arena(arena);
+}
@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+#define private public
+#define protected public
+
+#include <core/memory/vultr_memory.h>
+#include <core/memory/heap_profiler.h>
+#include <core/memory/allocator_policy.h>
+#include <stdio.h>
+
+using namespace Vultr;
+
+#ifdef VULTR_HEAP_PROFILER
+#ifdef _WIN32
+#define TEST_NOINLINE __declspec(noinline)
+#else
+#define TEST_NOINLINE __attribute__((noinline))
+#endif
+
+// Not static and not inlined, so that it shows up by name in the dumped stacks.
+TEST_NOINLINE void *heap_profiler_test_site(Allocator *allocator, size_t size) { return malloc(allocator, size); }
+
+TEST(HeapProfilerTests, RecordAndDump)
+{
+    MemoryArena *arena = init_mem_arena(Megabyte(8));
+    auto *allocator    = init_free_list_allocator(arena, Megabyte(4), 16);
+    ASSERT_NE(allocator, nullptr);
+
+    // Sample every allocation so that the totals are exact.
+    ASSERT_TRUE(heap_profiler_init(1));
+    ASSERT_FALSE(heap_profiler_init(1));
+
+    void *blocks[64];
+    for (auto &block : blocks)
+    {
+        block = heap_profiler_test_site(allocator, 100);
+        ASSERT_NE(block, nullptr);
+    }
+    for (u32 i = 0; i < 32; i++)
+    {
+        mfree(allocator, blocks[i]);
+    }
+
+    HeapProfilerTotals totals{};
+    heap_profiler_get_totals(&totals);
+    ASSERT_EQ(totals.total_count, 64);
+    ASSERT_EQ(totals.total_bytes, 64 * 100);
+    ASSERT_EQ(totals.live_count, 32);
+    ASSERT_EQ(totals.live_bytes, 32 * 100);
+
+    // Reallocating moves the live bytes over to the new size.
+    blocks[32] = mrealloc(allocator, blocks[32], 300);
+    heap_profiler_get_totals(&totals);
+    ASSERT_EQ(totals.live_bytes, 31 * 100 + 300);
+
+    const char *path = "heap_profiler_test.prof";
+    ASSERT_TRUE(heap_profiler_dump_pprof(path));
+    FILE *f = fopen(path, "r");
+    char line[256];
+    ASSERT_NE(fgets(line, sizeof(line), f), nullptr);
+    ASSERT_EQ(strncmp(line, "heap profile: 32: 3400 [65: 6700] @ heapprofile", 47), 0);
+    fclose(f);
+
+    ASSERT_TRUE(heap_profiler_dump_collapsed(path));
+    f                = fopen(path, "r");
+    bool found_site  = false;
+    char buffer[8192];
+    while (fgets(buffer, sizeof(buffer), f) != nullptr)
+    {
+        found_site |= strstr(buffer, "heap_profiler_test_site") != nullptr && strstr(buffer, " 3100\n") != nullptr;
+    }
+    fclose(f);
+    remove(path);
+    ASSERT_TRUE(found_site);
+
+    // The old block is still alive after a failed realloc, so it stays recorded.
+    ASSERT_EQ(mrealloc(allocator, blocks[33], Megabyte(8)), nullptr);
+    heap_profiler_get_totals(&totals);
+    ASSERT_EQ(totals.live_count, 32);
+
+    heap_profiler_destroy();
+
+    // Frees of memory that was sampled before the profiler was stopped are ignored.
+    for (u32 i = 33; i < 64; i++)
+    {
+        mfree(allocator, blocks[i]);
+    }
+    mfree(allocator, blocks[32]);
+    heap_profiler_get_totals(&totals);
+    ASSERT_EQ(totals.total_count, 0);
+
+    destroy_mem_arena(arena);
+}
+
+TEST(HeapProfilerTests, Sampling)
+{
+    MemoryArena *arena = init_mem_arena(Megabyte(8));
+    auto *allocator    = init_pool_allocator(arena, 64, 1024);
+    ASSERT_NE(allocator, nullptr);
+
+    ASSERT_TRUE(heap_profiler_init(16));
+    for (u32 i = 0; i < 100000; i++)
+    {
+        mfree(allocator, malloc(allocator, 64));
+    }
+
+    // Every sample stands in for 16 allocations, so the estimate should be close to the real count.
+    HeapProfilerTotals totals{};
+    heap_profiler_get_totals(&totals);
+    ASSERT_GT(totals.total_count, 90000);
+    ASSERT_LT(totals.total_count, 110000);
+    ASSERT_EQ(totals.live_count, 0);
+    heap_profiler_destroy();
+
+    destroy_mem_arena(arena);
+}
+
+TEST(HeapProfilerTests, FailedReallocKeepsSample)
+{
+    MemoryArena *arena = init_mem_arena(Megabyte(8));
+    auto *allocator    = init_free_list_allocator(arena, Megabyte(1), 16);
+    ASSERT_NE(allocator, nullptr);
+
+    // Sample the block, then hardly anything after it so that sampling it again would almost never happen.
+    ASSERT_TRUE(heap_profiler_init(1));
+    void *block = heap_profiler_test_site(allocator, 100);
+    heap_profiler_set_sample_rate(1 << 20);
+    void *other = malloc(allocator, 16);
+
+    HeapProfilerTotals before{};
+    heap_profiler_get_totals(&before);
+
+    // The block is still alive after a failed realloc, so its sample is put back as it was and nothing is counted twice.
+    ASSERT_EQ(mrealloc(allocator, block, Megabyte(2)), nullptr);
+    HeapProfilerTotals after{};
+    heap_profiler_get_totals(&after);
+    ASSERT_EQ(after.live_count, before.live_count);
+    ASSERT_EQ(after.live_bytes, before.live_bytes);
+    ASSERT_EQ(after.total_count, before.total_count);
+    ASSERT_EQ(after.total_bytes, before.total_bytes);
+
+    // And it is still found when it is freed.
+    mfree(allocator, block);
+    heap_profiler_get_totals(&after);
+    ASSERT_EQ(after.live_bytes, before.live_bytes - 100);
+
+    mfree(allocator, other);
+    heap_profiler_destroy();
+    destroy_mem_arena(arena);
+}
+
+TEST(HeapProfilerTests, FailedPolicyReallocKeepsSample)
+{
+    MemoryArena *arena = init_mem_arena(Megabyte(8));
+    auto *allocator    = init_free_list_allocator(arena, Megabyte(1), 16);
+    ASSERT_NE(allocator, nullptr);
+    FreeListPolicy policy(allocator);
+
+    ASSERT_TRUE(heap_profiler_init(1));
+    void *block = policy.alloc(100);
+    heap_profiler_set_sample_rate(1 << 20);
+    void *other = policy.alloc(16);
+
+    HeapProfilerTotals before{};
+    heap_profiler_get_totals(&before);
+
+    // The old size passed in by the container doesn't matter, the sample comes back with the size it was taken with.
+    ASSERT_EQ(policy.realloc(block, 0, Megabyte(2)), nullptr);
+    HeapProfilerTotals after{};
+    heap_profiler_get_totals(&after);
+    ASSERT_EQ(after.live_count, before.live_count);
+    ASSERT_EQ(after.live_bytes, before.live_bytes);
+    ASSERT_EQ(after.total_count, before.total_count);
+    ASSERT_EQ(after.total_bytes, before.total_bytes);
+
+    policy.free(block);
+    heap_profiler_get_totals(&after);
+    ASSERT_EQ(after.live_bytes, before.live_bytes - 100);
+
+    policy.free(other);
+    heap_profiler_destroy();
+    destroy_mem_arena(arena);
+}
+#else
+TEST(HeapProfilerTests, CompiledOut) { ASSERT_FALSE(heap_profiler_init()); }
+#endif
@@ -4,6 +4,8 @@
 
 #include <core/memory/vultr_memory.h>
 #include <core/memory/linear.h>
+#include <thread>
+#include <vector>
 
 using namespace Vultr;
 TEST(LinearTests, AllocFree)
@@ -32,3 +34,82 @@ TEST(LinearTests, AllocFree)
 
     destroy_mem_arena(arena);
 }
+
+TEST(LinearTests, ReservedArena)
+{
+    // Reserving a huge arena should be free, memory is only committed as the allocator grows.
+    MemoryArena *arena = init_mem_arena(Gigabyte(64), 16, MEM_ARENA_RESERVE_ONLY);
+    ASSERT_NE(arena, nullptr);
+
+    auto *allocator = init_linear_allocator(arena, Gigabyte(32));
+    ASSERT_NE(allocator, nullptr);
+    ASSERT_EQ(allocator->committed, 0);
+
+    auto *small = static_cast<u8 *>(linear_alloc(allocator, 100));
+    ASSERT_NE(small, nullptr);
+    memset(small, 1, 100);
+    ASSERT_EQ(allocator->committed, LINEAR_ALLOCATOR_COMMIT_SIZE);
+
+    auto *large = static_cast<u8 *>(linear_alloc(allocator, Megabyte(1)));
+    ASSERT_NE(large, nullptr);
+    memset(large, 2, Megabyte(1));
+    ASSERT_EQ(allocator->committed, Megabyte(1) + 100);
+
+    for (u32 i = 0; i < 100; i++)
+    {
+        ASSERT_EQ(small[i], 1);
+    }
+
+    destroy_mem_arena(arena);
+}
+
+TEST(LinearTests, Concurrent)
+{
+    MemoryArena *arena = init_mem_arena(Gigabyte(1), 16, MEM_ARENA_RESERVE_ONLY);
+    auto *allocator    = init_linear_allocator(arena, Megabyte(64), true);
+    ASSERT_NE(allocator, nullptr);
+
+    const u32 thread_count = 8;
+    const u32 count        = 4096;
+    std::vector<std::pair<u8 *, size_t>> allocations[thread_count];
+    std::vector<std::thread> threads;
+    for (u32 t = 0; t < thread_count; t++)
+    {
+        threads.emplace_back([&, t]() {
+            for (u32 i = 0; i < count; i++)
+            {
+                size_t size      = (i * 7 + t) % 200 + 1;
+                size_t alignment = i % 16 == 0 ? 64 : 16;
+                auto *data       = static_cast<u8 *>(linear_alloc(allocator, size, alignment));
+                ASSERT_NE(data, nullptr);
+                ASSERT_EQ(reinterpret_cast<uintptr_t>(data) % alignment, 0);
+                memset(data, t, size);
+                allocations[t].push_back({data, size});
+            }
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    // No two threads were handed the same memory.
+    for (u32 t = 0; t < thread_count; t++)
+    {
+        for (auto [data, size] : allocations[t])
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                ASSERT_EQ(data[i], t);
+            }
+        }
+    }
+
+    // Running out of space fails without handing out memory past the end, and freeing makes all of it available again.
+    ASSERT_EQ(linear_alloc(allocator, Megabyte(64)), nullptr);
+    linear_free(allocator);
+    ASSERT_NE(linear_alloc(allocator, Megabyte(64)), nullptr);
+    ASSERT_EQ(linear_alloc(allocator, 1), nullptr);
+
+    destroy_mem_arena(arena);
+}
@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+#include <core/memory/memory_resource.h>
+#include <vector>
+
+using namespace Vultr;
+
+template <typename Resource>
+static void fill_vector(Resource *resource, Allocator *allocator)
+{
+    std::pmr::vector<u64> values(resource);
+    for (u64 i = 0; i < 1000; i++)
+    {
+        values.push_back(i);
+    }
+
+    // The elements live in the allocator the resource wraps, not the system heap.
+    ASSERT_EQ(find_allocator(values.data()), allocator);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(values.data()) % alignof(u64), 0);
+    for (u64 i = 0; i < 1000; i++)
+    {
+        ASSERT_EQ(values[i], i);
+    }
+}
+
+TEST(MemoryResourceTests, Containers)
+{
+    MemoryArena *arena = init_mem_arena(Megabyte(64));
+
+    auto *linear       = init_linear_allocator(arena, Megabyte(1));
+    LinearResource linear_resource(linear);
+    linear_alloc(linear, 3);
+    fill_vector(&linear_resource, linear);
+
+    PoolRegion regions[] = {{.size = 64, .count = 16}, {.size = Kilobyte(1), .count = 16}, {.size = Kilobyte(16), .count = 16}};
+    auto *pool           = init_pool_allocator(arena, regions, 3);
+    PoolResource pool_resource(pool);
+    fill_vector(&pool_resource, pool);
+
+    auto *free_list = init_free_list_allocator(arena, Megabyte(1), 16);
+    FreeListResource free_list_resource(free_list);
+    fill_vector(&free_list_resource, free_list);
+
+    auto *frame = init_frame_allocator(arena, Megabyte(1), 2);
+    FrameResource frame_resource(frame);
+    fill_vector(&frame_resource, frame);
+
+    // Everything freed by the containers went back to the allocators that free.
+    AllocatorStats stats;
+    get_allocator_stats(pool, &stats);
+    ASSERT_EQ(stats.bytes_in_use, 0);
+    get_allocator_stats(free_list, &stats);
+    ASSERT_EQ(stats.bytes_in_use, 0);
+
+    ASSERT_TRUE(pool_resource.is_equal(PoolResource(pool)));
+    ASSERT_FALSE(pool_resource.is_equal(free_list_resource));
+
+    destroy_mem_arena(arena);
+}
@@ -4,6 +4,7 @@
 
 #include <core/memory/vultr_memory.h>
 #include <core/memory/pool.h>
+#include <thread>
 
 using namespace Vultr;
 
@@ -62,3 +63,161 @@ TEST(PoolTests, AllocRealloc)
 
     destroy_mem_arena(arena);
 }
+
+TEST(PoolTests, ThreadCache)
+{
+    MemoryArena *arena   = init_mem_arena(Megabyte(1));
+    PoolRegion regions[] = {{.size = 64, .count = 1000}, {.size = 256, .count = 1000}};
+    auto *allocator      = init_pool_allocator(arena, regions, 2);
+
+    ASSERT_NE(allocator, nullptr);
+
+    const u32 thread_count = 4;
+    std::thread threads[thread_count];
+    for (u32 t = 0; t < thread_count; t++)
+    {
+        threads[t] = std::thread([allocator, t]() {
+            const u32 count = 100;
+            byte *blocks[count];
+            for (u32 round = 0; round < 100; round++)
+            {
+                for (u32 i = 0; i < count; i++)
+                {
+                    size_t size = i % 2 == 0 ? 64 : 200;
+                    blocks[i]   = static_cast<byte *>(pool_cached_alloc(allocator, size));
+                    ASSERT_NE(blocks[i], nullptr);
+                    memset(blocks[i], t, size);
+                }
+
+                // No other thread should have been handed the same blocks.
+                for (u32 i = 0; i < count; i++)
+                {
+                    size_t size = i % 2 == 0 ? 64 : 200;
+                    for (size_t j = 0; j < size; j++)
+                    {
+                        ASSERT_EQ(blocks[i][j], t);
+                    }
+                    pool_cached_free(allocator, blocks[i]);
+                }
+            }
+            pool_cached_flush(allocator);
+        });
+    }
+
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    // Every block should have made it back to the shared pool once the threads flushed their caches.
+    for (u32 i = 0; i < 2000; i++)
+    {
+        ASSERT_NE(pool_alloc(allocator, 64), nullptr);
+    }
+    ASSERT_EQ(pool_alloc(allocator, 64), nullptr);
+
+    destroy_mem_arena(arena);
+}
+
+TEST(PoolTests, ConcurrentStress)
+{
+    MemoryArena *arena   = init_mem_arena(Megabyte(1));
+    PoolRegion regions[] = {{.size = 32, .count = 512}, {.size = 128, .count = 512}};
+    auto *allocator      = init_pool_allocator(arena, regions, 2, true);
+
+    ASSERT_NE(allocator, nullptr);
+
+    const u32 thread_count = 4;
+    std::thread threads[thread_count];
+    for (u32 t = 0; t < thread_count; t++)
+    {
+        threads[t] = std::thread([allocator, t]() {
+            // Each live block is stamped with its owner and a serial number, if another thread is ever handed the same block the stamp gets overwritten.
+            struct Stamp
+            {
+                u64 owner;
+                u64 serial;
+            };
+
+            const u32 live_count    = 64;
+            Stamp *live[live_count] = {};
+            u64 serials[live_count] = {};
+
+            for (u32 i = 0; i < 500000; i++)
+            {
+                u32 index = (i * 7919) % live_count;
+                if (live[index] != nullptr)
+                {
+                    ASSERT_EQ(live[index]->owner, t);
+                    ASSERT_EQ(live[index]->serial, serials[index]);
+                    pool_free(allocator, live[index]);
+                    live[index] = nullptr;
+                }
+
+                // Interleave both segments, the larger one also catches fallbacks from the smaller one running dry.
+                auto *stamp = static_cast<Stamp *>(pool_alloc(allocator, i % 3 == 0 ? 100 : 16));
+                ASSERT_NE(stamp, nullptr);
+                stamp->owner   = t;
+                stamp->serial  = i;
+                serials[index] = i;
+                live[index]    = stamp;
+            }
+
+            for (auto *stamp : live)
+            {
+                if (stamp != nullptr)
+                {
+                    pool_free(allocator, stamp);
+                }
+            }
+        });
+    }
+
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    // Every block should be back in the pool exactly once.
+    for (u32 i = 0; i < 1024; i++)
+    {
+        ASSERT_NE(pool_alloc(allocator, 16), nullptr);
+    }
+    ASSERT_EQ(pool_alloc(allocator, 16), nullptr);
+
+    destroy_mem_arena(arena);
+}
+
+TEST(PoolTests, UnsortedRegions)
+{
+    MemoryArena *arena   = init_mem_arena(Kilobyte(512));
+    PoolRegion regions[] = {{.size = 256, .count = 2}, {.size = 64, .count = 2}, {.size = 100, .count = 2}};
+    auto *allocator      = init_pool_allocator(arena, regions, 3);
+
+    ASSERT_NE(allocator, nullptr);
+
+    // Allocations go to the smallest region that fits and fall back to larger ones when it runs out.
+    void *small[6];
+    for (auto &data : small)
+    {
+        data = pool_alloc(allocator, 60);
+        ASSERT_NE(data, nullptr);
+    }
+    ASSERT_EQ(pool_alloc(allocator, 1), nullptr);
+    ASSERT_LT(small[1], small[2]);
+    ASSERT_LT(small[3], small[4]);
+
+    // A 64 byte block has to move to fit 100 bytes, a 100 byte block doesn't.
+    pool_free(allocator, small[2]);
+    void *moved = pool_realloc(allocator, small[0], 100);
+    ASSERT_EQ(moved, small[2]);
+    ASSERT_EQ(pool_realloc(allocator, moved, 100), moved);
+
+    // Frees are routed back to the segment the block came from.
+    pool_free(allocator, moved);
+    pool_free(allocator, small[5]);
+    ASSERT_EQ(pool_alloc(allocator, 200), small[5]);
+    ASSERT_EQ(pool_alloc(allocator, 64), small[0]);
+
+    destroy_mem_arena(arena);
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#define private public
+#define protected public
+
+#include <core/memory/vultr_memory.h>
+#include <core/memory/stack.h>
+
+using namespace Vultr;
+TEST(StackTests, AllocFree)
+{
+    MemoryArena *arena = init_mem_arena(Kilobyte(512));
+    auto *allocator    = init_stack_allocator(arena, Kilobyte(256));
+
+    ASSERT_NE(allocator, nullptr);
+
+    ASSERT_EQ(stack_alloc(allocator, Megabyte(1)), nullptr);
+
+    const u32 count = 10;
+    void *allocations[count];
+
+    for (u32 i = 0; i < count; i++)
+    {
+        size_t alignment = 8 << (i % 4);
+        allocations[i]   = stack_alloc(allocator, (i + 32) << 3, alignment);
+        ASSERT_NE(allocations[i], nullptr);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(allocations[i]) % alignment, 0);
+        memset(allocations[i], i, (i + 32) << 3);
+    }
+
+    for (s32 i = count - 1; i >= 0; i--)
+    {
+        auto *data = static_cast<u8 *>(allocations[i]);
+        for (s32 j = 0; j < (i + 32) << 3; j++)
+        {
+            ASSERT_EQ(data[j], i);
+        }
+        stack_free(allocator, allocations[i]);
+    }
+
+    ASSERT_EQ(allocator->used, 0);
+
+    // Popping everything should let the same memory be handed out again.
+    ASSERT_EQ(stack_alloc(allocator, 256), allocations[0]);
+    stack_clear(allocator);
+    ASSERT_EQ(allocator->used, 0);
+
+    destroy_mem_arena(arena);
+}
+
+TEST(StackTests, Markers)
+{
+    MemoryArena *arena = init_mem_arena(Kilobyte(512));
+    auto *allocator    = init_stack_allocator(arena, Kilobyte(256));
+    ASSERT_NE(allocator, nullptr);
+
+    void *persistent = stack_alloc(allocator, 64);
+    ASSERT_NE(persistent, nullptr);
+    size_t used = allocator->used;
+
+    {
+        ScopedStackMarker outer(allocator);
+        ASSERT_NE(stack_alloc(allocator, Kilobyte(1)), nullptr);
+
+        void *inner_data = nullptr;
+        {
+            ScopedStackMarker inner(allocator);
+            inner_data = stack_alloc(allocator, Kilobyte(2));
+            ASSERT_NE(inner_data, nullptr);
+            ASSERT_NE(stack_alloc(allocator, Kilobyte(4)), nullptr);
+        }
+
+        // The inner scope was rewound, so the next allocation reuses its memory.
+        ASSERT_EQ(stack_alloc(allocator, Kilobyte(2)), inner_data);
+    }
+
+    ASSERT_EQ(allocator->used, used);
+    ASSERT_EQ(allocator->top, persistent);
+
+    // The allocation from before the markers can still be popped through the generic interface.
+    mfree(allocator, persistent);
+    ASSERT_EQ(allocator->used, 0);
+
+    void *data = malloc(allocator, 128);
+    ASSERT_NE(data, nullptr);
+    mfree(allocator, data);
+    ASSERT_EQ(allocator->used, 0);
+
+    destroy_mem_arena(arena);
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include <vultr.h>
+#include <latch>
+#include <thread>
+#include <vector>
+
+using namespace Vultr;
+
+TEST(ThreadArenaTests, RegisterAllocFree)
+{
+    g_game_memory = init_game_memory();
+    ASSERT_EQ(g_thread_arena, nullptr);
+
+    auto *main_arena = register_thread_arena(g_game_memory);
+    ASSERT_NE(main_arena, nullptr);
+    ASSERT_EQ(g_thread_arena, main_arena);
+
+    void *small = thread_alloc(32);
+    void *large = thread_alloc(Kilobyte(64));
+    ASSERT_EQ(find_allocator(small), main_arena->pool_allocator);
+    ASSERT_EQ(find_allocator(large), main_arena->general_allocator);
+
+    auto *scratch = thread_scratch_alloc(100, 64);
+    ASSERT_NE(scratch, nullptr);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(scratch) % 64, 0);
+    thread_scratch_reset();
+
+    thread_free(small);
+    thread_free(large);
+
+    // Every other thread arena can be taken, and then there are none left.
+    // The vector is scoped since with `VULTR_GLOBAL_NEW` it lives in the game memory, which it must not outlive.
+    {
+        std::vector<ThreadArena *> taken;
+        std::thread([&]() {
+            for (u32 i = 1; i < THREAD_SAFE_ARENAS; i++)
+            {
+                g_thread_arena = nullptr;
+                taken.push_back(register_thread_arena(g_game_memory));
+            }
+            g_thread_arena = nullptr;
+            taken.push_back(register_thread_arena(g_game_memory));
+        }).join();
+        for (u32 i = 0; i < THREAD_SAFE_ARENAS - 1; i++)
+        {
+            ASSERT_NE(taken[i], nullptr);
+            ASSERT_NE(taken[i], main_arena);
+            taken[i]->registered = false;
+        }
+        ASSERT_EQ(taken.back(), nullptr);
+    }
+
+    unregister_thread_arena();
+    ASSERT_EQ(g_thread_arena, nullptr);
+    destroy_game_memory(g_game_memory);
+    g_game_memory = nullptr;
+}
+
+TEST(ThreadArenaTests, CrossThreadFree)
+{
+    g_game_memory    = init_game_memory();
+    auto *main_arena = register_thread_arena(g_game_memory);
+
+    // Scoped since with `VULTR_GLOBAL_NEW` the vectors live in the game memory, which they must not outlive.
+    {
+        // Workers allocate from their own arenas and hand the memory to the main thread, which frees it back to them.
+        const u32 worker_count = 4;
+        const u32 count        = 500;
+        std::vector<void *> allocations[worker_count];
+        std::vector<std::thread> workers;
+        std::latch registered(worker_count);
+        for (u32 w = 0; w < worker_count; w++)
+        {
+            workers.emplace_back([&, w]() {
+                register_thread_arena(g_game_memory);
+                for (u32 i = 0; i < count; i++)
+                {
+                    allocations[w].push_back(thread_alloc(i % 2 == 0 ? 48 : Kilobyte(4)));
+                }
+
+                // Every worker holds on to its arena until all of them have one, so they can't end up sharing one.
+                registered.arrive_and_wait();
+                unregister_thread_arena();
+            });
+        }
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+
+        for (auto &worker_allocations : allocations)
+        {
+            for (void *data : worker_allocations)
+            {
+                ASSERT_NE(data, nullptr);
+                thread_free(data);
+            }
+        }
+
+        // Nothing is freed until a thread takes the arenas again.
+        // The arena of the main thread is skipped, with `VULTR_GLOBAL_NEW` the workers free the thread state it allocated for them into it.
+        u32 pending = 0;
+        for (auto &thread_arena : g_game_memory->thread_arenas)
+        {
+            if (&thread_arena == main_arena)
+                continue;
+            ASSERT_EQ(thread_arena.deferred_frees != nullptr, pending++ < worker_count);
+        }
+
+        std::thread([&]() {
+            for (u32 w = 0; w < worker_count; w++)
+            {
+                auto *thread_arena = register_thread_arena(g_game_memory);
+                ASSERT_EQ(thread_arena->deferred_frees, nullptr);
+
+                AllocatorStats stats;
+                get_allocator_stats(thread_arena->pool_allocator, &stats);
+                ASSERT_EQ(stats.bytes_in_use, 0);
+                g_thread_arena = nullptr;
+            }
+        }).join();
+    }
+
+    unregister_thread_arena();
+    destroy_game_memory(g_game_memory);
+    g_game_memory = nullptr;
+}
@@ -3,6 +3,7 @@
 #define protected public
 
 #include <core/memory/vultr_memory.h>
+#include <types/dynamic_array.h>
 
 using namespace Vultr;
 TEST(MemoryArena, InitMemArena)
@@ -14,3 +15,317 @@ TEST(MemoryArena, InitMemArena)
     arena = init_mem_arena(Terabyte(10));
     ASSERT_EQ(arena, nullptr);
 }
+
+TEST(MemoryArena, DesignateDoesNotOverlap)
+{
+    MemoryArena *arena = init_mem_arena(Kilobyte(64));
+    ASSERT_NE(arena, nullptr);
+
+    auto *first  = static_cast<byte *>(mem_arena_designate(arena, AllocatorType::Linear, Kilobyte(16)));
+    auto *second = static_cast<byte *>(mem_arena_designate(arena, AllocatorType::Linear, Kilobyte(16)));
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(second, nullptr);
+    ASSERT_GE(second, first + Kilobyte(16));
+
+    ASSERT_EQ(mem_arena_designate(arena, AllocatorType::Linear, Kilobyte(64)), nullptr);
+
+    destroy_mem_arena(arena);
+}
+
+TEST(MemoryArena, FindAllocator)
+{
+    MemoryArena *arena = init_mem_arena(Megabyte(8), 64);
+    ASSERT_NE(arena, nullptr);
+
+    // More allocators than there used to be room for.
+    PoolAllocator *pools[40];
+    for (auto &pool : pools)
+    {
+        pool = init_pool_allocator(arena, 64, 16);
+        ASSERT_NE(pool, nullptr);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(pool) % 64, 0);
+    }
+    FreeListAllocator *free_list = init_free_list_allocator(arena, Megabyte(1), 16);
+
+    for (auto *pool : pools)
+    {
+        void *data = pool_alloc(pool, 32);
+        ASSERT_EQ(mem_arena_get_allocator(arena, data), pool);
+        ASSERT_EQ(find_allocator(data), pool);
+    }
+    void *data = free_list_alloc(free_list, 100);
+    ASSERT_EQ(find_mem_arena(data), arena);
+    ASSERT_EQ(find_allocator(data), free_list);
+    ASSERT_EQ(find_allocator(arena), nullptr);
+
+    int not_in_an_arena;
+    ASSERT_EQ(find_mem_arena(&not_in_an_arena), nullptr);
+    ASSERT_EQ(find_allocator(&not_in_an_arena), nullptr);
+
+    // Memory can be freed without knowing where it came from.
+    Vultr::free(data);
+    Vultr::free(nullptr);
+    AllocatorStats stats{};
+    get_allocator_stats(free_list, &stats);
+    ASSERT_EQ(stats.bytes_in_use, 0);
+
+    // Arenas are found regardless of the order they were created and destroyed in.
+    MemoryArena *other = init_mem_arena(Megabyte(1));
+    auto *linear       = init_linear_allocator(other, Kilobyte(64));
+    void *other_data   = linear_alloc(linear, 16);
+    ASSERT_EQ(find_mem_arena(other_data), other);
+    ASSERT_EQ(find_allocator(other_data), linear);
+
+    destroy_mem_arena(arena);
+    ASSERT_EQ(find_mem_arena(data), nullptr);
+    ASSERT_EQ(find_allocator(other_data), linear);
+
+    destroy_mem_arena(other);
+    ASSERT_EQ(find_mem_arena(other_data), nullptr);
+}
+
+TEST(MemoryArena, CommitDecommit)
+{
+    MemoryArena *arena = init_mem_arena(Megabyte(16), 16, MEM_ARENA_RESERVE_ONLY);
+    ASSERT_NE(arena, nullptr);
+
+    auto *chunk = static_cast<u8 *>(mem_arena_designate(arena, AllocatorType::Linear, Megabyte(8), 0));
+    ASSERT_NE(chunk, nullptr);
+
+    ASSERT_TRUE(mem_arena_commit(arena, chunk, Megabyte(1)));
+    memset(chunk, 0xAB, Megabyte(1));
+
+    // Decommitting and committing again hands back zeroed memory.
+    mem_arena_decommit(arena, chunk, Megabyte(1));
+    ASSERT_TRUE(mem_arena_commit(arena, chunk, Megabyte(1)));
+    ASSERT_EQ(chunk[Kilobyte(512)], 0);
+
+    destroy_mem_arena(arena);
+}
+
+TEST(MemoryArena, FixedAddress)
+{
+    MemoryArena *arena = init_mem_arena(Megabyte(4));
+    ASSERT_NE(arena, nullptr);
+    void *base = arena->memory;
+
+    // The address is taken, and a fixed arena never replaces what is already there.
+    ASSERT_EQ(init_mem_arena(Megabyte(4), 16, MEM_ARENA_DEFAULT, base), nullptr);
+
+    destroy_mem_arena(arena);
+    arena = init_mem_arena(Megabyte(4), 16, MEM_ARENA_DEFAULT, base);
+    ASSERT_NE(arena, nullptr);
+    ASSERT_EQ(static_cast<void *>(arena->memory), base);
+    destroy_mem_arena(arena);
+}
+
+TEST(MemoryArena, SnapshotRestore)
+{
+    for (u16 flags : {u16(MEM_ARENA_SNAPSHOTS), u16(MEM_ARENA_SNAPSHOTS | MEM_ARENA_RESERVE_ONLY)})
+    {
+        MemoryArena *arena = init_mem_arena(Megabyte(16), 16, flags);
+        ASSERT_NE(arena, nullptr);
+        auto *free_list = init_free_list_allocator(arena, Megabyte(4), 16);
+        ASSERT_NE(free_list, nullptr);
+
+        // Restoring an arena that was never snapshotted brings it back to how it was created.
+        auto *linear = init_linear_allocator(arena, Megabyte(1));
+        ASSERT_NE(linear, nullptr);
+        ASSERT_TRUE(mem_arena_restore(arena));
+        ASSERT_EQ(find_allocator(linear), nullptr);
+
+        free_list = init_free_list_allocator(arena, Megabyte(4), 16);
+        ASSERT_NE(free_list, nullptr);
+        auto *kept = static_cast<u32 *>(free_list_alloc(free_list, 1024 * sizeof(u32)));
+        for (u32 i = 0; i < 1024; i++)
+        {
+            kept[i] = i;
+        }
+        auto *freed = static_cast<u32 *>(free_list_alloc(free_list, Kilobyte(64)));
+        AllocatorStats before{};
+        get_allocator_stats(free_list, &before);
+        ASSERT_TRUE(mem_arena_snapshot(arena));
+
+        // Scribble over everything after the snapshot.
+        for (u32 i = 0; i < 1024; i++)
+        {
+            kept[i] = 0xDEADBEEF;
+        }
+        free_list_free(free_list, freed);
+        for (u32 i = 0; i < 16; i++)
+        {
+            memset(free_list_alloc(free_list, Kilobyte(32)), 0xAB, Kilobyte(32));
+        }
+        linear = init_linear_allocator(arena, Megabyte(1));
+        ASSERT_NE(linear, nullptr);
+
+        ASSERT_TRUE(mem_arena_restore(arena));
+        for (u32 i = 0; i < 1024; i++)
+        {
+            ASSERT_EQ(kept[i], i);
+        }
+        AllocatorStats after{};
+        get_allocator_stats(free_list, &after);
+        ASSERT_EQ(after.bytes_in_use, before.bytes_in_use);
+        ASSERT_EQ(after.free_block_count, before.free_block_count);
+        ASSERT_EQ(find_allocator(freed), free_list);
+        ASSERT_EQ(find_allocator(linear), nullptr);
+
+        // The allocators carry on from the snapshot.
+        free_list_free(free_list, freed);
+        ASSERT_NE(free_list_alloc(free_list, Kilobyte(128)), nullptr);
+
+        destroy_mem_arena(arena);
+    }
+
+    // Arenas without snapshots can't be snapshotted.
+    MemoryArena *arena = init_mem_arena(Megabyte(1));
+    ASSERT_FALSE(mem_arena_snapshot(arena));
+    ASSERT_FALSE(mem_arena_restore(arena));
+    destroy_mem_arena(arena);
+}
+
+TEST(MemoryArena, HugePagesPrefault)
+{
+    // Huge pages fall back to transparent huge pages or regular pages, so this should always succeed.
+    MemoryArena *arena = init_mem_arena(Megabyte(8), 16, MEM_ARENA_HUGE_PAGES | MEM_ARENA_PREFAULT);
+    ASSERT_NE(arena, nullptr);
+
+    auto *allocator = init_free_list_allocator(arena, Megabyte(4), 16);
+    ASSERT_NE(allocator, nullptr);
+
+    void *data = free_list_alloc(allocator, Megabyte(1));
+    ASSERT_NE(data, nullptr);
+    memset(data, 1, Megabyte(1));
+
+    destroy_mem_arena(arena);
+}
+
+TEST(MemoryArena, AllocatorStats)
+{
+    MemoryArena *arena      = init_mem_arena(Megabyte(8));
+    MemoryArena *pool_arena = init_mem_arena(Megabyte(1));
+    ASSERT_NE(arena, nullptr);
+    ASSERT_NE(pool_arena, nullptr);
+
+    auto *free_list      = init_free_list_allocator(arena, Megabyte(1), 16);
+    PoolRegion regions[] = {{.size = 64, .count = 8}, {.size = 256, .count = 4}};
+    auto *pool           = init_pool_allocator(pool_arena, regions, 2);
+    ASSERT_NE(free_list, nullptr);
+    ASSERT_NE(pool, nullptr);
+
+    // Freeing every other block leaves holes that are too small to hold all of the free memory at once.
+    void *blocks[8];
+    for (auto &block : blocks)
+    {
+        block = malloc(free_list, Kilobyte(16));
+        ASSERT_NE(block, nullptr);
+    }
+    for (u32 i = 0; i < 8; i += 2)
+    {
+        mfree(free_list, blocks[i]);
+    }
+
+    AllocatorStats stats{};
+    get_allocator_stats(free_list, &stats);
+    ASSERT_EQ(stats.type, AllocatorType::FreeList);
+    ASSERT_EQ(stats.free_block_count, 5);
+    ASSERT_GE(stats.bytes_in_use, Kilobyte(64));
+    ASSERT_EQ(stats.bytes_in_use + stats.free_bytes, stats.capacity);
+    ASSERT_GT(stats.fragmentation, 0.0);
+    ASSERT_LT(stats.fragmentation, 1.0);
+
+    void *small = malloc(pool, 32);
+    void *large = malloc(pool, 200);
+    ASSERT_EQ(malloc(pool, Kilobyte(1)), nullptr);
+
+    get_allocator_stats(pool, &stats);
+    ASSERT_EQ(stats.num_segments, 2);
+    ASSERT_EQ(stats.segments[0].used_blocks, 1);
+    ASSERT_EQ(stats.segments[1].used_blocks, 1);
+    ASSERT_EQ(stats.capacity, 64 * 8 + 256 * 4);
+    ASSERT_EQ(stats.bytes_in_use, 64 + 256);
+    ASSERT_EQ(stats.largest_free_block, 256);
+
+#ifdef VULTR_ALLOCATOR_STATS
+    ASSERT_EQ(stats.allocation_count, 2);
+    ASSERT_EQ(stats.live_allocations, 2);
+    ASSERT_EQ(stats.failed_allocations, 1);
+    ASSERT_EQ(stats.peak_bytes_in_use, 64 + 256);
+    ASSERT_EQ(stats.size_histogram[5], 1);
+    ASSERT_EQ(stats.size_histogram[8], 1);
+#endif
+
+    mfree(pool, small);
+    mfree(pool, large);
+    get_allocator_stats(pool, &stats);
+    ASSERT_EQ(stats.bytes_in_use, 0);
+
+#ifdef VULTR_ALLOCATOR_STATS
+    ASSERT_EQ(stats.live_allocations, 0);
+    ASSERT_EQ(stats.peak_bytes_in_use, 64 + 256);
+#endif
+
+    destroy_mem_arena(arena);
+    destroy_mem_arena(pool_arena);
+}
+
+template <typename Policy>
+static void push_and_remove(Policy policy)
+{
+    vtl::DynamicArray<u32, 4, 3, 2, 30, Policy> array(policy);
+    for (u32 i = 0; i < 1000; i++)
+    {
+        array.push_back(i);
+    }
+    ASSERT_EQ(array.len, 1000);
+    for (u32 i = 0; i < 1000; i++)
+    {
+        ASSERT_EQ(array[i], i);
+    }
+
+    // Removing from the front shrinks the array back down.
+    for (u32 i = 0; i < 990; i++)
+    {
+        array.remove(0);
+    }
+    ASSERT_EQ(array.len, 10);
+    ASSERT_LT(array._size, 100);
+    for (u32 i = 0; i < 10; i++)
+    {
+        ASSERT_EQ(array[i], 990 + i);
+    }
+}
+
+TEST(MemoryArena, AllocatorPolicies)
+{
+    MemoryArena *arenas[4];
+    for (auto &arena : arenas)
+    {
+        arena = init_mem_arena(Megabyte(16));
+    }
+    PoolRegion regions[]         = {{.size = 64, .count = 16}, {.size = Kilobyte(1), .count = 16}, {.size = Kilobyte(8), .count = 4}};
+    PoolAllocator *pool          = init_pool_allocator(arenas[0], regions, 3);
+    FreeListAllocator *free_list = init_free_list_allocator(arenas[1], Megabyte(4), 16);
+    LinearAllocator *linear      = init_linear_allocator(arenas[2], Megabyte(4));
+    FrameAllocator *frame        = init_frame_allocator(arenas[3], Megabyte(2), 2);
+
+    push_and_remove<DynamicAllocatorPolicy>(pool);
+    push_and_remove<DynamicAllocatorPolicy>(free_list);
+    push_and_remove<PoolPolicy>(pool);
+    push_and_remove<FreeListPolicy>(free_list);
+    push_and_remove<LinearPolicy>(linear);
+    push_and_remove<FramePolicy>(frame);
+
+    // Everything the arrays took was given back when they were destroyed.
+    AllocatorStats stats{};
+    get_allocator_stats(pool, &stats);
+    ASSERT_EQ(stats.bytes_in_use, 0);
+    get_allocator_stats(free_list, &stats);
+    ASSERT_EQ(stats.bytes_in_use, 0);
+
+    for (auto *arena : arenas)
+    {
+        destroy_mem_arena(arena);
+    }
+}
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#define private public
+#define protected public
+#include <types/array.h>
+#include <string>
+
+using namespace vtl;
+using namespace Vultr;
+
+struct SmallArrayTests : testing::Test
+{
+    void SetUp() override
+    {
+        arena                = init_mem_arena(Megabyte(8));
+        PoolRegion regions[] = {{.size = 256, .count = 64}, {.size = Kilobyte(4), .count = 64}, {.size = Kilobyte(64), .count = 16}};
+        pool                 = init_pool_allocator(arena, regions, 3);
+    }
+
+    void TearDown() override { destroy_mem_arena(arena); }
+
+    size_t bytes_in_use()
+    {
+        AllocatorStats stats;
+        get_allocator_stats(pool, &stats);
+        return stats.bytes_in_use;
+    }
+
+    MemoryArena *arena  = nullptr;
+    PoolAllocator *pool = nullptr;
+};
+
+TEST_F(SmallArrayTests, StaysInlineUntilFull)
+{
+    SmallArray<u32, 8, PoolPolicy> array(pool);
+    for (u32 i = 0; i < 8; i++)
+    {
+        array.push_back(i);
+    }
+    ASSERT_TRUE(array.is_inline());
+    ASSERT_EQ(bytes_in_use(), 0);
+
+    // Spilling moves everything to the allocator.
+    array.push_back(8);
+    ASSERT_FALSE(array.is_inline());
+    ASSERT_NE(bytes_in_use(), 0);
+    for (u32 i = 0; i < 1000; i++)
+    {
+        array.push_back(array[i % array.len]);
+    }
+    for (u32 i = 0; i < 9; i++)
+    {
+        ASSERT_EQ(array[i], i);
+    }
+    ASSERT_EQ(find_allocator(array.data()), pool);
+}
+
+TEST_F(SmallArrayTests, InsertRemove)
+{
+    SmallArray<u32, 4> array(pool);
+    for (u32 i = 0; i < 10; i += 2)
+    {
+        array.push_back(i);
+    }
+    for (u32 i = 1; i < 10; i += 2)
+    {
+        array.insert(i, i);
+    }
+    ASSERT_EQ(array.len, 10);
+    for (u32 i = 0; i < 10; i++)
+    {
+        ASSERT_EQ(array[i], i);
+    }
+
+    array.remove(0);
+    array.remove_last();
+    u32 expected = 1;
+    for (u32 value : array)
+    {
+        ASSERT_EQ(value, expected++);
+    }
+    ASSERT_EQ(expected, 9);
+}
+
+TEST_F(SmallArrayTests, NonTrivialElements)
+{
+    {
+        SmallArray<std::string, 2> array(pool);
+        array.push_back(std::string(100, 'a'));
+        array.emplace_back(100, 'b');
+        array.insert(0, std::string(100, 'c'));
+        ASSERT_EQ(array[0][0], 'c');
+        ASSERT_EQ(array[1][0], 'a');
+        ASSERT_EQ(array[2][0], 'b');
+        array.remove(1);
+        ASSERT_EQ(array[1][0], 'b');
+    }
+    ASSERT_EQ(bytes_in_use(), 0);
+}
@@ -1,163 +1,171 @@
-//#include <gtest/gtest.h>
-//#define private public
-//#define protected public
-//#include <types/dynamic_array.h>
-//#include <core/memory/vultr_memory.h>
-//
-//using namespace vtl;
-//using namespace Vultr;
-//TEST(ArrayList, EmptyInitialize)
-//{
-//    DynamicArray<const char *, 15> string_list;
-//    ASSERT_EQ(string_list._size, 15);
-//    ASSERT_EQ(string_list.len, 0);
-//    ASSERT_NE(string_list._array, nullptr);
-//}
-//
-//TEST(ArrayList, ArrayInitialize)
-//{
-//    const char *string_array[] = {"hello", "world"};
-//    DynamicArray<const char *, 10> string_list(string_array, 2);
-//    ASSERT_EQ(string_list._size, 10);
-//    ASSERT_EQ(string_list.len, 2);
-//    ASSERT_NE(string_list._array, nullptr);
-//}
-//
-//TEST(ArrayList, Operator)
-//{
-//    const char *string_array[] = {"hello"};
-//    DynamicArray<const char *> string_list(string_array, 1);
-//    ASSERT_EQ("hello", string_list[0]);
-//    string_list[0] = "world";
-//    ASSERT_EQ("world", string_list[0]);
-//    ASSERT_DEATH(string_list[1] = "ur mother", "Index out of bounds");
-//}
-//
-//TEST(ArrayList, PushBack)
-//{
-//    const char *string_array[] = {"hello"};
-//    DynamicArray<const char *, 10> string_list(string_array, 1);
-//
-//    string_list.push_back("world");
-//    ASSERT_EQ(string_list[1], "world");
-//    ASSERT_EQ(string_list._size, 10);
-//    ASSERT_EQ(string_list.len, 2);
-//}
-//
-//TEST(ArrayList, Insert)
-//{
-//    const char *string_array[] = {"big", "big", "chungus", "big", "chungus"};
-//    DynamicArray<const char *, 10> string_list(string_array, 5);
-//
-//    // Insert middle
-//    string_list.insert(1, "joe");
-//    ASSERT_EQ(string_list[0], "big");
-//    ASSERT_EQ(string_list[1], "joe");
-//    ASSERT_EQ(string_list[2], "big");
-//    ASSERT_EQ(string_list[3], "chungus");
-//    ASSERT_EQ(string_list[4], "big");
-//    ASSERT_EQ(string_list[5], "chungus");
-//    ASSERT_EQ(string_list._size, 10);
-//    ASSERT_EQ(string_list.len, 6);
-//
-//    // Insert beginning
-//    string_list.insert(0, "mama");
-//    ASSERT_EQ(string_list[0], "mama");
-//    ASSERT_EQ(string_list[1], "big");
-//    ASSERT_EQ(string_list[2], "joe");
-//    ASSERT_EQ(string_list[3], "big");
-//    ASSERT_EQ(string_list[4], "chungus");
-//    ASSERT_EQ(string_list[5], "big");
-//    ASSERT_EQ(string_list[6], "chungus");
-//    ASSERT_EQ(string_list._size, 10);
-//    ASSERT_EQ(string_list.len, 7);
-//
-//    // Insert end / push_back
-//    string_list.insert(7, "urmother");
-//    ASSERT_EQ(string_list[0], "mama");
-//    ASSERT_EQ(string_list[1], "big");
-//    ASSERT_EQ(string_list[2], "joe");
-//    ASSERT_EQ(string_list[3], "big");
-//    ASSERT_EQ(string_list[4], "chungus");
-//    ASSERT_EQ(string_list[5], "big");
-//    ASSERT_EQ(string_list[6], "chungus");
-//    ASSERT_EQ(string_list[7], "urmother");
-//    ASSERT_EQ(string_list._size, 10);
-//    ASSERT_EQ(string_list.len, 8);
-//
-//    string_list.insert(0, "mama");
-//    string_list.insert(0, "mama");
-//    string_list.insert(0, "mama");
-//    ASSERT_EQ(string_list[0], "mama");
-//    ASSERT_EQ(string_list[1], "mama");
-//    ASSERT_EQ(string_list[2], "mama");
-//    ASSERT_EQ(string_list[3], "mama");
-//    ASSERT_EQ(string_list[4], "big");
-//    ASSERT_EQ(string_list[5], "joe");
-//    ASSERT_EQ(string_list[6], "big");
-//    ASSERT_EQ(string_list[7], "chungus");
-//    ASSERT_EQ(string_list[8], "big");
-//    ASSERT_EQ(string_list[9], "chungus");
-//    ASSERT_EQ(string_list[10], "urmother");
-//    ASSERT_EQ(string_list._size, (int)(11 * 3 / 2));
-//    ASSERT_EQ(string_list.len, 11);
-//}
-//
-//TEST(ArrayList, Delete)
-//{
-//    const char *string_array[] = {"big", "big", "chungus", "big", "chungus"};
-//
-//    const u32 decay_percentage = 50;
-//    DynamicArray<const char *, 0, 3, 2, decay_percentage> string_list(string_array, 5);
-//
-//    ASSERT_EQ(string_list._size, (int)5 * 3 / 2);
-//    ASSERT_EQ(string_list.len, 5);
-//
-//    string_list.remove(1);
-//    ASSERT_EQ(string_list[0], "big");
-//    ASSERT_EQ(string_list[1], "chungus");
-//    ASSERT_EQ(string_list[2], "big");
-//    ASSERT_EQ(string_list[3], "chungus");
-//    ASSERT_EQ(string_list._size, (int)5 * 3 / 2);
-//    ASSERT_EQ(string_list.len, 4);
-//
-//    // Less than decay factor 50%
-//    string_list.remove(3);
-//    ASSERT_EQ(string_list[0], "big");
-//    ASSERT_EQ(string_list[1], "chungus");
-//    ASSERT_EQ(string_list[2], "big");
-//
-//    ASSERT_EQ(string_list._size, (int)3 * 3 / 2);
-//    ASSERT_EQ(string_list.len, 3);
-//
-//    string_list.remove(0);
-//    ASSERT_EQ(string_list[0], "chungus");
-//    ASSERT_EQ(string_list[1], "big");
-//    ASSERT_EQ(string_list._size, (int)3 * 3 / 2);
-//    ASSERT_EQ(string_list.len, 2);
-//
-//    // Less than decay factor 50%
-//    string_list.remove(0);
-//    ASSERT_EQ(string_list._size, (int)1 * 3 / 2);
-//    ASSERT_EQ(string_list.len, 1);
-//
-//    // Less than decay factor 50%
-//    string_list.remove_last();
-//    ASSERT_EQ(string_list._size, 0);
-//    ASSERT_EQ(string_list.len, 0);
-//
-//    EXPECT_DEATH(string_list.remove_last(), "Array is empty!");
-//}
-//
-//TEST(ArrayList, Iterator)
-//{
-//    const char *string_array[] = {"big", "big", "chungus", "big", "chungus"};
-//    DynamicArray<const char *> string_list(string_array, 5);
-//
-//    uint i = 0;
-//    for (const char *val : string_list)
-//    {
-//        EXPECT_STREQ(val, string_array[i]);
-//        i++;
-//    }
-//}
+#include <gtest/gtest.h>
+#define private public
+#define protected public
+#include <types/dynamic_array.h>
+#include <string>
+#include <vector>
+
+using namespace vtl;
+using namespace Vultr;
+
+struct DynamicArrayTests : testing::Test
+{
+    void SetUp() override
+    {
+        arena     = init_mem_arena(Megabyte(64));
+        allocator = init_free_list_allocator(arena, Megabyte(32), 16);
+    }
+
+    void TearDown() override { destroy_mem_arena(arena); }
+
+    MemoryArena *arena           = nullptr;
+    FreeListAllocator *allocator = nullptr;
+};
+
+TEST_F(DynamicArrayTests, ArrayInitialize)
+{
+    u32 elements[] = {1, 2, 3, 4, 5};
+    DynamicArray<u32, 4> array(allocator, elements, 5);
+    ASSERT_EQ(array.len, 5);
+    ASSERT_GE(array._size, 5);
+    for (u32 i = 0; i < 5; i++)
+    {
+        ASSERT_EQ(array[i], i + 1);
+    }
+}
+
+TEST_F(DynamicArrayTests, InsertRemove)
+{
+    DynamicArray<u32> array(allocator);
+    std::vector<u32> expected;
+    for (u32 i = 0; i < 200; i++)
+    {
+        array.insert(0, i);
+        expected.insert(expected.begin(), i);
+    }
+    array.insert(array.len, 1000);
+    expected.push_back(1000);
+    array.insert(50, 2000);
+    expected.insert(expected.begin() + 50, 2000);
+
+    for (u32 i = 0; i < 150; i++)
+    {
+        u32 index = (i * 7) % array.len;
+        array.remove(index);
+        expected.erase(expected.begin() + index);
+    }
+
+    ASSERT_EQ(array.len, expected.size());
+    for (u32 i = 0; i < array.len; i++)
+    {
+        ASSERT_EQ(array[i], expected[i]);
+    }
+}
+
+// Elements that aren't trivially relocatable are moved one at a time, and have to be destroyed exactly once.
+TEST_F(DynamicArrayTests, NonTrivialElements)
+{
+    std::vector<std::string> expected;
+    {
+        DynamicArray<std::string> array(allocator);
+        for (u32 i = 0; i < 100; i++)
+        {
+            std::string value = "a long enough string to be on the heap " + std::to_string(i);
+            array.push_back(value);
+            expected.push_back(value);
+        }
+        array.insert(0, "front");
+        expected.insert(expected.begin(), "front");
+        array.emplace_back(array[3]);
+        expected.push_back(expected[3]);
+        for (u32 i = 0; i < 80; i++)
+        {
+            array.remove(i % 3);
+            expected.erase(expected.begin() + i % 3);
+        }
+
+        ASSERT_EQ(array.len, expected.size());
+        for (u32 i = 0; i < array.len; i++)
+        {
+            ASSERT_EQ(array[i], expected[i]);
+        }
+
+        array.resize(40);
+        ASSERT_EQ(array.len, 40);
+        ASSERT_TRUE(array[39].empty());
+        array.resize(5);
+        ASSERT_EQ(array.len, 5);
+        ASSERT_EQ(array[4], expected[4]);
+    }
+
+    // Everything the strings allocated was given back.
+    AllocatorStats stats;
+    get_allocator_stats(allocator, &stats);
+    ASSERT_EQ(stats.bytes_in_use, 0);
+}
+
+TEST_F(DynamicArrayTests, PushBackN)
+{
+    u64 elements[100];
+    for (u64 i = 0; i < 100; i++)
+    {
+        elements[i] = i;
+    }
+
+    DynamicArray<u64> array(allocator);
+    array.push_back(1000);
+    array.push_back_n(elements, 100);
+    ASSERT_EQ(array.len, 101);
+    ASSERT_EQ(array[0], 1000);
+    for (u64 i = 0; i < 100; i++)
+    {
+        ASSERT_EQ(array[i + 1], i);
+    }
+}
+
+TEST_F(DynamicArrayTests, ReserveKeepsCapacity)
+{
+    DynamicArray<u32, 4> array(allocator);
+    array.reserve(1000);
+    u32 *data = array._array;
+    for (u32 i = 0; i < 1000; i++)
+    {
+        array.push_back(i);
+    }
+    ASSERT_EQ(array._array, data);
+
+    // Removing everything doesn't shrink below what was reserved.
+    while (!array.empty())
+    {
+        array.remove_last();
+    }
+    ASSERT_EQ(array._size, 1000);
+
+    array.clear();
+    ASSERT_EQ(array._size, 4);
+}
+
+// Pushing and removing right at the point where the array shrinks must not reallocate every time.
+TEST_F(DynamicArrayTests, ShrinkHysteresis)
+{
+    DynamicArray<u32, 4, 3, 2, 30> array(allocator);
+    for (u32 i = 0; i < 1000; i++)
+    {
+        array.push_back(i);
+    }
+    size_t full_size = array._size;
+    while (array._size == full_size)
+    {
+        array.remove_last();
+    }
+
+    size_t size = array._size;
+    u32 *data   = array._array;
+    for (u32 i = 0; i < 100; i++)
+    {
+        array.push_back(i);
+        array.remove_last();
+        ASSERT_EQ(array._size, size);
+        ASSERT_EQ(array._array, data);
+    }
+}
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#define private public
+#define protected public
+#include <types/handle_pool.h>
+#include <vector>
+
+using namespace vtl;
+using namespace Vultr;
+
+struct HandlePoolTests : testing::Test
+{
+    void SetUp() override
+    {
+        arena                = init_mem_arena(Megabyte(64));
+        PoolRegion regions[] = {{.size = Kilobyte(1), .count = 64}, {.size = Kilobyte(64), .count = 64}, {.size = Megabyte(1), .count = 16}};
+        pool                 = init_pool_allocator(arena, regions, 3);
+    }
+
+    void TearDown() override { destroy_mem_arena(arena); }
+
+    MemoryArena *arena  = nullptr;
+    PoolAllocator *pool = nullptr;
+};
+
+TEST_F(HandlePoolTests, InsertGetRemove)
+{
+    HandlePool<u64> objects(pool, 4);
+    std::vector<Handle<u64>> handles;
+    for (u64 i = 0; i < 1000; i++)
+    {
+        handles.push_back(objects.insert(i));
+    }
+    ASSERT_EQ(objects.len, 1000);
+    for (u64 i = 0; i < 1000; i++)
+    {
+        ASSERT_EQ(*objects.get(handles[i]), i);
+    }
+
+    // Remove every other object, the rest keep resolving to the same values after being moved around.
+    for (u64 i = 0; i < 1000; i += 2)
+    {
+        ASSERT_TRUE(objects.remove(handles[i]));
+    }
+    ASSERT_EQ(objects.len, 500);
+    for (u64 i = 0; i < 1000; i++)
+    {
+        if (i % 2 == 0)
+        {
+            ASSERT_EQ(objects.get(handles[i]), nullptr);
+            ASSERT_FALSE(objects.remove(handles[i]));
+        }
+        else
+        {
+            ASSERT_EQ(objects[handles[i]], i);
+        }
+    }
+
+    // Reused slots hand out new generations, so stale handles stay stale.
+    auto reused = objects.insert(1234);
+    ASSERT_EQ(reused.index, handles[998].index);
+    ASSERT_NE(reused.generation, handles[998].generation);
+    ASSERT_EQ(objects.get(handles[998]), nullptr);
+    ASSERT_EQ(objects[reused], 1234);
+
+    ASSERT_EQ(objects.get(Handle<u64>{}), nullptr);
+}
+
+TEST_F(HandlePoolTests, Iterate)
+{
+    HandlePool<u32> objects(pool);
+    std::vector<Handle<u32>> handles;
+    for (u32 i = 0; i < 200; i++)
+    {
+        handles.push_back(objects.insert(i));
+    }
+    for (u32 i = 0; i < 200; i += 3)
+    {
+        objects.remove(handles[i]);
+    }
+
+    // The dense array only ever holds live objects.
+    u32 count = 0;
+    u64 sum   = 0;
+    for (u32 value : objects)
+    {
+        ASSERT_NE(value % 3, 0);
+        sum += value;
+        count++;
+    }
+    ASSERT_EQ(count, objects.len);
+    for (u32 i = 0; i < objects.len; i++)
+    {
+        ASSERT_EQ(objects[objects.handle_at(i)], objects.begin()[i]);
+    }
+
+    // Walking the occupancy bitmap finds the same objects in the order of their slots.
+    u64 bitmap_sum = 0;
+    u32 last_index = 0;
+    count          = 0;
+    objects.for_each([&](Handle<u32> handle, u32 &value) {
+        ASSERT_GE(handle.index, last_index);
+        ASSERT_EQ(objects.get(handle), &value);
+        last_index = handle.index;
+        bitmap_sum += value;
+        count++;
+    });
+    ASSERT_EQ(count, objects.len);
+    ASSERT_EQ(bitmap_sum, sum);
+
+    objects.clear();
+    ASSERT_TRUE(objects.empty());
+    ASSERT_EQ(objects.get(handles[1]), nullptr);
+}
+
+TEST_F(HandlePoolTests, NonTrivialObjects)
+{
+    struct Counted
+    {
+        explicit Counted(u32 *live) : live(live) { (*live)++; }
+        Counted(Counted &&other) noexcept : live(other.live) { (*live)++; }
+        Counted &operator=(Counted &&other) noexcept = default;
+        ~Counted() { (*live)--; }
+        u32 *live;
+    };
+
+    u32 live = 0;
+    {
+        HandlePool<Counted> objects(pool, 2);
+        auto first = objects.insert(&live);
+        for (u32 i = 0; i < 100; i++)
+        {
+            objects.insert(&live);
+        }
+        ASSERT_EQ(live, 101);
+        objects.remove(first);
+        ASSERT_EQ(live, 100);
+    }
+    ASSERT_EQ(live, 0);
+}
@@ -1,42 +1,174 @@
-// #include <gtest/gtest.h>
-// #define private public
-// #define protected public
-// #include <hashtable.h>
-
-// using namespace vtl;
-
-// TEST(HashTable, Iterator)
-// {
-//     const char *string_keys[] = {"urmom", "chungus", "poop", "awoooga"};
-//     const char *string_vals[] = {"joe", "big", "shit", "eyes pop out"};
-//     auto table = new_hashtable<const char *, const char *>();
-
-//     for (int i = 0; i < 4; i++)
-//     {
-//         table[string_keys[i]] = string_vals[i];
-//     }
-
-//     uint i = 0;
-//     for (auto iterator = table.begin(); iterator != table.end(); iterator++)
-//     {
-//         EXPECT_STREQ((*iterator).key, string_keys[i]) << "Index " << i;
-//         EXPECT_STREQ((*iterator).value, string_vals[i]) << "Index " << i;
-//         i++;
-//     }
-
-//     i = 0;
-//     for (auto pair : table)
-//     {
-//         EXPECT_STREQ(pair.key, string_keys[i]) << "Index " << i;
-//         EXPECT_STREQ(pair.value, string_vals[i]) << "Index " << i;
-//         i++;
-//     }
-
-//     i = 0;
-//     for (auto [key, value] : table)
-//     {
-//         EXPECT_STREQ(key, string_keys[i]) << "Index " << i;
-//         EXPECT_STREQ(value, string_vals[i]) << "Index " << i;
-//         i++;
-//     }
-// }
+#include <gtest/gtest.h>
+#define private public
+#define protected public
+#include <types/hashtable.h>
+#include <math/crc32.h>
+#include <string>
+#include <unordered_map>
+
+using namespace vtl;
+using namespace Vultr;
+
+struct HashTableTests : testing::Test
+{
+    void SetUp() override
+    {
+        arena     = init_mem_arena(Megabyte(64));
+        allocator = init_free_list_allocator(arena, Megabyte(32), 16);
+    }
+
+    void TearDown() override { destroy_mem_arena(arena); }
+
+    MemoryArena *arena           = nullptr;
+    FreeListAllocator *allocator = nullptr;
+};
+
+TEST_F(HashTableTests, InsertFindRemove)
+{
+    HashTable<u64, u64> table(allocator);
+    ASSERT_EQ(table.find(1), nullptr);
+
+    for (u64 i = 0; i < 10000; i++)
+    {
+        table.insert(i * 7, i);
+    }
+    ASSERT_EQ(table.len, 10000);
+    for (u64 i = 0; i < 10000; i++)
+    {
+        ASSERT_EQ(*table.find(i * 7), i);
+    }
+    ASSERT_EQ(table.find(1), nullptr);
+
+    // Inserting an existing key overwrites it.
+    table.insert(7, 1234);
+    ASSERT_EQ(table.len, 10000);
+    ASSERT_EQ(table[7], 1234);
+
+    for (u64 i = 0; i < 10000; i += 2)
+    {
+        ASSERT_TRUE(table.remove(i * 7));
+    }
+    ASSERT_FALSE(table.remove(0));
+    ASSERT_EQ(table.len, 5000);
+    for (u64 i = 0; i < 10000; i++)
+    {
+        ASSERT_EQ(table.contains(i * 7), i % 2 == 1);
+    }
+
+    table.clear();
+    ASSERT_TRUE(table.empty());
+    ASSERT_EQ(table.find(7), nullptr);
+}
+
+TEST_F(HashTableTests, ChurnLeavesNoTombstones)
+{
+    // Every key hashes into the same group, so most of them have to probe past full groups.
+    struct CollidingHash
+    {
+        u64 operator()(u64 key) const { return key & 0x7F; }
+    };
+
+    HashTable<u64, u64, CollidingHash> table(allocator, 256);
+    u32 capacity = table._capacity;
+    for (u64 round = 0; round < 100; round++)
+    {
+        for (u64 i = 0; i < 100; i++)
+        {
+            table.insert(round * 1000 + i, i);
+        }
+        for (u64 i = 0; i < 100; i++)
+        {
+            ASSERT_TRUE(table.remove(round * 1000 + i));
+        }
+    }
+    ASSERT_EQ(table._capacity, capacity);
+
+    // Once everything is removed, no group is marked as probed past anymore and every slot is empty again.
+    for (u32 group = 0; group < table._capacity / 16; group++)
+    {
+        ASSERT_EQ(table._overflow[group], 0);
+    }
+    for (u32 i = 0; i < table._capacity; i++)
+    {
+        ASSERT_EQ(table._ctrl[i], internal::HASHTABLE_EMPTY);
+    }
+}
+
+TEST_F(HashTableTests, MatchesUnorderedMap)
+{
+    HashTable<u32, u32> table(allocator);
+    std::unordered_map<u32, u32> expected;
+
+    u32 seed = 1;
+    for (u32 i = 0; i < 50000; i++)
+    {
+        seed    = seed * 1664525 + 1013904223;
+        u32 key = (seed >> 8) % 4096;
+        if (seed & 1)
+        {
+            table.insert(key, i);
+            expected[key] = i;
+        }
+        else
+        {
+            ASSERT_EQ(table.remove(key), expected.erase(key) == 1);
+        }
+    }
+
+    ASSERT_EQ(table.len, expected.size());
+    u32 count = 0;
+    for (auto &entry : table)
+    {
+        ASSERT_EQ(entry.value, expected.at(entry.key));
+        count++;
+    }
+    ASSERT_EQ(count, expected.size());
+}
+
+TEST_F(HashTableTests, ReserveAndRehash)
+{
+    HashTable<u32, u32> table(allocator);
+    table.reserve(1000);
+    u32 capacity = table._capacity;
+    ASSERT_GE(capacity * 7 / 8, 1000);
+    for (u32 i = 0; i < 1000; i++)
+    {
+        table.insert(i, i);
+    }
+    ASSERT_EQ(table._capacity, capacity);
+
+    // Rehashing never shrinks the table below what its keys need.
+    table.rehash(0);
+    ASSERT_EQ(table._capacity, capacity);
+    for (u32 i = 0; i < 1000; i++)
+    {
+        ASSERT_EQ(*table.find(i), i);
+    }
+}
+
+TEST_F(HashTableTests, NonTrivialValues)
+{
+    HashTable<const char *, std::string> table(allocator);
+    table.insert("mesh", std::string(100, 'm'));
+    table["texture"] = "texture data";
+
+    char key[] = "mesh";
+    ASSERT_EQ(table.find(key)->size(), 100);
+    ASSERT_EQ(table["texture"], "texture data");
+
+    u32 count = 0;
+    table.for_each([&](const char *, std::string &) { count++; });
+    ASSERT_EQ(count, 2);
+}
+
+TEST_F(HashTableTests, PrecomputedCRC32Keys)
+{
+    // File handles are already CRC32 hashes of their paths, so the table uses them as is.
+    HashTable<u32, u32, CRC32Hash> table(allocator);
+    u32 handle = CRC32_STR("res/meshes/cube.obj");
+    table.insert_hashed(handle, 1, handle);
+    ASSERT_EQ(*table.find(handle), 1);
+    ASSERT_EQ(*table.find_hashed(crcdetail::compute("res/meshes/cube.obj", 19), handle), 1);
+    ASSERT_TRUE(table.remove_hashed(handle, handle));
+    ASSERT_TRUE(table.empty());
+}
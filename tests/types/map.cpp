@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#define private public
+#define protected public
+#include <types/map.h>
+#include <map>
+
+using namespace vtl;
+using namespace Vultr;
+
+struct FlatMapTests : testing::Test
+{
+    void SetUp() override
+    {
+        arena     = init_mem_arena(Megabyte(8));
+        allocator = init_free_list_allocator(arena, Megabyte(4), 16);
+    }
+
+    void TearDown() override { destroy_mem_arena(arena); }
+
+    MemoryArena *arena           = nullptr;
+    FreeListAllocator *allocator = nullptr;
+};
+
+TEST_F(FlatMapTests, InsertFindRemove)
+{
+    FlatMap<s32, f32, 8, std::less<s32>, FreeListPolicy> uniforms(allocator);
+    ASSERT_EQ(uniforms.find(0), nullptr);
+
+    uniforms.insert(5, 0.5f);
+    uniforms.insert(1, 0.1f);
+    uniforms[3] = 0.3f;
+    uniforms.insert(5, 5.0f);
+    ASSERT_EQ(uniforms.size(), 3);
+    ASSERT_TRUE(uniforms.keys.is_inline());
+
+    ASSERT_EQ(*uniforms.find(1), 0.1f);
+    ASSERT_EQ(*uniforms.find(3), 0.3f);
+    ASSERT_EQ(*uniforms.find(5), 5.0f);
+    ASSERT_EQ(uniforms.find(2), nullptr);
+    ASSERT_EQ(uniforms.find(6), nullptr);
+
+    // Keys stay sorted.
+    s32 last = -1;
+    uniforms.for_each([&](s32 location, f32 &) {
+        ASSERT_GT(location, last);
+        last = location;
+    });
+
+    ASSERT_TRUE(uniforms.remove(3));
+    ASSERT_FALSE(uniforms.remove(3));
+    ASSERT_EQ(uniforms.find(3), nullptr);
+    ASSERT_EQ(uniforms.size(), 2);
+}
+
+TEST_F(FlatMapTests, MatchesStdMap)
+{
+    FlatMap<u32, u32> map(allocator);
+    std::map<u32, u32> expected;
+
+    u32 seed = 1;
+    for (u32 i = 0; i < 20000; i++)
+    {
+        seed    = seed * 1664525 + 1013904223;
+        u32 key = (seed >> 8) % 512;
+        if (seed & 1)
+        {
+            map.insert(key, i);
+            expected[key] = i;
+        }
+        else
+        {
+            ASSERT_EQ(map.remove(key), expected.erase(key) == 1);
+        }
+
+        u32 probe = (seed >> 16) % 512;
+        ASSERT_EQ(map.contains(probe), expected.contains(probe));
+        ASSERT_EQ(map.lower_bound(probe), std::distance(expected.begin(), expected.lower_bound(probe)));
+    }
+
+    ASSERT_EQ(map.size(), expected.size());
+    u32 i = 0;
+    for (auto [key, value] : expected)
+    {
+        ASSERT_EQ(map.keys[i], key);
+        ASSERT_EQ(map.values[i], value);
+        i++;
+    }
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#define private public
+#define protected public
+#include <types/mpmc_queue.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace vtl;
+using namespace Vultr;
+
+struct MpmcQueueTests : testing::Test
+{
+    void SetUp() override
+    {
+        arena     = init_mem_arena(Megabyte(8));
+        allocator = init_free_list_allocator(arena, Megabyte(4), 16);
+    }
+
+    void TearDown() override { destroy_mem_arena(arena); }
+
+    MemoryArena *arena           = nullptr;
+    FreeListAllocator *allocator = nullptr;
+};
+
+TEST_F(MpmcQueueTests, FullAndEmpty)
+{
+    MpmcQueue<u32> queue(allocator, 5);
+    ASSERT_EQ(queue.capacity(), 8);
+
+    u32 out = 0;
+    ASSERT_FALSE(queue.try_pop(&out));
+    for (u32 lap = 0; lap < 3; lap++)
+    {
+        for (u32 i = 0; i < 8; i++)
+        {
+            ASSERT_TRUE(queue.try_push(i));
+        }
+        ASSERT_FALSE(queue.try_push(8));
+        ASSERT_EQ(queue.size(), 8);
+
+        for (u32 i = 0; i < 8; i++)
+        {
+            ASSERT_TRUE(queue.try_pop(&out));
+            ASSERT_EQ(out, i);
+        }
+        ASSERT_TRUE(queue.empty());
+    }
+}
+
+TEST_F(MpmcQueueTests, NonTrivialElements)
+{
+    {
+        MpmcQueue<std::string> queue(allocator, 8);
+        for (u32 i = 0; i < 6; i++)
+        {
+            ASSERT_TRUE(queue.try_push("a long enough string to be on the heap " + std::to_string(i)));
+        }
+        std::string out;
+        ASSERT_TRUE(queue.try_pop(&out));
+        ASSERT_EQ(out, "a long enough string to be on the heap 0");
+    }
+
+    AllocatorStats stats;
+    get_allocator_stats(allocator, &stats);
+    ASSERT_EQ(stats.bytes_in_use, 0);
+}
+
+// Every element pushed by every producer is popped by exactly one consumer.
+TEST_F(MpmcQueueTests, ProducersConsumers)
+{
+    constexpr u64 threads    = 4;
+    constexpr u64 per_thread = 20000;
+    MpmcQueue<u64, true> queue(allocator, 64);
+    std::vector<u64> popped[threads];
+    std::vector<std::thread> workers;
+
+    for (u64 t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&, t]() {
+            for (u64 i = 0; i < per_thread; i++)
+            {
+                while (!queue.try_push(t * per_thread + i))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        workers.emplace_back([&, t]() {
+            for (u64 i = 0; i < per_thread; i++)
+            {
+                u64 out = 0;
+                queue.pop_wait(&out);
+                popped[t].push_back(out);
+            }
+        });
+    }
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+
+    std::vector<bool> seen(threads * per_thread, false);
+    for (auto &values : popped)
+    {
+        for (u64 value : values)
+        {
+            ASSERT_FALSE(seen[value]);
+            seen[value] = true;
+        }
+    }
+    ASSERT_TRUE(queue.empty());
+}
@@ -1,93 +1,131 @@
-// TODO(Brandon): Readd tests when custom allocator is implemented into types.
-// #include <gtest/gtest.h>
-// #define private public
-// #define protected public
-// #include <types/queue.h>
-
-// using namespace vtl;
-
-// TEST(Queue, Initialize)
-// {
-//     Queue<const char *, 15> queue;
-//     ASSERT_EQ(queue._size, 15);
-//     ASSERT_EQ(queue.len, 0);
-//     ASSERT_NE(queue._array, nullptr);
-// }
-
-// TEST(Queue, Push)
-// {
-//     Queue<const char *, 2, 3, 2> queue;
-
-//     queue.push("Hello");
-//     ASSERT_EQ(queue._size, 2);
-//     ASSERT_EQ(queue.len, 1);
-
-//     queue.push(" my");
-//     ASSERT_EQ(queue._size, 2);
-//     ASSERT_EQ(queue.len, 2);
-
-//     queue.push(" baby");
-//     ASSERT_EQ(queue._size, 4);
-//     ASSERT_EQ(queue.len, 3);
-// }
-
-// TEST(Queue, Front)
-// {
-//     Queue<const char *, 2, 3, 2> queue;
-
-//     queue.push("Hello");
-//     ASSERT_EQ(queue._size, 2);
-//     ASSERT_EQ(queue.len, 1);
-
-//     ASSERT_STRCASEEQ("Hello", *queue.front());
-
-//     queue.push(" my");
-//     ASSERT_EQ(queue._size, 2);
-//     ASSERT_EQ(queue.len, 2);
-
-//     ASSERT_STRCASEEQ("Hello", *queue.front());
-
-//     queue.push(" baby");
-//     ASSERT_EQ(queue._size, 4);
-//     ASSERT_EQ(queue.len, 3);
-
-//     ASSERT_STRCASEEQ("Hello", *queue.front());
-// }
-
-// TEST(Queue, Pop)
-// {
-//     Queue<const char *, 2, 3, 2, 26> queue;
-//     queue.push("Hello");
-//     queue.push(" my");
-//     queue.push(" baby");
-
-//     ASSERT_EQ(queue._size, 4);
-//     ASSERT_EQ(queue.len, 3);
-//     ASSERT_STRCASEEQ("Hello", *queue.front());
-//     queue.pop();
-//     ASSERT_EQ(queue._size, 4);
-//     ASSERT_EQ(queue.len, 2);
-//     ASSERT_STRCASEEQ(" my", *queue.front());
-
-//     queue.push(" hello");
-//     ASSERT_EQ(queue._size, 4);
-//     ASSERT_EQ(queue.len, 3);
-
-//     queue.pop();
-//     ASSERT_EQ(queue._size, 4);
-//     ASSERT_EQ(queue.len, 2);
-//     ASSERT_STRCASEEQ(" baby", *queue.front());
-
-//     queue.pop();
-//     ASSERT_EQ(queue._size, 2);
-//     ASSERT_EQ(queue.len, 1);
-//     ASSERT_STRCASEEQ(" hello", *queue.front());
-// }
-
-// TEST(Queue, Empty)
-// {
-//     Queue<const char *> queue;
-//     ASSERT_TRUE(queue.empty());
-//     queue.push("Hello");
-//     ASSERT_FALSE(queue.empty());
-// }
+#include <gtest/gtest.h>
+#define private public
+#define protected public
+#include <types/queue.h>
+#include <string>
+#include <thread>
+
+using namespace vtl;
+using namespace Vultr;
+
+struct QueueTests : testing::Test
+{
+    void SetUp() override
+    {
+        arena     = init_mem_arena(Megabyte(64));
+        allocator = init_free_list_allocator(arena, Megabyte(32), 16);
+    }
+
+    void TearDown() override { destroy_mem_arena(arena); }
+
+    size_t bytes_in_use()
+    {
+        AllocatorStats stats;
+        get_allocator_stats(allocator, &stats);
+        return stats.bytes_in_use;
+    }
+
+    MemoryArena *arena           = nullptr;
+    FreeListAllocator *allocator = nullptr;
+};
+
+TEST_F(QueueTests, Initialize)
+{
+    Queue<u32, 15> queue(allocator);
+    ASSERT_EQ(queue.capacity(), 16);
+    ASSERT_EQ(queue.len, 0);
+    ASSERT_NE(queue._array, nullptr);
+}
+
+TEST_F(QueueTests, PushPopInOrder)
+{
+    Queue<u32, 4> queue(allocator);
+    u32 next_pop = 0;
+    for (u32 i = 0; i < 1000; i++)
+    {
+        queue.push(i);
+        // Keep the front moving so that growing has to unwrap the buffer.
+        if (i % 3 == 0)
+        {
+            ASSERT_EQ(*queue.front(), next_pop);
+            queue.pop();
+            next_pop++;
+        }
+    }
+
+    while (!queue.empty())
+    {
+        ASSERT_EQ(*queue.front(), next_pop);
+        queue.pop();
+        next_pop++;
+    }
+    ASSERT_EQ(next_pop, 1000);
+}
+
+TEST_F(QueueTests, PushNPopN)
+{
+    u32 items[100];
+    for (u32 i = 0; i < 100; i++)
+    {
+        items[i] = i;
+    }
+
+    Queue<u32, 8> queue(allocator);
+    queue.push(1000);
+    queue.push(1001);
+    queue.pop();
+    queue.push_n(items, 100);
+    ASSERT_EQ(queue.len, 101);
+
+    u32 out[64];
+    ASSERT_EQ(queue.pop_n(out, 1), 1);
+    ASSERT_EQ(out[0], 1001);
+    for (u32 popped = 0; popped < 100; popped += 50)
+    {
+        ASSERT_EQ(queue.pop_n(out, 50), 50);
+        for (u32 i = 0; i < 50; i++)
+        {
+            ASSERT_EQ(out[i], popped + i);
+        }
+    }
+    ASSERT_EQ(queue.pop_n(out, 64), 0);
+    ASSERT_TRUE(queue.empty());
+}
+
+TEST_F(QueueTests, NonTrivialElements)
+{
+    {
+        Queue<std::string, 2> queue(allocator);
+        for (u32 i = 0; i < 100; i++)
+        {
+            queue.push("a long enough string to be on the heap " + std::to_string(i));
+            if (i % 2 == 0)
+            {
+                queue.pop();
+            }
+        }
+        ASSERT_EQ(*queue.front(), "a long enough string to be on the heap 50");
+
+        std::string out[10];
+        ASSERT_EQ(queue.pop_n(out, 10), 10);
+        ASSERT_EQ(out[9], "a long enough string to be on the heap 59");
+    }
+    ASSERT_EQ(bytes_in_use(), 0);
+}
+
+TEST_F(QueueTests, PopWait)
+{
+    Queue<u32, 16, true> queue(allocator);
+    std::thread producer([&]() {
+        for (u32 i = 0; i < 1000; i++)
+        {
+            queue.push(i);
+        }
+    });
+
+    for (u32 i = 0; i < 1000; i++)
+    {
+        ASSERT_EQ(queue.pop_wait(), i);
+    }
+    producer.join();
+}
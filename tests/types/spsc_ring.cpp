@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#define private public
+#define protected public
+#include <types/spsc_ring.h>
+#include <string>
+#include <thread>
+
+using namespace vtl;
+using namespace Vultr;
+
+struct SpscRingTests : testing::Test
+{
+    void SetUp() override
+    {
+        arena     = init_mem_arena(Megabyte(8));
+        allocator = init_free_list_allocator(arena, Megabyte(4), 16);
+    }
+
+    void TearDown() override { destroy_mem_arena(arena); }
+
+    MemoryArena *arena           = nullptr;
+    FreeListAllocator *allocator = nullptr;
+};
+
+TEST_F(SpscRingTests, FullAndEmpty)
+{
+    SpscRing<u32> ring(allocator, 3);
+    ASSERT_EQ(ring.capacity(), 4);
+
+    u32 out = 0;
+    ASSERT_FALSE(ring.try_pop(&out));
+    for (u32 lap = 0; lap < 3; lap++)
+    {
+        for (u32 i = 0; i < 4; i++)
+        {
+            ASSERT_TRUE(ring.try_push(i));
+        }
+        ASSERT_FALSE(ring.try_push(4));
+        ASSERT_EQ(ring.size(), 4);
+
+        for (u32 i = 0; i < 4; i++)
+        {
+            ASSERT_TRUE(ring.try_pop(&out));
+            ASSERT_EQ(out, i);
+        }
+        ASSERT_TRUE(ring.empty());
+    }
+}
+
+// Elements left in the ring are destroyed with it.
+TEST_F(SpscRingTests, NonTrivialElements)
+{
+    {
+        SpscRing<std::string> ring(allocator, 8);
+        for (u32 i = 0; i < 6; i++)
+        {
+            ASSERT_TRUE(ring.try_push("a long enough string to be on the heap " + std::to_string(i)));
+        }
+        std::string out;
+        ASSERT_TRUE(ring.try_pop(&out));
+        ASSERT_EQ(out, "a long enough string to be on the heap 0");
+    }
+
+    AllocatorStats stats;
+    get_allocator_stats(allocator, &stats);
+    ASSERT_EQ(stats.bytes_in_use, 0);
+}
+
+TEST_F(SpscRingTests, ProducerConsumer)
+{
+    SpscRing<u64, true> ring(allocator, 64);
+    std::thread producer([&]() {
+        for (u64 i = 0; i < 100000; i++)
+        {
+            while (!ring.try_push(i))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    for (u64 i = 0; i < 100000; i++)
+    {
+        u64 out = 0;
+        ring.pop_wait(&out);
+        ASSERT_EQ(out, i);
+    }
+    producer.join();
+}